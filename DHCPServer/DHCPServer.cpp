@@ -76,7 +76,8 @@ namespace Plugin {
                         index.Current().PoolSize.Value(),
                         index.Current().Router.Value(),
                         dns,
-                        std::bind(&DHCPServer::OnNewIPRequest, this, std::placeholders::_1, std::placeholders::_2)));
+                        _persistentPath,
+                        std::bind(&DHCPServer::OnLeaseChange, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)));
 
                 if (server.second == true) {
                     LoadLeases(server.first->first, server.first->second);
@@ -186,39 +187,16 @@ namespace Plugin {
         return result;
     }
 
-    void DHCPServer::SaveLeases(const string& interface, const DHCPServerImplementation& dhcpServer) const
-    {
-
-        if (_persistentPath.empty() == false) {
-            Core::JSON::ArrayType<Data::Server::Lease> leasesList;
-
-            // Saving to file might take a while, and lifetime of DHCPServerImplementation::Iterator
-            // object must be deterministic and short (<10ms), so we scope it 
-            {
-                DHCPServerImplementation::Iterator leases = dhcpServer.Leases();
-                while(leases.Next() && (leases.IsValid() == true)) {
-                    leasesList.Add().Set(leases.Current());
-                }        
-            }
-
-            Core::File leasesFile(_persistentPath + interface + ".json");
-
-            if (leasesFile.Create() == true) {
-                leasesList.IElement::ToFile(leasesFile);
-                leasesFile.Close();
-            } else {
-                TRACE_L1("Could not save leases in pemranent storage area.\n");
-            }
-        }
-    }
-
+    // Leases used to be stored as JSON, they are taken over by the lease log the first time the server is opened.
     void DHCPServer::LoadLeases(const string& interface, DHCPServerImplementation& dhcpServer) 
     {
 
         if (_persistentPath.empty() == false) {
             Core::File leasesFile(_persistentPath + interface + ".json");
 
-            if (leasesFile.Open(true) == true) {
+            if (Core::File(dhcpServer.Storage()).Exists() == true) {
+                leasesFile.Destroy();
+            } else if (leasesFile.Open(true) == true) {
                 Core::JSON::ArrayType<Data::Server::Lease> leases;
 
                 Core::OptionalType<Core::JSON::Error> error;
@@ -236,13 +214,12 @@ namespace Plugin {
         }
     }
 
-    void DHCPServer::OnNewIPRequest(const string& interface, const DHCPServerImplementation::Lease* lease) 
+    void DHCPServer::OnLeaseChange(const string& interface, const DHCPServerImplementation::Lease* lease, const DHCPServerImplementation::event what)
     {
-        TRACE(Trace::Information, ("DHCP server granted address %s on interface %s", lease->Address().HostAddress().c_str(), interface.c_str()));
-
-        auto dhcpServer = _servers.find(interface);
-        if (dhcpServer != _servers.end()) {
-            SaveLeases(interface, dhcpServer->second);
+        if (what == DHCPServerImplementation::LEASE_GRANTED) {
+            TRACE(Trace::Information, ("DHCP server granted address %s on interface %s", lease->Address().HostAddress().c_str(), interface.c_str()));
+        } else {
+            TRACE(Trace::Information, ("DHCP server reclaimed address %s on interface %s, the lease expired", lease->Address().HostAddress().c_str(), interface.c_str()));
         }
     }
 
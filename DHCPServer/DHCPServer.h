@@ -280,11 +280,10 @@ namespace Plugin {
 
         // Lease permanent storage
         // -------------------------------------------------------------------------------------------------------
-        void SaveLeases(const string& interface, const DHCPServerImplementation& dhcpServer) const;
         void LoadLeases(const string& interface, DHCPServerImplementation& dhcpServer);
 
         // Callbacks
-        void OnNewIPRequest(const string& interface, const DHCPServerImplementation::Lease* lease);
+        void OnLeaseChange(const string& interface, const DHCPServerImplementation::Lease* lease, const DHCPServerImplementation::event what);
     private:
         uint16_t _skipURL;
         std::map<const string, DHCPServerImplementation> _servers;
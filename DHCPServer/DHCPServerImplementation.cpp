@@ -54,7 +54,15 @@ namespace Plugin {
 
                 _minAddress = ((address & (~mask)) + (_poolStart & mask));
                 _maxAddress = ((address & (~mask)) + ((_poolStart + _poolSize) & mask));
-                _nextFreeIp = _minAddress;
+
+                _leases.Lock();
+                _leases.Pool(_minAddress, _maxAddress);
+                _leases.Unlock();
+
+                // Nothing is served yet, so the list is only touched by the log while it is loaded.
+                if (_log.Open(_storage, _leases) != Core::ERROR_NONE) {
+                    TRACE_L1("Could not open the lease log [%s], leases will not survive a restart.", _storage.c_str());
+                }
 
                 if (_router != static_cast<uint32_t>(~0)) {
                     if (_router == 0) {
@@ -69,11 +77,331 @@ namespace Plugin {
             }
         }
 
+        if (result == Core::ERROR_NONE) {
+            // First sweep reclaims what expired while we were down.
+            _sweeper.Submit();
+        }
+
         return (result);
     }
     uint32_t DHCPServerImplementation::Close()
     {
-        return (SocketDatagram::Close(Core::infinite));
+        uint32_t result = SocketDatagram::Close(Core::infinite);
+
+        _sweeper.Revoke();
+
+        _log.Close();
+
+        return (result);
+    }
+
+    DHCPServerImplementation::LeaseLog::LeaseLog()
+        : _lock()
+        , _path()
+        , _fd(-1)
+        , _records(0)
+        , _leases(nullptr)
+        , _compact(false)
+        , _compacting(false)
+        , _tail()
+        , _tailRecords(0)
+        , _job(*this)
+    {
+    }
+    DHCPServerImplementation::LeaseLog::~LeaseLog()
+    {
+        Close();
+    }
+
+    uint32_t DHCPServerImplementation::LeaseLog::Open(const string& path, LeaseList& leases)
+    {
+        uint32_t result = Core::ERROR_NONE;
+
+        Close();
+
+        _path = path;
+
+        if (_path.empty() == false) {
+#ifndef __WINDOWS__
+            int fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            leases.Lock();
+
+            if (fd != -1) {
+                std::vector<uint8_t> content;
+                struct stat info;
+
+                if ((::fstat(fd, &info) == 0) && (static_cast<size_t>(info.st_size) >= sizeof(Header))) {
+                    content.resize(info.st_size);
+
+                    if (::pread(fd, content.data(), content.size(), 0) != static_cast<ssize_t>(content.size())) {
+                        content.clear();
+                    }
+                }
+
+                ::close(fd);
+
+                const Header* header = reinterpret_cast<const Header*>(content.data());
+
+                if ((content.empty() == false) && (header->Magic == Magic) && (header->Version == Version) && (header->RecordSize == sizeof(Record))) {
+                    std::unordered_map<uint32_t, Lease> replay;
+                    size_t offset = sizeof(Header);
+
+                    // A record cut short by a crash ends the replay.
+                    while ((offset + sizeof(Record)) <= content.size()) {
+                        const Record* record = reinterpret_cast<const Record*>(&content[offset]);
+
+                        if ((offset + sizeof(Record) + record->Length) > content.size()) {
+                            break;
+                        }
+
+                        replay.erase(record->Address);
+
+                        if (record->Type == GRANTED) {
+                            replay.emplace(std::piecewise_construct,
+                                std::forward_as_tuple(record->Address),
+                                std::forward_as_tuple(Identifier(&content[offset + sizeof(Record)], record->Length), record->Address, record->Expiration));
+                        }
+
+                        offset += sizeof(Record) + record->Length;
+                    }
+
+                    for (const std::pair<const uint32_t, Lease>& entry : replay) {
+                        leases.Create(entry.second.Id(), entry.second.Raw(), entry.second.Expiration());
+                    }
+                }
+            }
+
+            std::vector<uint8_t> content;
+            const uint32_t records = static_cast<uint32_t>(leases.size());
+
+            Snapshot(leases, content);
+
+            leases.Unlock();
+
+            fd = Store(content);
+
+            _lock.Lock();
+
+            if ((fd != -1) && (Replace(fd) == true)) {
+                _records = records;
+                _leases = &leases;
+            } else {
+                result = Core::ERROR_OPENING_FAILED;
+            }
+
+            _lock.Unlock();
+#else
+            DEBUG_VARIABLE(leases);
+            result = Core::ERROR_UNAVAILABLE;
+#endif
+        }
+
+        return (result);
+    }
+
+    void DHCPServerImplementation::LeaseLog::Close()
+    {
+        _job.Revoke();
+
+        _lock.Lock();
+
+#ifndef __WINDOWS__
+        if (_fd != -1) {
+            // Whatever the job did not get to yet.
+            ::fdatasync(_fd);
+            ::close(_fd);
+            _fd = -1;
+        }
+#endif
+
+        _leases = nullptr;
+        _compact = false;
+
+        _lock.Unlock();
+    }
+
+    void DHCPServerImplementation::LeaseLog::Dispatch()
+    {
+#ifndef __WINDOWS__
+        int fd = -1;
+
+        Compact();
+
+        // Sync on a copy of the descriptor, so a grant coming in does not wait for the disk. If the log gets
+        // rewritten in the mean time, the old file is synced for nothing, the new one is synced already.
+        _lock.Lock();
+
+        if (_fd != -1) {
+            fd = ::dup(_fd);
+        }
+
+        _lock.Unlock();
+
+        if (fd != -1) {
+            ::fdatasync(fd);
+            ::close(fd);
+        }
+#endif
+    }
+
+    void DHCPServerImplementation::LeaseLog::Append(const type kind, const Lease& lease, const LeaseList& leases)
+    {
+#ifndef __WINDOWS__
+        _lock.Lock();
+
+        if (_fd != -1) {
+            uint8_t buffer[sizeof(Record) + 255];
+            const uint16_t length = Fill(buffer, kind, lease);
+
+            if (::write(_fd, buffer, length) == length) {
+                _records++;
+
+                if (_compacting == true) {
+                    _tail.insert(_tail.end(), buffer, buffer + length);
+                    _tailRecords++;
+                }
+                if (_records > ((2 * leases.size()) + 64)) {
+                    _compact = true;
+                }
+
+                _job.Submit();
+            }
+        }
+
+        _lock.Unlock();
+#else
+        DEBUG_VARIABLE(kind);
+        DEBUG_VARIABLE(lease);
+        DEBUG_VARIABLE(leases);
+#endif
+    }
+
+    // Rewrites the log with only the live leases. The list is copied with its lock taken, the socket thread holds
+    // it while appending, so no record gets lost in between. What is appended while the new file is written goes
+    // into the old one as well as into the tail, which is added to the new file before it replaces the old one.
+    void DHCPServerImplementation::LeaseLog::Compact()
+    {
+#ifndef __WINDOWS__
+        std::vector<uint8_t> content;
+        uint32_t records = 0;
+
+        _lock.Lock();
+        const LeaseList* leases = (((_compact == true) && (_fd != -1)) ? _leases : nullptr);
+        _lock.Unlock();
+
+        if (leases != nullptr) {
+            leases->ReadLock();
+            _lock.Lock();
+
+            Snapshot(*leases, content);
+            records = static_cast<uint32_t>(leases->size());
+            _compact = false;
+            _compacting = true;
+            _tail.clear();
+            _tailRecords = 0;
+
+            _lock.Unlock();
+            leases->ReadUnlock();
+
+            const int fd = Store(content);
+
+            _lock.Lock();
+
+            if (fd != -1) {
+                if ((::write(fd, _tail.data(), _tail.size()) == static_cast<ssize_t>(_tail.size())) && (Replace(fd) == true)) {
+                    _records = records + _tailRecords;
+                } else {
+                    TRACE_L1("Could not rewrite the lease log [%s], it keeps growing.", _path.c_str());
+                }
+            }
+
+            _compacting = false;
+            _tail.clear();
+            _tailRecords = 0;
+
+            _lock.Unlock();
+        }
+#endif
+    }
+
+#ifndef __WINDOWS__
+    // Written aside and synced, it is renamed over the log by Replace(), a crash leaves either the old or the new one.
+    int DHCPServerImplementation::LeaseLog::Store(const std::vector<uint8_t>& content) const
+    {
+        const string temporary(_path + _T(".new"));
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if ((fd != -1) && ((::write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())) || (::fdatasync(fd) != 0))) {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            fd = -1;
+        }
+
+        return (fd);
+    }
+
+    // Should be called with the lock taken. Takes the descriptor of the file written aside, also if that fails.
+    bool DHCPServerImplementation::LeaseLog::Replace(const int fd)
+    {
+        const string temporary(_path + _T(".new"));
+        const bool result = (::rename(temporary.c_str(), _path.c_str()) == 0);
+
+        if (result == true) {
+            if (_fd != -1) {
+                ::close(_fd);
+            }
+            _fd = fd;
+        } else {
+            ::close(fd);
+            ::unlink(temporary.c_str());
+        }
+
+        return (result);
+    }
+#else
+    int DHCPServerImplementation::LeaseLog::Store(const std::vector<uint8_t>&) const
+    {
+        return (-1);
+    }
+
+    bool DHCPServerImplementation::LeaseLog::Replace(const int)
+    {
+        return (false);
+    }
+#endif
+
+    /* static */ void DHCPServerImplementation::LeaseLog::Snapshot(const LeaseList& leases, std::vector<uint8_t>& content)
+    {
+        content.resize(sizeof(Header));
+
+        Header* header = reinterpret_cast<Header*>(content.data());
+
+        header->Magic = Magic;
+        header->Version = Version;
+        header->RecordSize = sizeof(Record);
+
+        for (const Lease& lease : leases) {
+            const size_t offset = content.size();
+
+            content.resize(offset + sizeof(Record) + lease.Id().Length());
+            Fill(&content[offset], GRANTED, lease);
+        }
+    }
+
+    /* static */ uint16_t DHCPServerImplementation::LeaseLog::Fill(uint8_t buffer[], const type kind, const Lease& lease)
+    {
+        Record* record = reinterpret_cast<Record*>(buffer);
+
+        record->Type = kind;
+        record->Length = lease.Id().Length();
+        record->Reserved[0] = 0;
+        record->Reserved[1] = 0;
+        record->Address = lease.Raw();
+        record->Expiration = lease.Expiration();
+        ::memcpy(&buffer[sizeof(Record)], lease.Id().Id(), record->Length);
+
+        return (sizeof(Record) + record->Length);
     }
 
     /* static */ Core::ProxyPoolType<DHCPServerImplementation::Response> DHCPServerImplementation::_responseFactory(2);
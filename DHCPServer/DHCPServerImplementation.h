@@ -22,6 +22,19 @@
 
 #include "Module.h"
 
+#ifndef __WINDOWS__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <queue>
+#include <unordered_map>
+
+#ifdef __WINDOWS__
+#include <intrin.h>
+#endif
+
 namespace WPEFramework {
 
 namespace Plugin {
@@ -33,6 +46,7 @@ namespace Plugin {
         DHCPServerImplementation& operator=(const DHCPServerImplementation&) = delete;
 
         static constexpr uint32_t DefaultLeaseTime = 24; // hours
+        static constexpr uint32_t MaxSweepInterval = 60; // seconds
 
         // RFC 2131 section 2
         enum operations {
@@ -259,6 +273,16 @@ namespace Plugin {
                 Core::ToHexString(Id(), _length, text);
                 return (text);
             }
+            // FNV-1a, identifiers are short and mostly MAC addresses.
+            inline size_t Hash() const
+            {
+                const uint8_t* id = Id();
+                size_t result = 2166136261u;
+                for (uint8_t index = 0; index < _length; index++) {
+                    result = (result ^ id[index]) * 16777619u;
+                }
+                return (result);
+            }
         public:
             static constexpr uint16_t maxLength = 16;
         private:
@@ -440,14 +464,41 @@ namespace Plugin {
             uint32_t _preferred;
             classifications _classification;
         };
+        // All leases, with indexes on client identifier and address, a bitmap of the pool addresses that are
+        // not leased and a heap ordered on expiration. The leases themselves stay in a list, so the
+        // pointers handed out remain valid and the Iterator keeps working. Changes to a lease go through this
+        // class, so the indexes stay in sync. All methods must be called with the lock taken.
         class LeaseList : public std::list<Lease> {
         private:
             LeaseList(const LeaseList&) = delete;
             LeaseList& operator=(const LeaseList&) = delete;
 
+            struct IdentifierHash {
+                inline size_t operator()(const Identifier& id) const
+                {
+                    return (id.Hash());
+                }
+            };
+
+            // Expiration and address of a lease at the time it was pushed. An entry is stale once the lease got
+            // another expiration, stale entries are dropped when they come up.
+            typedef std::pair<uint64_t, uint32_t> Deadline;
+            typedef std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> Deadlines;
+
+            // Do not add leases behind the back of the indexes.
+            using std::list<Lease>::push_back;
+            using std::list<Lease>::emplace_back;
+
         public:
             LeaseList()
                 : std::list<Lease>()
+                , _byId()
+                , _byAddress()
+                , _deadlines()
+                , _minAddress(0)
+                , _maxAddress(0)
+                , _free()
+                , _cursor(0)
             {
             }
             ~LeaseList()
@@ -472,8 +523,275 @@ namespace Plugin {
                 _adminLock.Unlock();
             }
 
+            // Set the pool, [minAddress, maxAddress], and mark what is not leased yet as free.
+            void Pool(const uint32_t minAddress, const uint32_t maxAddress)
+            {
+                const uint32_t count = (maxAddress >= minAddress ? (maxAddress - minAddress + 1) : 0);
+
+                _minAddress = minAddress;
+                _maxAddress = maxAddress;
+                _cursor = 0;
+                _free.assign((count + 63) / 64, ~static_cast<uint64_t>(0));
+
+                if ((count % 64) != 0) {
+                    // The tail of the last word is outside of the pool.
+                    _free.back() = (static_cast<uint64_t>(1) << (count % 64)) - 1;
+                }
+
+                for (const Lease& lease : *this) {
+                    Taken(lease.Raw());
+                }
+            }
+            inline Lease* Find(const uint32_t address)
+            {
+                AddressMap::iterator index(_byAddress.find(address));
+                return (index != _byAddress.end() ? &(*(index->second)) : nullptr);
+            }
+            inline Lease* Find(const Identifier& id)
+            {
+                IdMap::iterator index(_byId.find(id));
+                return (index != _byId.end() ? index->second : nullptr);
+            }
+            // Returns nullptr if the address is leased already.
+            Lease* Create(const Identifier& id, const uint32_t address, const uint64_t expiration = 0)
+            {
+                Lease* result = nullptr;
+
+                if (_byAddress.find(address) == _byAddress.end()) {
+                    std::list<Lease>::emplace_back(id, address, expiration);
+                    result = &(std::list<Lease>::back());
+
+                    _byAddress.emplace(address, std::prev(std::list<Lease>::end()));
+                    _byId[id] = result;
+                    _deadlines.emplace(expiration, address);
+                    Taken(address);
+                }
+
+                return (result);
+            }
+            // Hand an existing lease to another client.
+            void Assign(Lease& lease, const Identifier& id)
+            {
+                IdMap::iterator index(_byId.find(lease.Id()));
+
+                if ((index != _byId.end()) && (index->second == &lease)) {
+                    _byId.erase(index);
+                }
+
+                lease.Update(id);
+                _byId[id] = &lease;
+            }
+            void Expiration(Lease& lease, const uint64_t time)
+            {
+                lease.Expiration(time);
+                _deadlines.emplace(time, lease.Raw());
+
+                if (_deadlines.size() > ((2 * size()) + 64)) {
+                    Compact();
+                }
+            }
+            // Drop the lease, its address is free again.
+            void Remove(const Lease& lease)
+            {
+                AddressMap::iterator index(_byAddress.find(lease.Raw()));
+
+                if (index != _byAddress.end()) {
+                    IdMap::iterator id(_byId.find(lease.Id()));
+
+                    if ((id != _byId.end()) && (id->second == &lease)) {
+                        _byId.erase(id);
+                    }
+
+                    Released(lease.Raw());
+                    std::list<Lease>::erase(index->second);
+                    _byAddress.erase(index);
+                }
+            }
+            // A pool address that is not leased, 0 if there is none.
+            uint32_t Free()
+            {
+                uint32_t result = 0;
+                const uint32_t words = static_cast<uint32_t>(_free.size());
+
+                for (uint32_t count = 0; (count < words) && (result == 0); count++) {
+                    const uint32_t word = ((_cursor + count) % words);
+
+                    if (_free[word] != 0) {
+                        _cursor = word;
+                        result = _minAddress + (word * 64) + LowestBit(_free[word]);
+                    }
+                }
+
+                return (result);
+            }
+            // The lease that expired first, nullptr if none has expired.
+            Lease* Expired(const uint64_t now)
+            {
+                Lease* result = nullptr;
+
+                while ((result == nullptr) && (_deadlines.empty() == false) && (_deadlines.top().first < now)) {
+                    Lease* lease = Find(_deadlines.top().second);
+
+                    if ((lease != nullptr) && (lease->Expiration() == _deadlines.top().first)) {
+                        // Keep the entry, it goes stale as soon as the lease gets a new expiration.
+                        result = lease;
+                    } else {
+                        _deadlines.pop();
+                    }
+                }
+
+                return (result);
+            }
+            // When the next lease expires, ~0 if there are no leases.
+            uint64_t NextExpiration()
+            {
+                uint64_t result = ~static_cast<uint64_t>(0);
+
+                while ((result == ~static_cast<uint64_t>(0)) && (_deadlines.empty() == false)) {
+                    const Lease* lease = Find(_deadlines.top().second);
+
+                    if ((lease != nullptr) && (lease->Expiration() == _deadlines.top().first)) {
+                        result = _deadlines.top().first;
+                    } else {
+                        _deadlines.pop();
+                    }
+                }
+
+                return (result);
+            }
+
+        private:
+            typedef std::unordered_map<Identifier, Lease*, IdentifierHash> IdMap;
+            typedef std::unordered_map<uint32_t, std::list<Lease>::iterator> AddressMap;
+
+            // Leases outside of the pool, e.g. loaded before the pool got smaller, have no bit. Releasing one
+            // must not set a bit past the end of the pool, Free() would hand out that address.
+            inline bool InPool(const uint32_t address) const
+            {
+                return ((address >= _minAddress) && (address <= _maxAddress));
+            }
+            inline void Taken(const uint32_t address)
+            {
+                if (InPool(address) == true) {
+                    const uint32_t offset = (address - _minAddress);
+                    _free[offset / 64] &= ~(static_cast<uint64_t>(1) << (offset % 64));
+                }
+            }
+            inline void Released(const uint32_t address)
+            {
+                if (InPool(address) == true) {
+                    const uint32_t offset = (address - _minAddress);
+                    _free[offset / 64] |= (static_cast<uint64_t>(1) << (offset % 64));
+                }
+            }
+            // Index of the lowest bit set, the value must not be 0.
+            static inline uint32_t LowestBit(const uint64_t value)
+            {
+#ifdef __WINDOWS__
+                unsigned long result;
+                _BitScanForward64(&result, value);
+                return (static_cast<uint32_t>(result));
+#else
+                return (static_cast<uint32_t>(__builtin_ctzll(value)));
+#endif
+            }
+            void Compact()
+            {
+                Deadlines fresh;
+
+                for (const Lease& lease : *this) {
+                    fresh.emplace(lease.Expiration(), lease.Raw());
+                }
+
+                _deadlines.swap(fresh);
+            }
+
         private:
             mutable Core::CriticalSection _adminLock;
+            IdMap _byId;
+            AddressMap _byAddress;
+            Deadlines _deadlines;
+            uint32_t _minAddress;
+            uint32_t _maxAddress;
+            std::vector<uint64_t> _free; // Bit set: the address is not leased
+            uint32_t _cursor; // Word to start looking for a free address
+        };
+
+        // Persistent copy of the granted leases: an append only file with a record per grant or reclaim,
+        // followed by the client identifier. Loading replays it, the last record per address wins. It is rewritten with only the
+        // live leases when loaded and whenever it holds twice as many records as there are leases.
+        // Records are written as they come, syncing them to disk and rewriting the file is left to a worker job, so
+        // the socket thread does not wait for the disk and a burst of grants shares a single sync. Not supported on
+        // Windows.
+        class LeaseLog {
+        private:
+            LeaseLog(const LeaseLog&) = delete;
+            LeaseLog& operator=(const LeaseLog&) = delete;
+
+            static constexpr uint32_t Magic = 0x4C504844; // "DHPL"
+            static constexpr uint16_t Version = 1;
+
+            enum type : uint8_t {
+                GRANTED = 1,
+                RECLAIMED = 2
+            };
+
+#pragma pack(push, 1)
+            struct Header {
+                uint32_t Magic;
+                uint16_t Version;
+                uint16_t RecordSize;
+            };
+            struct Record {
+                uint8_t Type;
+                uint8_t Length; // Of the identifier
+                uint8_t Reserved[2];
+                uint32_t Address;
+                uint64_t Expiration;
+            };
+#pragma pack(pop)
+
+        public:
+            LeaseLog();
+            ~LeaseLog();
+
+        public:
+            // Adds the leases in the file to the list. An empty path disables the log. The list is kept to rewrite
+            // the log from, until it is closed. Neither is to be called with the lock of the list taken, the job
+            // takes it.
+            uint32_t Open(const string& path, LeaseList& leases);
+            void Close();
+            void Granted(const Lease& lease, const LeaseList& leases)
+            {
+                Append(GRANTED, lease, leases);
+            }
+            void Reclaimed(const Lease& lease, const LeaseList& leases)
+            {
+                Append(RECLAIMED, lease, leases);
+            }
+
+            // Worker pool job, rewrites the log if it grew too large and syncs the records written so far.
+            void Dispatch();
+
+        private:
+            void Append(const type kind, const Lease& lease, const LeaseList& leases);
+            void Compact();
+            int Store(const std::vector<uint8_t>& content) const;
+            bool Replace(const int fd);
+            static void Snapshot(const LeaseList& leases, std::vector<uint8_t>& content);
+            static uint16_t Fill(uint8_t buffer[], const type kind, const Lease& lease);
+
+        private:
+            Core::CriticalSection _lock;
+            string _path;
+            int _fd;
+            uint32_t _records;
+            const LeaseList* _leases;
+            bool _compact;
+            bool _compacting;
+            std::vector<uint8_t> _tail; // Records appended while the log is being rewritten
+            uint32_t _tailRecords;
+            Core::WorkerPool::JobType<LeaseLog&> _job;
         };
 
         class Response {
@@ -667,10 +985,15 @@ namespace Plugin {
         };
     public:
         typedef Core::LockableIteratorType<const LeaseList, const Lease&, LeaseList::const_iterator> Iterator;
-        typedef std::function<void(const string&, Lease*)> IPRequestCallback; 
+        enum event : uint8_t {
+            LEASE_GRANTED,
+            LEASE_EXPIRED
+        };
+
+        typedef std::function<void(const string&, const Lease*, const event)> IPRequestCallback;
 
     public:
-        DHCPServerImplementation(const string& serverName, const string& interfaceName, const uint32_t poolStart, const uint32_t poolSize, const uint32_t router, const Core::NodeId& DNS, const IPRequestCallback& ipRequestCallback)
+        DHCPServerImplementation(const string& serverName, const string& interfaceName, const uint32_t poolStart, const uint32_t poolSize, const uint32_t router, const Core::NodeId& DNS, const string& storage, const IPRequestCallback& ipRequestCallback)
             : Core::SocketDatagram(false, Core::NodeId("255.255.255.255", DefaultDHCPServerPort), Core::NodeId("255.255.255.255", DefaultDHCPClientPort), 1024, 16384)
             , _serverName(Core::ToString(serverName))
             , _interfaceName(interfaceName)
@@ -678,13 +1001,15 @@ namespace Plugin {
             , _poolSize(poolSize)
             , _minAddress(0)
             , _maxAddress(0)
-            , _nextFreeIp(0)
             , _server(0)
             , _router(router)
             , _dns(~0)
             , _leases()
+            , _log()
+            , _storage(storage.empty() ? storage : storage + interfaceName + _T(".leases"))
             , _responses()
             , _ipRequestCallback(ipRequestCallback)
+            , _sweeper(*this)
         {
             static_assert(sizeof(uint32_t) == 4, "Incorrect architecture chosen. uint32_t must by 4 bytes");
 
@@ -694,6 +1019,7 @@ namespace Plugin {
         }
         virtual ~DHCPServerImplementation()
         {
+            _sweeper.Revoke();
         }
 
     public:
@@ -723,11 +1049,15 @@ namespace Plugin {
             info.s_addr = htonl(_maxAddress);
             return (Core::NodeId(info));
         }
+        inline const string& Storage() const
+        {
+            return (_storage);
+        }
 
         inline void AddLease(const Lease& lease)
         {
             _leases.Lock();
-            _leases.push_back(lease);
+            _leases.Create(lease.Id(), lease.Raw(), lease.Expiration());
             _leases.Unlock();
         }
 
@@ -744,47 +1074,22 @@ namespace Plugin {
         uint32_t Close();
 
     private:
-        // NOTE:
-        // The next three methods, Find,Find and Create need to be executed within the lock.
-        inline Lease* Find(const uint32_t address)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Raw() != address)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Find(const Identifier& id)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Id() != id)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Create(const Identifier& id, const uint32_t address)
-        {
-            _leases.push_back(Lease(id, address));
-            return &(_leases.back());
-        }
         void Discover(Response& response, const ScratchPad& scratchPad)
         {
             _leases.Lock();
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
 
             // RFC 2131 section 4.3.1
             if ((result == nullptr) && (scratchPad.RequestedIP() != 0)) {
                 // Make sure the preferred IP address is within the pool, otherwise offer a correct one anyway
                 if ((scratchPad.RequestedIP() >= _minAddress) && (scratchPad.RequestedIP() <= _maxAddress)) {
-                    result = Find(scratchPad.RequestedIP());
+                    result = _leases.Find(scratchPad.RequestedIP());
 
                     if (result == nullptr) {
                         // Ip address has not been taken yet, time to "assign" it to this client.
-                        result = Create(scratchPad.Id(), scratchPad.RequestedIP());
+                        result = _leases.Create(scratchPad.Id(), scratchPad.RequestedIP());
                     } else if (result->IsExpired() == true) {
-                        result->Update(scratchPad.Id());
+                        _leases.Assign(*result, scratchPad.Id());
                     } else {
                         // IP address is taken
                         result = nullptr;
@@ -794,24 +1099,16 @@ namespace Plugin {
 
             if (result == nullptr) {
                 // First look in previously unallocated IP slots
-                uint32_t ip;
-                for (ip = _nextFreeIp; ip <= _maxAddress; ip++) {
-                    if (Find(ip) == nullptr) {
-                        result = Create(scratchPad.Id(), ip);
-                        _nextFreeIp = (ip + 1);
-                        break;
-                    }
-                }
+                const uint32_t ip = _leases.Free();
 
-                if (result == nullptr) {
-                    // Still not found a free IP slot, attempt picking up one of the expired ones
-                    for (ip = _minAddress; ip <= _maxAddress ; ip++) {
-                        Lease* lease = Find(ip);
-                        if ((lease != nullptr) && (lease->IsExpired() == true)) {
-                            result = lease;
-                            result->Update(scratchPad.Id());
-                            break;
-                        }
+                if (ip != 0) {
+                    result = _leases.Create(scratchPad.Id(), ip);
+                } else {
+                    // Still not found a free IP slot, attempt picking up the one that expired first
+                    result = _leases.Expired(Core::Time::Now().Ticks());
+
+                    if (result != nullptr) {
+                        _leases.Assign(*result, scratchPad.Id());
                     }
                 }
             }
@@ -823,7 +1120,7 @@ namespace Plugin {
                     // Temporarily lock out the offered IP address until the client actually requests it
                     Core::Time timeout = Core::Time::Now();
                     timeout.Add(60 /* sec */ * 1000);
-                    result->Expiration(timeout.Ticks());
+                    _leases.Expiration(*result, timeout.Ticks());
                 }
 
                 response.Offer(result->Raw());
@@ -837,7 +1134,7 @@ namespace Plugin {
             _leases.Lock();
 
             // RFC 2131 section 4.3.2 Determine requested IP address
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
             uint32_t serverId = scratchPad.ServerIdentifier();
             uint32_t requested = scratchPad.RequestedIP();
             
@@ -848,16 +1145,40 @@ namespace Plugin {
                 Core::Time leaseExp = Core::Time::Now();
                 leaseExp.Add(DefaultLeaseTime * (60 /* min */ * 60 * 1000));
                 response.LeaseTime(DefaultLeaseTime);
-                result->Expiration(leaseExp.Ticks());
-                _ipRequestCallback(_interfaceName, result);
+                _leases.Expiration(*result, leaseExp.Ticks());
+                _log.Granted(*result, _leases);
+                _ipRequestCallback(_interfaceName, result, LEASE_GRANTED);
             } else {
                 if (result != nullptr) {
-                    result->Expiration(0); // Invalidate
+                    _leases.Expiration(*result, 0); // Invalidate
                 }
             }
 
             _leases.Unlock();
         }
+        // Reclaim the addresses of the leases that expired, and come back when the next one expires.
+        void Dispatch()
+        {
+            const uint64_t now = Core::Time::Now().Ticks();
+            Lease* lease;
+
+            _leases.Lock();
+
+            while ((lease = _leases.Expired(now)) != nullptr) {
+                _ipRequestCallback(_interfaceName, lease, LEASE_EXPIRED);
+                _log.Reclaimed(*lease, _leases);
+                _leases.Remove(*lease);
+            }
+
+            // Leases that get an earlier expiration in the mean time wait for the next round at most.
+            const uint64_t next = std::min(_leases.NextExpiration(), Core::Time(now).Add(MaxSweepInterval * 1000).Ticks());
+
+            _leases.Unlock();
+
+            if (IsOpen() == true) {
+                _sweeper.Schedule(Core::Time(std::max(next, Core::Time(now).Add(1000).Ticks())));
+            }
+        }
         void Submit(const Core::ProxyType<Response> entry)
         {
             _responses.push_back(entry);
@@ -956,13 +1277,17 @@ namespace Plugin {
         uint32_t _poolSize;
         uint32_t _minAddress;
         uint32_t _maxAddress;
-        uint32_t _nextFreeIp;
         uint32_t _server;
         uint32_t _router;
         uint32_t _dns;
         LeaseList _leases;
+        LeaseLog _log;
+        const string _storage;
         std::list<Core::ProxyType<Response>> _responses;
         const IPRequestCallback _ipRequestCallback;
+        Core::WorkerPool::JobType<DHCPServerImplementation&> _sweeper;
+
+        friend Core::ThreadPool::JobType<DHCPServerImplementation&>;
 
 
         static Core::ProxyPoolType<Response> _responseFactory;
@@ -0,0 +1,305 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmark of Get and Set of the dictionary, at a small, a medium and a large namespace. It drives the
+// plugin through its IDictionary interface, without the framework. The plugin is not initialized, so nothing
+// is journaled, only the notifier runs. Build it with -DPLUGIN_DICTIONARY_BENCHMARK=ON.
+
+#include "../Dictionary.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // The notifier of the dictionary sends out its changes from a worker job.
+    class WorkerPoolImplementation : public Core::WorkerPool {
+    private:
+        class Dispatcher : public Core::ThreadPool::IDispatcher {
+        public:
+            Dispatcher(const Dispatcher&) = delete;
+            Dispatcher& operator=(const Dispatcher&) = delete;
+
+            Dispatcher()
+            {
+            }
+            ~Dispatcher() override
+            {
+            }
+
+        private:
+            void Initialize() override
+            {
+            }
+            void Deinitialize() override
+            {
+            }
+            void Dispatch(Core::IDispatch* job) override
+            {
+                job->Dispatch();
+            }
+        };
+
+    public:
+        WorkerPoolImplementation() = delete;
+        WorkerPoolImplementation(const WorkerPoolImplementation&) = delete;
+        WorkerPoolImplementation& operator=(const WorkerPoolImplementation&) = delete;
+
+        WorkerPoolImplementation(const uint8_t threads, const uint32_t stackSize, const uint32_t queueSize)
+            : Core::WorkerPool(threads, stackSize, queueSize, &_dispatcher)
+            , _dispatcher()
+        {
+            Run();
+        }
+        ~WorkerPoolImplementation()
+        {
+            Stop();
+        }
+
+    private:
+        Dispatcher _dispatcher;
+    };
+
+    class DictionaryBenchmark {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        // Tells when the notifier has sent out the last change, so the dictionary can go.
+        class Observer : public Exchange::IDictionary::INotification {
+        public:
+            Observer(const Observer&) = delete;
+            Observer& operator=(const Observer&) = delete;
+
+            Observer()
+                : _done(false, true)
+            {
+            }
+            ~Observer() override
+            {
+            }
+
+        public:
+            void Modified(const string&, const string&, const string&) override
+            {
+                _done.SetEvent();
+            }
+            bool Wait(const uint32_t waitTime)
+            {
+                return (_done.Lock(waitTime) == Core::ERROR_NONE);
+            }
+
+            BEGIN_INTERFACE_MAP(Observer)
+            INTERFACE_ENTRY(Exchange::IDictionary::INotification)
+            END_INTERFACE_MAP
+
+        private:
+            Core::Event _done;
+        };
+
+        static constexpr uint16_t BatchSize = 100;
+        static constexpr uint32_t DrainTime = 10000; // ms
+
+        DictionaryBenchmark() = delete;
+        DictionaryBenchmark(const DictionaryBenchmark&) = delete;
+        DictionaryBenchmark& operator=(const DictionaryBenchmark&) = delete;
+
+    public:
+        DictionaryBenchmark(Exchange::IDictionary& dictionary, const uint32_t lookups, const uint16_t readers)
+            : _dictionary(dictionary)
+            , _lookups(lookups)
+            , _readers(readers)
+            , _observer()
+        {
+        }
+        ~DictionaryBenchmark()
+        {
+        }
+
+    public:
+        void Run(const uint32_t keys)
+        {
+            const string nameSpace(_T("benchmark.") + Core::NumberType<uint32_t>(keys).Text());
+            std::vector<string> names;
+            std::vector<uint32_t> order;
+            std::mt19937 generator(42);
+
+            for (uint32_t index = 0; index < keys; index++) {
+                names.push_back(_T("key.") + Core::NumberType<uint32_t>(index).Text());
+            }
+
+            // Look the keys up in a random order, so the dictionary does not profit from the insertion order.
+            for (uint32_t index = 0; index < _lookups; index++) {
+                order.push_back(generator() % keys);
+            }
+
+            std::cout << "Keys: " << keys << ", lookups: " << _lookups << ", readers: " << _readers << std::endl;
+
+            Report("set, new key", Measure([&]() {
+                for (const string& name : names) {
+                    _dictionary.Set(nameSpace, name, name);
+                }
+            }), keys);
+
+            Report("set, changed value", Measure([&]() {
+                for (const string& name : names) {
+                    _dictionary.Set(nameSpace, name, name + '\'');
+                }
+            }), keys);
+
+            Report("get", Measure([&]() {
+                string value;
+
+                for (const uint32_t key : order) {
+                    _dictionary.Get(nameSpace, names[key], value);
+                }
+            }), _lookups);
+
+            Report("concurrent get", Concurrent([&]() {
+                string value;
+
+                for (const uint32_t key : order) {
+                    _dictionary.Get(nameSpace, names[key], value);
+                }
+            }), static_cast<uint64_t>(_lookups) * _readers);
+        }
+
+        // Wait for the notifier to catch up with all changes made so far.
+        bool Drain()
+        {
+            static const string nameSpace(_T("benchmark.drain"));
+
+            _dictionary.Register(nameSpace, &_observer);
+            _dictionary.Set(nameSpace, _T("done"), _T("yes"));
+
+            const bool result = _observer.Wait(DrainTime);
+
+            _dictionary.Unregister(nameSpace, &_observer);
+
+            return (result);
+        }
+
+    private:
+        template <typename ACTION>
+        static uint64_t Measure(ACTION&& action)
+        {
+            const Clock::time_point start = Clock::now();
+
+            action();
+
+            return (std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        }
+        // The same action on all reader threads at once, the time is until the last one is done.
+        template <typename ACTION>
+        uint64_t Concurrent(ACTION&& action) const
+        {
+            std::vector<std::thread> threads;
+
+            return (Measure([&]() {
+                for (uint16_t index = 0; index < _readers; index++) {
+                    threads.emplace_back(action);
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+            }));
+        }
+        static void Report(const char label[], const uint64_t duration, const uint64_t operations)
+        {
+            std::cout << "  " << label << ": " << (duration / 1000000) << " ms, "
+                      << (operations == 0 ? 0 : (duration / operations)) << " ns per operation" << std::endl;
+        }
+
+    private:
+        Exchange::IDictionary& _dictionary;
+        const uint32_t _lookups;
+        const uint16_t _readers;
+        Core::Sink<Observer> _observer;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
+
+int main(int argc, char** argv)
+{
+    std::vector<uint32_t> sizes({ 10, 1000, 100000 });
+    uint32_t lookups = 1000000;
+    uint16_t readers = 4;
+    int option;
+    int result = 0;
+
+    while ((option = ::getopt(argc, argv, "k:n:t:h")) != -1) {
+        switch (option) {
+        case 'k':
+            // Only the given size, instead of the whole sweep.
+            sizes.assign(1, static_cast<uint32_t>(std::max(1, std::atoi(optarg))));
+            break;
+        case 'n':
+            lookups = static_cast<uint32_t>(std::max(1, std::atoi(optarg)));
+            break;
+        case 't':
+            readers = static_cast<uint16_t>(std::max(1, std::atoi(optarg)));
+            break;
+        default:
+            std::cout << "Usage: " << argv[0] << " [-k keys per namespace, default 10, 1000 and 100000] [-n lookups per run] [-t reader threads]" << std::endl;
+            return (option == 'h' ? 0 : 1);
+        }
+    }
+
+    {
+        WPEFramework::Plugin::WorkerPoolImplementation workerPool(2, WPEFramework::Core::Thread::DefaultStackSize(), 16);
+
+        WPEFramework::Core::IWorkerPool::Assign(&workerPool);
+
+        WPEFramework::Exchange::IDictionary* dictionary = WPEFramework::Core::Service<WPEFramework::Plugin::Dictionary>::Create<WPEFramework::Exchange::IDictionary>();
+
+        {
+            WPEFramework::Plugin::DictionaryBenchmark benchmark(*dictionary, lookups, readers);
+
+            for (const uint32_t keys : sizes) {
+                benchmark.Run(keys);
+            }
+
+            if (benchmark.Drain() == false) {
+                std::cout << "The notifier did not catch up, leaving the dictionary behind." << std::endl;
+                result = 1;
+            }
+
+            // The notifier job may still hold the observer, let it finish before the observer goes.
+            workerPool.Stop();
+        }
+
+        if (result == 0) {
+            dictionary->Release();
+        }
+
+        WPEFramework::Core::IWorkerPool::Assign(nullptr);
+    }
+
+    WPEFramework::Core::Singleton::Dispose();
+
+    return (result);
+}
@@ -19,6 +19,12 @@
  
 #include "Dictionary.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace WPEFramework {
 
 ENUM_CONVERSION_BEGIN(Plugin::Dictionary::enumType)
@@ -41,12 +47,354 @@ namespace Plugin {
         return ((value.empty() == false) && (value.find_first_of(Dictionary::NameSpaceDelimiter, 0) == static_cast<size_t>(~0)));
     }
 
+    // Journal record layout, in host byte order:
+    //   uint32_t length of the body
+    //   uint32_t FNV-1a checksum of the body
+    //   body: uint8_t type, uint16_t namespace length, uint16_t key length, namespace, key, value
+    static constexpr uint32_t RecordHeaderSize = (2 * sizeof(uint32_t));
+    static constexpr uint32_t RecordBodyHeaderSize = (sizeof(uint8_t) + (2 * sizeof(uint16_t)));
+
+    // An entry the journal can not describe is refused, a truncated length would corrupt the replay.
+    static bool Fits(const string& nameSpace, const string& key, const string& value)
+    {
+        return ((nameSpace.length() <= std::numeric_limits<uint16_t>::max()) && (key.length() <= std::numeric_limits<uint16_t>::max()) && (value.length() <= (std::numeric_limits<uint32_t>::max() - RecordBodyHeaderSize - nameSpace.length() - key.length())));
+    }
+
+    static uint32_t Checksum(const uint8_t data[], const uint32_t length)
+    {
+        uint32_t result = 2166136261;
+
+        for (uint32_t index = 0; index < length; index++) {
+            result = (result ^ data[index]) * 16777619;
+        }
+
+        return (result);
+    }
+
+    // Write all of it, or report failure.
+    static bool WriteAll(const int fd, const uint8_t data[], const uint32_t length)
+    {
+        uint32_t offset = 0;
+
+        while (offset < length) {
+            ssize_t written = ::write(fd, &(data[offset]), length - offset);
+
+            if (written > 0) {
+                offset += static_cast<uint32_t>(written);
+            } else if ((written < 0) && (errno != EINTR)) {
+                break;
+            }
+        }
+
+        return (offset == length);
+    }
+
+    // A rename is only durable once the directory holding it is synced.
+    static void SyncDirectory(const string& fileName)
+    {
+        const size_t slash = fileName.find_last_of('/');
+        const string directory(slash == string::npos ? string(_T(".")) : fileName.substr(0, slash + 1));
+        int fd = ::open(directory.c_str(), O_RDONLY);
+
+        if (fd != -1) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    bool Dictionary::Journal::Open(const string& storage, const uint32_t syncTime, const uint32_t limit)
+    {
+        struct stat info;
+
+        _lock.Lock();
+
+        ASSERT(_fd == -1);
+
+        _storage = storage;
+        _syncTime = syncTime;
+        _limit = limit;
+        _rotated = (::stat(Rotated(storage).c_str(), &info) == 0);
+        _fd = ::open(Log(storage).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        _size = ((_fd != -1) && (::fstat(_fd, &info) == 0) ? static_cast<uint32_t>(info.st_size) : 0);
+
+        _lock.Unlock();
+
+        if (_fd == -1) {
+            SYSLOG(Logging::Startup, (_T("Could not open the dictionary journal %s, changes will not be persisted."), Log(storage).c_str()));
+        }
+
+        return (_fd != -1);
+    }
+
+    void Dictionary::Journal::Close()
+    {
+        _job.Revoke();
+
+        _lock.Lock();
+
+        if (_fd != -1) {
+            Sync();
+            ::close(_fd);
+            _fd = -1;
+        }
+        _scheduled = false;
+
+        _lock.Unlock();
+    }
+
+    void Dictionary::Journal::Append(const string& nameSpace, const string& key, const string& value, const enumType type)
+    {
+        // Set and SetMany refuse what does not fit.
+        ASSERT(Fits(nameSpace, key, value) == true);
+
+        const uint32_t length = static_cast<uint32_t>(RecordBodyHeaderSize + nameSpace.length() + key.length() + value.length());
+        const uint16_t spaceLength = static_cast<uint16_t>(nameSpace.length());
+        const uint16_t keyLength = static_cast<uint16_t>(key.length());
+        const uint8_t recordType = static_cast<uint8_t>(type);
+        uint32_t checksum;
+
+        _lock.Lock();
+
+        if (_fd != -1) {
+            const size_t start = _pending.length();
+
+            _pending.resize(start + RecordHeaderSize);
+            _pending.append(reinterpret_cast<const char*>(&recordType), sizeof(recordType));
+            _pending.append(reinterpret_cast<const char*>(&spaceLength), sizeof(spaceLength));
+            _pending.append(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+            _pending.append(nameSpace);
+            _pending.append(key);
+            _pending.append(value);
+
+            checksum = Checksum(reinterpret_cast<const uint8_t*>(&(_pending[start + RecordHeaderSize])), length);
+            ::memcpy(&(_pending[start]), &length, sizeof(length));
+            ::memcpy(&(_pending[start + sizeof(length)]), &checksum, sizeof(checksum));
+
+            if (_scheduled == false) {
+                _scheduled = true;
+                _job.Schedule(Core::Time::Now().Add(_syncTime));
+            }
+        }
+
+        _lock.Unlock();
+    }
+
+    void Dictionary::Journal::Dispatch()
+    {
+        bool compact;
+
+        _lock.Lock();
+
+        _scheduled = false;
+
+        if (_fd != -1) {
+            Sync();
+
+            if ((_pending.empty() == false) && (_scheduled == false)) {
+                // The write failed, try again later.
+                _scheduled = true;
+                _job.Schedule(Core::Time::Now().Add(_syncTime));
+            }
+        }
+
+        compact = ((_fd != -1) && (_size >= _limit));
+
+        _lock.Unlock();
+
+        if (compact == true) {
+            Compact();
+        }
+    }
+
+    // Must be called with the lock taken.
+    void Dictionary::Journal::Sync()
+    {
+        if (_pending.empty() == false) {
+            if (WriteAll(_fd, reinterpret_cast<const uint8_t*>(_pending.data()), static_cast<uint32_t>(_pending.length())) == false) {
+                TRACE_L1(_T("Could not write %d bytes to the dictionary journal, error: %d"), static_cast<uint32_t>(_pending.length()), errno);
+
+                // Cut off whatever part did make it, so no torn record sits in front of the next batch. The
+                // records stay pending for the next attempt.
+                if (::ftruncate(_fd, _size) != 0) {
+                    TRACE_L1(_T("Could not cut the dictionary journal back to %d bytes, error: %d"), _size, errno);
+                }
+            } else {
+                ::fdatasync(_fd);
+                _size += static_cast<uint32_t>(_pending.length());
+                _pending.clear();
+            }
+        }
+    }
+
+    void Dictionary::Journal::Compact()
+    {
+        NameSpace snapshot;
+        string text;
+
+        // Take the picture and move the log aside in one go, so every change is either in the snapshot or in
+        // the new log. Lock order is dictionary first, journal second, just like Set.
+        _parent._adminLock.ReadLock();
+        _lock.Lock();
+
+        if (_fd != -1) {
+            Sync();
+
+            _parent.CreateExternalDictionary(EMPTY_STRING, snapshot);
+
+            // If a previous snapshot failed, the moved log still holds changes that are in no snapshot yet,
+            // it can not be overwritten. Keep appending to the current log in that case.
+            if ((_rotated == false) && (::rename(Log(_storage).c_str(), Rotated(_storage).c_str()) == 0)) {
+                ::close(_fd);
+                _rotated = true;
+                _fd = ::open(Log(_storage).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+                _size = 0;
+            }
+        }
+
+        _lock.Unlock();
+        _parent._adminLock.ReadUnlock();
+
+        snapshot.IElement::ToString(text);
+
+        const string temporary(_storage + _T(".tmp"));
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+        if (fd != -1) {
+            bool written = ((WriteAll(fd, reinterpret_cast<const uint8_t*>(text.data()), static_cast<uint32_t>(text.length())) == true) && (::fdatasync(fd) == 0));
+
+            ::close(fd);
+
+            if ((written == true) && (::rename(temporary.c_str(), _storage.c_str()) == 0)) {
+                SyncDirectory(_storage);
+
+                _lock.Lock();
+                if (_rotated == true) {
+                    ::unlink(Rotated(_storage).c_str());
+                    _rotated = false;
+                }
+                _lock.Unlock();
+            } else {
+                ::unlink(temporary.c_str());
+            }
+        }
+    }
+
+    void Dictionary::Notifier::Dispatch()
+    {
+        PendingMap pending;
+
+        _lock.Lock();
+        pending.swap(_pending);
+        _lock.Unlock();
+
+        for (const std::pair<const string, Changes>& space : pending) {
+            std::list<struct Exchange::IDictionary::INotification*> sinks;
+
+            _parent._adminLock.ReadLock();
+
+            for (const std::pair<const string, struct Exchange::IDictionary::INotification*>& observer : _parent._observers) {
+                if (observer.first == space.first) {
+                    observer.second->AddRef();
+                    sinks.push_back(observer.second);
+                }
+            }
+
+            _parent._adminLock.ReadUnlock();
+
+            for (struct Exchange::IDictionary::INotification* sink : sinks) {
+                for (const std::pair<string, string>& change : space.second.Order()) {
+                    sink->Modified(space.first, change.first, change.second);
+                }
+                sink->Release();
+            }
+        }
+    }
+
+    /* static */ void Dictionary::Journal::Replay(const string& fileName, DictionaryMap& dictionary)
+    {
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CLOEXEC);
+
+        if (fd != -1) {
+            string content;
+            uint8_t buffer[4096];
+            ssize_t loaded;
+            uint32_t offset = 0;
+            uint32_t count = 0;
+
+            while (((loaded = ::read(fd, buffer, sizeof(buffer))) > 0) || ((loaded < 0) && (errno == EINTR))) {
+                if (loaded > 0) {
+                    content.append(reinterpret_cast<const char*>(buffer), loaded);
+                }
+            }
+
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(content.data());
+
+            // A record that runs up to, or past, the end of the file is torn by a crash during a write. A bad
+            // record with more data behind it is something else, it is left alone.
+            bool torn = true;
+
+            while ((content.length() - offset) >= RecordHeaderSize) {
+                uint32_t length;
+                uint32_t checksum;
+
+                ::memcpy(&length, &(data[offset]), sizeof(length));
+                ::memcpy(&checksum, &(data[offset + sizeof(length)]), sizeof(checksum));
+
+                if ((length < RecordBodyHeaderSize) || (length > (content.length() - offset - RecordHeaderSize)) || (Checksum(&(data[offset + RecordHeaderSize]), length) != checksum)) {
+                    torn = ((length >= RecordBodyHeaderSize) && (length >= (content.length() - offset - RecordHeaderSize)));
+
+                    // Blocks that were allocated but never written read back as zeros, that is a torn tail too.
+                    for (uint32_t index = offset; (torn == false) && (index < content.length()) && (data[index] == 0); index++) {
+                        torn = ((index + 1) == content.length());
+                    }
+                    break;
+                }
+
+                const uint8_t* body = &(data[offset + RecordHeaderSize]);
+                uint16_t spaceLength;
+                uint16_t keyLength;
+
+                ::memcpy(&spaceLength, &(body[sizeof(uint8_t)]), sizeof(spaceLength));
+                ::memcpy(&keyLength, &(body[sizeof(uint8_t) + sizeof(uint16_t)]), sizeof(keyLength));
+
+                if ((RecordBodyHeaderSize + spaceLength + keyLength) > length) {
+                    break;
+                }
+
+                const char* text = reinterpret_cast<const char*>(&(body[RecordBodyHeaderSize]));
+                const string nameSpace(text, spaceLength);
+                const string key(&(text[spaceLength]), keyLength);
+                const string value(&(text[spaceLength + keyLength]), length - RecordBodyHeaderSize - spaceLength - keyLength);
+
+                dictionary[nameSpace].Insert(key, value, static_cast<enumType>(body[0])).Value(value);
+
+                offset += (RecordHeaderSize + length);
+                count++;
+            }
+
+            if (offset != content.length()) {
+                if (torn == true) {
+                    TRACE_L1(_T("Dropping %d bytes of an incomplete record at the end of %s"), static_cast<uint32_t>(content.length() - offset), fileName.c_str());
+                    if (::ftruncate(fd, offset) == 0) {
+                        ::fdatasync(fd);
+                    }
+                } else {
+                    SYSLOG(Logging::Startup, (_T("Corrupt record at offset %d of %s, the remaining %d bytes are not replayed."), offset, fileName.c_str(), static_cast<uint32_t>(content.length() - offset)));
+                }
+            }
+
+            TRACE_L1(_T("Replayed %d changes from %s"), count, fileName.c_str());
+
+            ::close(fd);
+        }
+    }
+
     bool Dictionary::CreateInternalDictionary(const string& currentSpace, const NameSpace& current)
     {
         bool correctStructure(true);
         Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator keyIndex(current.Dictionary.Elements());
         Core::JSON::ArrayType<NameSpace>::ConstIterator spaceIndex(current.Spaces.Elements());
-        std::list<RuntimeEntry>* currentList = NULL;
+        KeySpace* currentList = NULL;
 
         // Fill in the keys from this name space...
         while ((correctStructure == true) && (keyIndex.Next() == true)) {
@@ -61,7 +409,7 @@ namespace Plugin {
                     ASSERT(currentList != NULL);
                 }
 
-                currentList->push_back(RuntimeEntry(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value()));
+                currentList->Insert(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value());
             }
         }
 
@@ -86,8 +434,8 @@ namespace Plugin {
                 NameSpace& blockToFill(current[index->first]);
 
                 // No we got the namespace bloc, fill in the keys..
-                const std::list<RuntimeEntry>& keyList(index->second);
-                std::list<RuntimeEntry>::const_iterator keyIndex(keyList.begin());
+                const std::vector<RuntimeEntry>& keyList(index->second.Entries());
+                std::vector<RuntimeEntry>::const_iterator keyIndex(keyList.begin());
 
                 while (keyIndex != keyList.end()) {
                     NameSpace::Entry& entry(blockToFill.Dictionary.Add(NameSpace::Entry()));
@@ -109,7 +457,8 @@ namespace Plugin {
     {
         _config.FromString(service->ConfigLine());
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+        const string storage(service->PersistentPath() + _config.Storage.Value());
+        Core::File dictionaryFile(storage);
 
         if (dictionaryFile.Open(true) == true) {
             NameSpace dictionary;
@@ -121,22 +470,25 @@ namespace Plugin {
             CreateInternalDictionary(EMPTY_STRING, dictionary);
         }
 
+        // Changes made after the snapshot was written, oldest log first.
+        Journal::Replay(Journal::Rotated(storage), _dictionary);
+        Journal::Replay(Journal::Log(storage), _dictionary);
+
+        Core::Directory(service->PersistentPath().c_str()).CreatePath();
+        _journal.Open(storage, _config.SyncTime.Value(), _config.JournalSize.Value() * 1024);
+
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
 
         // On succes return a name as a Callsign to be used in the URL, after the "service"prefix
         return (_T(""));
     }
 
-    /* virtual */ void Dictionary::Deinitialize(PluginHost::IShell* service)
+    /* virtual */ void Dictionary::Deinitialize(PluginHost::IShell* /* service */)
     {
+        _notifier.Revoke();
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
-
-        if (dictionaryFile.Open(true) == true) {
-            NameSpace dictionary;
-            CreateExternalDictionary(EMPTY_STRING, dictionary);
-            dictionary.IElement::ToFile(dictionaryFile);
-        }
+        // Everything is in the snapshot or the journal already, only the last batch needs to be written.
+        _journal.Close();
     }
 
     /* virtual */ string Dictionary::Information() const
@@ -147,12 +499,18 @@ namespace Plugin {
 
     /* virtual */ void Dictionary::Inbound(Web::Request& request)
     {
-        // There are no requests coming in with a body that require a JSON body. So continue without action here.
-        request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        // Only a batch of keys comes in as a JSON body, single values are plain text.
+        if (request.Verb == Web::Request::HTTP_PUT) {
+            request.Body(Core::ProxyType<Web::IBody>(jsonBodyDataFactory.Element()));
+        } else {
+            request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        }
     }
 
     // <GET> ../[namespace/]{Key}
-    // <PUT> ../[namespace/]{Key}?Type=[persistent|volatile|closure]
+    // <GET> ../[namespace]?Keys={Key},{Key},...
+    // <POST> ../[namespace/]{Key}?Type=[persistent|volatile|closure]
+    // <PUT> ../[namespace] with a JSON body holding the dictionary of keys to set
     /* virtual */ Core::ProxyType<Web::Response> Dictionary::Process(const Web::Request& request)
     {
         ASSERT(_skipURL <= request.Path.length());
@@ -178,7 +536,60 @@ namespace Plugin {
             key = index.Current().Text();
         }
 
-        if (request.Verb == Web::Request::HTTP_GET) {
+        // The batch requests address the namespace as a whole, the last part of the path is not a key.
+        string space(nameSpace);
+
+        if (key.empty() == false) {
+            if (space.empty() == true) {
+                space += NameSpaceDelimiter;
+            }
+            space += key;
+        }
+
+        Core::TextSegmentIterator queryIterator(Core::TextSegmentIterator(Core::TextFragment(request.Query), true, '='));
+
+        if ((request.Verb == Web::Request::HTTP_GET) && (queryIterator.Next() == true) && (queryIterator.Current() == _T("Keys"))) {
+            std::vector<string> keys;
+            KeyValues values;
+            Core::ProxyType<Web::JSONBodyType<Dictionary::NameSpace>> response(jsonBodyDataFactory.Element());
+
+            if (queryIterator.Next() == true) {
+                Core::TextSegmentIterator keyIterator(queryIterator.Current(), true, ',');
+
+                while (keyIterator.Next() == true) {
+                    keys.push_back(keyIterator.Current().Text());
+                }
+            }
+
+            GetMany(space, keys, values);
+
+            response->Clear();
+            for (const std::pair<string, string>& entry : values) {
+                response->Dictionary.Add(NameSpace::Entry(entry.first, entry.second, VOLATILE));
+            }
+
+            result->ContentType = Web::MIMETypes::MIME_JSON;
+            result->Body(Core::proxy_cast<Web::IBody>(response));
+        } else if ((request.Verb == Web::Request::HTTP_PUT) && (request.HasBody() == true)) {
+            Core::ProxyType<const Web::JSONBodyType<Dictionary::NameSpace>> body(request.Body<Web::JSONBodyType<Dictionary::NameSpace>>());
+            KeyValues values;
+            uint32_t changed = 0;
+
+            if (body.IsValid() == true) {
+                Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator entries(body->Dictionary.Elements());
+
+                while (entries.Next() == true) {
+                    values.emplace_back(entries.Current().Key.Value(), entries.Current().Value.Value());
+                }
+            }
+
+            if (SetMany(space, values, changed) != Core::ERROR_NONE) {
+                result->ErrorCode = Web::STATUS_BAD_REQUEST;
+                result->Message = _T("Invalid or too long key in the batch, nothing set.");
+            } else {
+                TRACE(Trace::Information, (_T("SetKeys ( %s, %d keys, %d changed)"), space.c_str(), static_cast<uint32_t>(values.size()), changed));
+            }
+        } else if (request.Verb == Web::Request::HTTP_GET) {
             string value;
             Core::ProxyType<Web::TextBody> valueBody(textBodyDataFactory.Element());
 
@@ -199,11 +610,16 @@ namespace Plugin {
                 keyType = Core::EnumerateType<Dictionary::enumType>(typeIterator.Current(), false).Value();
             }
 
-            TRACE(Trace::Information, (_T("SetKey ( %s, %s, %s)"), key.c_str(), value.c_str(), Core::EnumerateType<Dictionary::enumType>(keyType).Data()));
-            Set(nameSpace, key, value);
+            if (Fits(nameSpace, key, value) == false) {
+                result->ErrorCode = Web::STATUS_BAD_REQUEST;
+                result->Message = _T("Key or value too long.");
+            } else {
+                TRACE(Trace::Information, (_T("SetKey ( %s, %s, %s)"), key.c_str(), value.c_str(), Core::EnumerateType<Dictionary::enumType>(keyType).Data()));
+                Set(nameSpace, key, value);
 
-            result->ErrorCode = Web::STATUS_OK;
-            result->Message = _T("OK");
+                result->ErrorCode = Web::STATUS_OK;
+                result->Message = _T("OK");
+            }
         } else {
             result->ErrorCode = Web::STATUS_BAD_REQUEST;
             result->Message = _T("Bad request.");
@@ -216,25 +632,20 @@ namespace Plugin {
     {
         bool result = false;
 
-        _adminLock.Lock();
+        _adminLock.ReadLock();
 
         DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
 
         if (index != _dictionary.end()) {
-            const std::list<RuntimeEntry>& container(index->second);
-            std::list<RuntimeEntry>::const_iterator listIndex(container.begin());
-
-            while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-                listIndex++;
-            }
+            const RuntimeEntry* entry = index->second.Find(key);
 
-            if (listIndex != container.end()) {
+            if (entry != nullptr) {
                 result = true;
-                value = listIndex->Value();
+                value = entry->Value();
             }
         }
 
-        _adminLock.Unlock();
+        _adminLock.ReadUnlock();
 
         return (result);
     }
@@ -246,20 +657,42 @@ namespace Plugin {
 
         Exchange::IDictionary::IIterator* result = nullptr;
 
-        _adminLock.Lock();
+        _adminLock.ReadLock();
 
         DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
 
         if (index != _dictionary.end()) {
             Core::ProxyType<Iterator> entries(iterators.Element());
 
-            entries->Load(InternalIterator(index->second));
+            entries->Load(index->second.Entries());
 
             result = &(*entries);
             result->AddRef();
         }
 
-        _adminLock.Unlock();
+        _adminLock.ReadUnlock();
+
+        return (result);
+    }
+
+    // Must be called with the lock taken for writing.
+    bool Dictionary::Apply(KeySpace& container, const string& nameSpace, const string& key, const string& value)
+    {
+        bool result = false;
+        RuntimeEntry* entry = container.Find(key);
+
+        if (entry == nullptr) {
+            result = true;
+            entry = &(container.Insert(key, value, VOLATILE));
+        } else if (entry->Value() != value) {
+            result = true;
+            entry->Value(value);
+        }
+
+        if (result == true) {
+            _journal.Append(nameSpace, key, value, entry->Type());
+            _notifier.Modified(nameSpace, key, value);
+        }
 
         return (result);
     }
@@ -268,39 +701,72 @@ namespace Plugin {
     // NameSpace and key MUST be filled.
     /* virtual */ bool Dictionary::Set(const string& nameSpace, const string& key, const string& value)
     {
-        // Direct method to Set a value for a key in a certain namespace from the dictionary.
         bool result = false;
 
-        _adminLock.Lock();
+        if (Fits(nameSpace, key, value) == false) {
+            TRACE(Trace::Error, (_T("Key %s of namespace %s is too long to be journaled, it is not set"), key.c_str(), nameSpace.c_str()));
+        } else {
+            // Direct method to Set a value for a key in a certain namespace from the dictionary.
+            _adminLock.Lock();
 
-        std::list<RuntimeEntry>& container(_dictionary[nameSpace]);
-        std::list<RuntimeEntry>::iterator listIndex(container.begin());
+            result = Apply(_dictionary[nameSpace], nameSpace, key, value);
 
-        while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-            listIndex++;
+            _adminLock.Unlock();
         }
 
-        if (listIndex == container.end()) {
-            result = true;
-            container.push_back(RuntimeEntry(key, value, VOLATILE));
-        } else if (listIndex->Value() != value) {
-            result = true;
-            listIndex->Value(value);
+        return (result);
+    }
+
+    uint32_t Dictionary::SetMany(const string& nameSpace, const KeyValues& values, uint32_t& changed)
+    {
+        uint32_t result = Core::ERROR_NONE;
+        KeyValues::const_iterator index(values.begin());
+
+        changed = 0;
+
+        while ((index != values.end()) && (IsValidName(index->first) == true) && (Fits(nameSpace, index->first, index->second) == true)) {
+            index++;
         }
 
-        if (result == true) {
-            ObserverMap::iterator index(_observers.begin());
+        if (index != values.end()) {
+            result = Core::ERROR_BAD_REQUEST;
+        } else if (values.empty() == false) {
+            _adminLock.Lock();
 
-            // Right, we updated send out the modification !!!
-            while (index != _observers.end()) {
-                if (index->first == nameSpace) {
-                    index->second->Modified(nameSpace, key, value);
+            KeySpace& container(_dictionary[nameSpace]);
+
+            for (const std::pair<string, string>& entry : values) {
+                if (Apply(container, nameSpace, entry.first, entry.second) == true) {
+                    changed++;
                 }
-                index++;
             }
+
+            _adminLock.Unlock();
         }
 
-        _adminLock.Unlock();
+        return (result);
+    }
+
+    uint32_t Dictionary::GetMany(const string& nameSpace, const std::vector<string>& keys, KeyValues& values) const
+    {
+        uint32_t result = 0;
+
+        _adminLock.ReadLock();
+
+        DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
+
+        if (index != _dictionary.end()) {
+            for (const string& key : keys) {
+                const RuntimeEntry* entry = index->second.Find(key);
+
+                if (entry != nullptr) {
+                    values.emplace_back(key, entry->Value());
+                    result++;
+                }
+            }
+        }
+
+        _adminLock.ReadUnlock();
 
         return (result);
     }
@@ -21,7 +21,10 @@
 #define __DICTIONARY_H
 
 #include "Module.h"
+#include <condition_variable>
 #include <interfaces/IDictionary.h>
+#include <mutex>
+#include <unordered_map>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -101,9 +104,351 @@ namespace Plugin {
             bool _dirty;
         };
 
-        typedef std::map<const string, std::list<RuntimeEntry>> DictionaryMap;
+        // The keys of a namespace. The entries are kept in insertion order, which is the order in which they are
+        // iterated and persisted. An open addressing table with linear probing maps a key on its position in that
+        // list. Keys are never removed, so there is no need for tombstones.
+        class KeySpace {
+        private:
+            struct Slot {
+                uint32_t Hash;
+                uint32_t Position; // 1 based, 0 marks an empty slot.
+            };
+
+            static constexpr uint32_t InitialSlots = 16;
+
+        public:
+            KeySpace()
+                : _entries()
+                , _slots(InitialSlots, Slot { 0, 0 })
+            {
+            }
+            ~KeySpace()
+            {
+            }
+
+        public:
+            inline const std::vector<RuntimeEntry>& Entries() const
+            {
+                return (_entries);
+            }
+            const RuntimeEntry* Find(const string& key) const
+            {
+                const Slot& slot(_slots[Lookup(key, Hash(key))]);
+
+                return (slot.Position == 0 ? nullptr : &(_entries[slot.Position - 1]));
+            }
+            RuntimeEntry* Find(const string& key)
+            {
+                const Slot& slot(_slots[Lookup(key, Hash(key))]);
+
+                return (slot.Position == 0 ? nullptr : &(_entries[slot.Position - 1]));
+            }
+            // Add the key if it is not there yet, otherwise return the existing entry.
+            RuntimeEntry& Insert(const string& key, const string& value, const enumType type)
+            {
+                const uint32_t hash = Hash(key);
+                uint32_t index = Lookup(key, hash);
+
+                if (_slots[index].Position == 0) {
+                    // Keep the load factor below 1/2, so probe sequences stay short.
+                    if (((_entries.size() + 1) * 2) > _slots.size()) {
+                        Grow();
+                        index = Lookup(key, hash);
+                    }
+
+                    _entries.push_back(RuntimeEntry(key, value, type));
+                    _slots[index].Hash = hash;
+                    _slots[index].Position = static_cast<uint32_t>(_entries.size());
+                }
+
+                return (_entries[_slots[index].Position - 1]);
+            }
+
+        private:
+            static inline uint32_t Hash(const string& key)
+            {
+                return (static_cast<uint32_t>(std::hash<string>()(key)));
+            }
+            uint32_t Lookup(const string& key, const uint32_t hash) const
+            {
+                const uint32_t mask = static_cast<uint32_t>(_slots.size() - 1);
+                uint32_t index = (hash & mask);
+
+                // Only compare the strings if the hashes match, most of the probes are decided on the hash.
+                while ((_slots[index].Position != 0) && ((_slots[index].Hash != hash) || (_entries[_slots[index].Position - 1].Key() != key))) {
+                    index = ((index + 1) & mask);
+                }
+
+                return (index);
+            }
+            void Grow()
+            {
+                std::vector<Slot> slots(_slots.size() * 2, Slot { 0, 0 });
+                const uint32_t mask = static_cast<uint32_t>(slots.size() - 1);
+
+                for (const Slot& slot : _slots) {
+                    if (slot.Position != 0) {
+                        uint32_t index = (slot.Hash & mask);
+
+                        while (slots[index].Position != 0) {
+                            index = ((index + 1) & mask);
+                        }
+
+                        slots[index] = slot;
+                    }
+                }
+
+                _slots.swap(slots);
+            }
+
+        private:
+            std::vector<RuntimeEntry> _entries;
+            std::vector<Slot> _slots;
+        };
+
+        // Many readers or a single writer. A waiting writer blocks new readers, so a steady stream of Gets can
+        // not starve a Set.
+        class ReadWriteLock {
+        private:
+            ReadWriteLock(const ReadWriteLock&) = delete;
+            ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+        public:
+            ReadWriteLock()
+                : _lock()
+                , _readers()
+                , _writers()
+                , _reading(0)
+                , _waiting(0)
+                , _writing(false)
+            {
+            }
+            ~ReadWriteLock()
+            {
+            }
+
+        public:
+            void ReadLock() const
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+
+                while ((_writing == true) || (_waiting != 0)) {
+                    _readers.wait(lock);
+                }
+
+                _reading++;
+            }
+            void ReadUnlock() const
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+
+                ASSERT(_reading != 0);
+
+                if ((--_reading == 0) && (_waiting != 0)) {
+                    _writers.notify_one();
+                }
+            }
+            void Lock() const
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+
+                _waiting++;
+
+                while ((_writing == true) || (_reading != 0)) {
+                    _writers.wait(lock);
+                }
+
+                _waiting--;
+                _writing = true;
+            }
+            void Unlock() const
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+
+                ASSERT(_writing == true);
+
+                _writing = false;
+
+                if (_waiting != 0) {
+                    _writers.notify_one();
+                } else {
+                    _readers.notify_all();
+                }
+            }
+
+        private:
+            mutable std::mutex _lock;
+            mutable std::condition_variable _readers;
+            mutable std::condition_variable _writers;
+            mutable uint32_t _reading;
+            mutable uint32_t _waiting;
+            mutable bool _writing;
+        };
+
+        typedef std::map<const string, KeySpace> DictionaryMap;
+
+        // Append only log of all changes, so they survive a crash without rewriting the whole dictionary.
+        // Records are collected in memory and written, and synced, in batches by a worker job. Once the log
+        // grows past its limit, it is moved aside, a snapshot of the dictionary is written, and the moved log
+        // is removed. Replaying a log on top of a snapshot that is newer than the start of that log gives the
+        // same end state, so a crash in any step of that process loses nothing that was synced.
+        class Journal {
+        private:
+            Journal() = delete;
+            Journal(const Journal&) = delete;
+            Journal& operator=(const Journal&) = delete;
+
+        public:
+            Journal(Dictionary& parent)
+                : _parent(parent)
+                , _lock()
+                , _storage()
+                , _fd(-1)
+                , _pending()
+                , _size(0)
+                , _syncTime(0)
+                , _limit(0)
+                , _scheduled(false)
+                , _rotated(false)
+                , _job(*this)
+            {
+            }
+            ~Journal()
+            {
+                ASSERT(_fd == -1);
+            }
+
+        public:
+            static inline string Log(const string& storage)
+            {
+                return (storage + _T(".journal"));
+            }
+            static inline string Rotated(const string& storage)
+            {
+                return (storage + _T(".journal.old"));
+            }
+
+            bool Open(const string& storage, const uint32_t syncTime, const uint32_t limit);
+            void Close();
+            void Append(const string& nameSpace, const string& key, const string& value, const enumType type);
+
+            // Replay a log on the given dictionary. A torn record at the end, from a crash during a write, is cut
+            // off. A corrupt record in the middle stops the replay, but the file is left as is.
+            static void Replay(const string& fileName, DictionaryMap& dictionary);
+
+            // Worker pool job, writes the pending records.
+            void Dispatch();
+
+        private:
+            void Sync();
+            void Compact();
+
+        private:
+            Dictionary& _parent;
+            Core::CriticalSection _lock;
+            string _storage;
+            int _fd;
+            string _pending;
+            uint32_t _size;
+            uint32_t _syncTime;
+            uint32_t _limit;
+            bool _scheduled;
+            bool _rotated;
+            Core::WorkerPool::JobType<Journal&> _job;
+        };
+
         typedef std::list<std::pair<const string, struct Exchange::IDictionary::INotification*>> ObserverMap;
-        typedef Core::IteratorType<const std::list<RuntimeEntry>, const RuntimeEntry&, std::list<RuntimeEntry>::const_iterator> InternalIterator;
+
+        // Sends out the modifications from a worker job, so a Set never waits for a sink. Changes that are not
+        // sent out yet are coalesced per namespace, a key that changes again only reports its latest value.
+        class Notifier {
+        private:
+            class Changes {
+            public:
+                Changes()
+                    : _order()
+                    , _index()
+                {
+                }
+                ~Changes()
+                {
+                }
+
+            public:
+                inline const std::vector<std::pair<string, string>>& Order() const
+                {
+                    return (_order);
+                }
+                void Modified(const string& key, const string& value)
+                {
+                    std::unordered_map<string, uint32_t>::const_iterator index(_index.find(key));
+
+                    if (index == _index.end()) {
+                        _index.emplace(key, static_cast<uint32_t>(_order.size()));
+                        _order.emplace_back(key, value);
+                    } else {
+                        _order[index->second].second = value;
+                    }
+                }
+
+            private:
+                std::vector<std::pair<string, string>> _order;
+                std::unordered_map<string, uint32_t> _index;
+            };
+
+            typedef std::map<const string, Changes> PendingMap;
+
+        private:
+            Notifier() = delete;
+            Notifier(const Notifier&) = delete;
+            Notifier& operator=(const Notifier&) = delete;
+
+        public:
+            Notifier(Dictionary& parent)
+                : _parent(parent)
+                , _lock()
+                , _pending()
+                , _job(*this)
+            {
+            }
+            ~Notifier()
+            {
+            }
+
+        public:
+            void Modified(const string& nameSpace, const string& key, const string& value)
+            {
+                _lock.Lock();
+
+                const bool idle = _pending.empty();
+
+                _pending[nameSpace].Modified(key, value);
+
+                if (idle == true) {
+                    _job.Submit();
+                }
+
+                _lock.Unlock();
+            }
+            void Revoke()
+            {
+                _job.Revoke();
+
+                _lock.Lock();
+                _pending.clear();
+                _lock.Unlock();
+            }
+
+            // Worker pool job, reports the pending changes.
+            void Dispatch();
+
+        private:
+            Dictionary& _parent;
+            Core::CriticalSection _lock;
+            PendingMap _pending;
+            Core::WorkerPool::JobType<Notifier&> _job;
+        };
+        typedef Core::IteratorType<const std::vector<RuntimeEntry>, const RuntimeEntry&, std::vector<RuntimeEntry>::const_iterator> InternalIterator;
 
     public:
         class Iterator : public Exchange::IDictionary::IIterator {
@@ -113,7 +458,8 @@ namespace Plugin {
 
         public:
             Iterator()
-                : _iterator()
+                : _entries()
+                , _iterator()
                 , _lifeTime(nullptr)
             {
             }
@@ -127,10 +473,12 @@ namespace Plugin {
             }
 
         public:
-            void Load(const InternalIterator& iterator)
+            // The iterator works on its own copy, the namespace may change, and grow, while it is iterated.
+            void Load(const std::vector<RuntimeEntry>& entries)
             {
                 ASSERT(_lifeTime != nullptr);
-                _iterator = iterator;
+                _entries = entries;
+                _iterator = InternalIterator(_entries);
             }
             // IUnknown implementation
             // -----------------------------------------------
@@ -174,6 +522,7 @@ namespace Plugin {
             }
 
         private:
+            std::vector<RuntimeEntry> _entries;
             InternalIterator _iterator;
             Core::IReferenceCounted* _lifeTime;
         };
@@ -328,9 +677,13 @@ namespace Plugin {
                 : Core::JSON::Container()
                 , Storage(_T("dictionary.json"))
                 , LingerTime(10)
+                , SyncTime(1000)
+                , JournalSize(256)
             { // Time in minutes.
                 Add(_T("storage"), &Storage);
                 Add(_T("lingertime"), &LingerTime);
+                Add(_T("synctime"), &SyncTime);
+                Add(_T("journalsize"), &JournalSize);
             }
             ~Config()
             {
@@ -339,6 +692,8 @@ namespace Plugin {
         public:
             Core::JSON::String Storage;
             Core::JSON::DecUInt16 LingerTime;
+            Core::JSON::DecUInt16 SyncTime; // Time in milliseconds a change may wait before it is synced to the journal.
+            Core::JSON::DecUInt32 JournalSize; // Size in KB of the journal that triggers a new snapshot.
         };
 
     public:
@@ -347,6 +702,8 @@ namespace Plugin {
             , _skipURL(0)
             , _config()
             , _dictionary()
+            , _journal(*this)
+            , _notifier(*this)
         {
         }
         virtual ~Dictionary()
@@ -401,21 +758,34 @@ namespace Plugin {
         virtual IDictionary::IIterator* Get(const string& nameSpace) const;
 
         // Direct method to Set a value for a key in a certain namespace from the dictionary.
-        // NameSpace and key MUST be filled.
+        // NameSpace and key MUST be filled, and be at most 65535 characters long, or the journal can not hold them.
         virtual bool Set(const string& nameSpace, const string& key, const string& value);
         virtual void Register(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
         virtual void Unregister(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
 
+        // Batched access, all keys are handled in one go under a single lock. SetMany is all or nothing: if
+        // one of the keys is not valid or too long, none of them is set and ERROR_BAD_REQUEST is returned. On
+        // success it reports how many keys actually changed. GetMany fills in the keys that exist and returns
+        // how many were found.
+        typedef std::vector<std::pair<string, string>> KeyValues;
+
+        uint32_t SetMany(const string& nameSpace, const KeyValues& values, uint32_t& changed);
+        uint32_t GetMany(const string& nameSpace, const std::vector<string>& keys, KeyValues& values) const;
+
     private:
+        bool Apply(KeySpace& container, const string& nameSpace, const string& key, const string& value);
         bool CreateInternalDictionary(const string& currentSpace, const NameSpace& data);
         void CreateExternalDictionary(const string& currentSpace, NameSpace& data) const;
 
     private:
-        mutable Core::CriticalSection _adminLock;
+        // Guards the dictionary, Gets run concurrently.
+        ReadWriteLock _adminLock;
         uint8_t _skipURL;
         Config _config;
         DictionaryMap _dictionary;
         ObserverMap _observers;
+        Journal _journal;
+        Notifier _notifier;
     };
 }
 }
@@ -29,8 +29,23 @@ namespace Plugin {
         Config config;
         config.FromString(service->ConfigLine());
 
+        _logOutput.Configure(config.QueueSize.Value() * 1024, config.MTU.Value(), config.Rate.Value(), config.Batch.Value());
         _logOutput.SetDestination(config.Destination.Binding.Value(), config.Destination.Port.Value());
-        _observer.Register(config.FilePath.Value(), &_fileUpdate, config.FullFile.Value());
+
+        std::list<string> files;
+        Core::JSON::ArrayType<Core::JSON::String>::Iterator index(config.Files.Elements());
+        while (index.Next() == true) {
+            files.push_back(index.Current().Value());
+        }
+        if (files.empty() == true) {
+            files.push_back(config.FilePath.Value());
+        }
+
+        // Where we left off, so a restart neither repeats nor skips lines.
+        const string checkpoints(service->PersistentPath());
+        Core::Directory(checkpoints.c_str()).CreatePath();
+
+        _observer.Register(files, &_fileUpdate, config.FullFile.Value(), checkpoints + _T("checkpoints.json"));
 
         return string();
     }
@@ -42,7 +57,13 @@ namespace Plugin {
 
     string FileTransfer::Information() const
     {
-        return string();
+        uint64_t datagrams, bytes;
+        uint32_t queued, dropped;
+
+        _logOutput.Statistics(datagrams, bytes, queued, dropped);
+
+        return (_T("{ \"datagrams\": ") + std::to_string(datagrams) + _T(", \"bytes\": ") + std::to_string(bytes) +
+            _T(", \"queued\": ") + std::to_string(queued) + _T(", \"dropped\": ") + std::to_string(dropped) + _T(" }"));
     }
 } // namespace Plugin
 } // namespace WPEFramework
@@ -19,6 +19,10 @@
  
 #pragma once
 #include <sys/inotify.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <fnmatch.h>
 #include <unordered_map>
 #include <iostream>
 #include <fstream>
@@ -31,7 +35,8 @@ namespace Core {
             struct ICallback
             {
                 virtual ~ICallback() {}
-                virtual void Updated() = 0;
+                // For a watched directory, name is the entry in it that changed. It is empty otherwise.
+                virtual void Updated(const uint32_t mask, const string &name) = 0;
             };
 
         private:
@@ -64,11 +69,11 @@ namespace Core {
                             _callbacks.erase(index);
                         }
                     }
-                    void Notify()
+                    void Notify(const uint32_t mask, const string &name)
                     {
                         std::list<ICallback *>::iterator index(_callbacks.begin());
                         while (index != _callbacks.end()) {
-                            (*index)->Updated();
+                            (*index)->Updated(mask, name);
                             index++;
                         }
                     }
@@ -108,7 +113,7 @@ namespace Core {
             {
                 return (_notifyFd != -1);
             }
-            bool Register(ICallback *callback, const string &filename)
+            bool Register(ICallback *callback, const string &filename, const uint32_t mask = IN_CLOSE_WRITE)
             {
                 ASSERT(_notifyFd != -1);
                 ASSERT(callback != nullptr);
@@ -124,7 +129,7 @@ namespace Core {
                 }
                 else
                 {
-                    int fileFd = inotify_add_watch(_notifyFd, filename.c_str(), IN_CLOSE_WRITE);
+                    int fileFd = inotify_add_watch(_notifyFd, filename.c_str(), mask);
                     if (fileFd >= 0) {
                         _files.emplace(std::piecewise_construct,
                                        std::forward_as_tuple(filename),
@@ -188,24 +193,29 @@ namespace Core {
             void Handle(const uint16_t events) override
             {
                 if ((events & POLLIN) != 0) {
-                    uint8_t eventBuffer[(sizeof(struct inotify_event) + NAME_MAX + 1)];
+                    uint8_t eventBuffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__((aligned(__alignof__(struct inotify_event))));
                     int length;
                     do
                     {
                         length = ::read(_notifyFd, eventBuffer, sizeof(eventBuffer));
-                        if (length > 0) {
-                            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(eventBuffer);
+                        int offset = 0;
+
+                        _adminLock.Lock();
 
-                            _adminLock.Lock();
+                        // A read returns as many events as fit, handle them all.
+                        while (offset < length) {
+                            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(&eventBuffer[offset]);
 
                             // Check if we have this entry..
                             Observers::iterator loop = _observers.find(event->wd);
                             if (loop != _observers.end()) {
-                                loop->second.Notify();
+                                loop->second.Notify(event->mask, (event->len > 0 ? string(event->name) : string()));
                             }
 
-                            _adminLock.Unlock();
+                            offset += sizeof(struct inotify_event) + event->len;
                         }
+
+                        _adminLock.Unlock();
                     } while (length > 0);
                 }
             }
@@ -220,8 +230,16 @@ namespace Core {
 
 namespace Plugin
 {
+    // Follows a set of files, given by path or glob, and reports every line appended to them. Files are kept open
+    // and read with pread into one reusable buffer. The directories they are in are watched, not the files, so a
+    // file that is rotated away, recreated or newly matching a glob is noticed. The offsets are saved in a
+    // checkpoint file, a restart continues where the previous run left off.
     class FileObserver {
         private:
+            static constexpr uint32_t BufferSize = 64 * 1024;
+            static constexpr uint32_t WatchMask = (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+            static constexpr uint64_t CheckpointInterval = 1000000; // Microseconds
+
             class Sink : public Core::FileSystemMonitor::ICallback, public Core::IDispatch {
                 public:
                     Sink() = delete;
@@ -236,9 +254,9 @@ namespace Plugin
                     }
 
                 public:
-                    void Updated() override
+                    void Updated(const uint32_t mask, const string &name) override
                     {
-                        _parent.Updated();
+                        _parent.Changed(mask, name);
                     }
                     void Dispatch() override
                     {
@@ -249,21 +267,265 @@ namespace Plugin
                     FileObserver &_parent;
             };
 
+            // Device and inode, what a file is regardless of the name it has.
+            typedef std::pair<uint64_t, uint64_t> Identity;
+
+            // One followed file.
+            class Tail {
+                public:
+                    Tail() = delete;
+                    Tail(const Tail &) = delete;
+                    Tail &operator=(const Tail &) = delete;
+
+                    Tail(const string &path)
+                        : _path(path)
+                        , _fd(-1)
+                        , _device(0)
+                        , _inode(0)
+                        , _offset(0)
+                        , _partial()
+                    {
+                    }
+                    ~Tail()
+                    {
+                        Close();
+                    }
+
+                public:
+                    const string &Path() const
+                    {
+                        return (_path);
+                    }
+                    // The file was renamed to another name we follow, keep reading it under that name.
+                    void Rename(const string &path)
+                    {
+                        _path = path;
+                    }
+                    Identity Id() const
+                    {
+                        return (Identity(_device, _inode));
+                    }
+                    bool IsOpen() const
+                    {
+                        return (_fd != -1);
+                    }
+                    uint64_t Inode() const
+                    {
+                        return (_inode);
+                    }
+                    uint64_t Offset() const
+                    {
+                        return (_offset);
+                    }
+                    // Start at the given offset if the file is still the one it was taken from, at the start or end
+                    // otherwise.
+                    bool Open(const uint64_t inode, const uint64_t offset, const bool fromStart)
+                    {
+                        struct stat info;
+
+                        Close();
+
+                        _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+                        if ((_fd != -1) && (::fstat(_fd, &info) == 0)) {
+                            _device = info.st_dev;
+                            _inode = info.st_ino;
+
+                            if ((inode == _inode) && (offset <= static_cast<uint64_t>(info.st_size))) {
+                                _offset = offset;
+                            } else if ((fromStart == true) || (inode != 0)) {
+                                // Replaced while we were not looking, all of it is new.
+                                _offset = 0;
+                            } else {
+                                _offset = info.st_size;
+                            }
+                        } else {
+                            Close();
+                        }
+
+                        return (IsOpen());
+                    }
+                    void Close()
+                    {
+                        if (_fd != -1) {
+                            ::close(_fd);
+                            _fd = -1;
+                        }
+                        _partial.clear();
+                    }
+                    // Report what was added since the last call. Returns true if anything was read.
+                    bool Follow(char buffer[], ICallback *callback)
+                    {
+                        bool result = false;
+                        struct stat info;
+
+                        if (IsOpen() == false) {
+                            // It appeared again after it was rotated or deleted.
+                            Open(0, 0, true);
+                        } else if ((::stat(_path.c_str(), &info) != 0) || (info.st_ino != _inode) || (info.st_dev != _device)) {
+                            // Rotated: what was written to the old file before the move is still ours.
+                            result = Drain(buffer, callback);
+                            Open(0, 0, true);
+                        } else if (static_cast<uint64_t>(info.st_size) < _offset) {
+                            // Truncated, start over.
+                            _partial.clear();
+                            _offset = 0;
+                        }
+
+                        if (IsOpen() == true) {
+                            result = Read(buffer, callback) || result;
+                        }
+
+                        return (result);
+                    }
+                    // Report what is left of a file that is no longer followed.
+                    bool Drain(char buffer[], ICallback *callback)
+                    {
+                        bool result = false;
+
+                        if (IsOpen() == true) {
+                            result = Read(buffer, callback);
+                            Flush(callback);
+                        }
+
+                        return (result);
+                    }
+
+                private:
+                    bool Read(char buffer[], ICallback *callback)
+                    {
+                        bool result = false;
+                        ssize_t loaded;
+
+                        while ((loaded = ::pread(_fd, buffer, BufferSize, _offset)) > 0) {
+                            const char *begin = buffer;
+                            const char *end = buffer + loaded;
+                            const char *newline;
+
+                            while ((newline = static_cast<const char *>(::memchr(begin, '\n', end - begin))) != nullptr) {
+                                if (_partial.empty() == false) {
+                                    _partial.append(begin, newline - begin);
+                                    Deliver(_partial.c_str(), static_cast<uint32_t>(_partial.length()), callback);
+                                    _partial.clear();
+                                } else {
+                                    Deliver(begin, static_cast<uint32_t>(newline - begin), callback);
+                                }
+                                begin = newline + 1;
+                            }
+
+                            // Keep an unterminated line for the next read, unless it grew unreasonably long.
+                            _partial.append(begin, end - begin);
+                            if (_partial.length() >= BufferSize) {
+                                Flush(callback);
+                            }
+
+                            _offset += loaded;
+                            result = true;
+                        }
+
+                        return (result);
+                    }
+                    void Flush(ICallback *callback)
+                    {
+                        if (_partial.empty() == false) {
+                            Deliver(_partial.c_str(), static_cast<uint32_t>(_partial.length()), callback);
+                            _partial.clear();
+                        }
+                    }
+                    static void Deliver(const char text[], uint32_t length, ICallback *callback)
+                    {
+                        if ((length > 0) && (text[length - 1] == '\r')) {
+                            length--;
+                        }
+                        if (length > 0) {
+                            callback->NewLine(text, length);
+                        }
+                    }
+
+                private:
+                    string _path;
+                    int _fd;
+                    uint64_t _device;
+                    uint64_t _inode;
+                    uint64_t _offset;
+                    string _partial;
+            };
+
+            class Checkpoints : public Core::JSON::Container {
+                public:
+                    class Entry : public Core::JSON::Container {
+                        public:
+                            Entry()
+                                : Core::JSON::Container()
+                            {
+                                Add(_T("path"), &Path);
+                                Add(_T("inode"), &Inode);
+                                Add(_T("offset"), &Offset);
+                            }
+                            Entry(const Entry &copy)
+                                : Core::JSON::Container()
+                                , Path(copy.Path)
+                                , Inode(copy.Inode)
+                                , Offset(copy.Offset)
+                            {
+                                Add(_T("path"), &Path);
+                                Add(_T("inode"), &Inode);
+                                Add(_T("offset"), &Offset);
+                            }
+                            ~Entry() override
+                            {
+                            }
+
+                        public:
+                            Core::JSON::String Path;
+                            Core::JSON::DecUInt64 Inode;
+                            Core::JSON::DecUInt64 Offset;
+                    };
+
+                public:
+                    Checkpoints(const Checkpoints &) = delete;
+                    Checkpoints &operator=(const Checkpoints &) = delete;
+
+                    Checkpoints()
+                        : Core::JSON::Container()
+                    {
+                        Add(_T("files"), &Files);
+                    }
+                    ~Checkpoints() override
+                    {
+                    }
+
+                public:
+                    Core::JSON::ArrayType<Entry> Files;
+            };
+
+            typedef std::map<string, uint64_t> Offsets;
+            typedef std::map<string, std::pair<uint64_t, uint64_t>> Positions;
+
         public:
             struct ICallback
             {
                 virtual ~ICallback() {}
-                virtual void NewLine(const string &) = 0;
+                virtual void NewLine(const TCHAR text[], const uint32_t length) = 0;
             };
 
         public:
             FileObserver(const FileObserver &) = delete;
             FileObserver &operator=(const FileObserver &) = delete;
             FileObserver()
-                : _job(Core::ProxyType<Sink>::Create(this))
+                : _adminLock()
+                , _job(Core::ProxyType<Sink>::Create(this))
                 , _callback(nullptr)
-                , _position(0)
-                , _path()
+                , _patterns()
+                , _names()
+                , _directories()
+                , _tails()
+                , _buffer(new char[BufferSize])
+                , _fullFile(false)
+                , _checkpoint()
+                , _lastCheckpoint(0)
+                , _dirty(false)
+                , _rescan(false)
             {
             }
             ~FileObserver()
@@ -274,61 +536,282 @@ namespace Plugin
                 {
                     Unregister();
                 }
+                delete [] _buffer;
             }
 
         public:
-            void Register(const string &entry, ICallback *callback, bool fullFile = false)
+            // Patterns are paths, the last part may be a glob. An empty checkpoint file disables checkpointing.
+            void Register(const std::list<string> &patterns, ICallback *callback, bool fullFile = false, const string &checkpoint = EMPTY_STRING)
             {
                 ASSERT((_callback == nullptr) && (callback != nullptr));
 
-                if (fullFile == false) {
-                    _position = GetCurrentPosition(entry);
-                } else {
-                    _position = 0;
-                }
+                _adminLock.Lock();
 
-                _path = entry;
+                _patterns = patterns;
+                _fullFile = fullFile;
+                _checkpoint = checkpoint;
                 _callback = callback;
-                Core::FileSystemMonitor::Instance().Register(&(*_job), _path);
+
+                Positions positions;
+                LoadCheckpoint(positions);
+                Scan(positions, true);
+
+                for (const string &pattern : _patterns) {
+                    const string directory(Directory(pattern));
+                    const size_t slash = pattern.find_last_of('/');
+
+                    if (std::find(_directories.begin(), _directories.end(), directory) == _directories.end()) {
+                        _directories.push_back(directory);
+                    }
+                    _names.push_back(slash == string::npos ? pattern : pattern.substr(slash + 1));
+                }
+
+                _adminLock.Unlock();
+
+                for (const string &directory : _directories) {
+                    Core::FileSystemMonitor::Instance().Register(&(*_job), directory, WatchMask);
+                }
+
+                // Whatever was written while we were not running.
+                Updated();
             }
             void Unregister()
             {
                 ASSERT(_callback != nullptr);
 
                 // First make sure the dispatcher Job will longer be fired
-                Core::FileSystemMonitor::Instance().Unregister(&(*_job), _path);
+                for (const string &directory : _directories) {
+                    Core::FileSystemMonitor::Instance().Unregister(&(*_job), directory);
+                }
 
                 // Potentially the Job might still be waiting, let’s kill it
                 Core::IWorkerPool::Instance().Revoke(Core::proxy_cast<Core::IDispatchType<void> >(_job));
 
-                _path = EMPTY_STRING;
-                _position = 0;
+                _adminLock.Lock();
+
+                SaveCheckpoint();
+
+                for (Tail *tail : _tails) {
+                    delete tail;
+                }
+                _tails.clear();
+                _directories.clear();
+                _names.clear();
+                _patterns.clear();
                 _callback = nullptr;
+
+                _adminLock.Unlock();
             }
 
         private:
-            long int GetCurrentPosition(const string &filePath) const
+            static string Directory(const string &pattern)
+            {
+                const size_t slash = pattern.find_last_of('/');
+
+                return (slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : pattern.substr(0, slash)));
+            }
+            static Identity Identify(const string &path)
+            {
+                struct stat info;
+
+                return (::stat(path.c_str(), &info) == 0 ? Identity(info.st_dev, info.st_ino) : Identity(0, 0));
+            }
+            // Pick up files that match now, and drop those that are gone and no longer match. Files are told apart
+            // by device and inode, not by name. If a glob matches both the old and the new name of a rotated
+            // file, the tail keeps following it under the new name, it is not picked up a second time.
+            void Scan(const Positions &positions, const bool initial)
+            {
+                std::map<string, Identity> found;
+
+                for (const string &pattern : _patterns) {
+                    glob_t matches;
+
+                    if (::glob(pattern.c_str(), GLOB_NOSORT, nullptr, &matches) == 0) {
+                        for (size_t index = 0; index < matches.gl_pathc; index++) {
+                            found[matches.gl_pathv[index]] = Identify(matches.gl_pathv[index]);
+                        }
+                    }
+                    ::globfree(&matches);
+
+                    // A plain path is followed even when it does not exist (yet).
+                    if (pattern.find_first_of(_T("*?[")) == string::npos) {
+                        found[pattern] = Identify(pattern);
+                    }
+                }
+
+                std::map<Identity, string> names;
+                for (const std::pair<const string, Identity> &entry : found) {
+                    if (entry.second != Identity(0, 0)) {
+                        names.emplace(entry.second, entry.first);
+                    }
+                }
+
+                // First move the tails along with the files that were renamed.
+                std::list<string> claimed;
+                for (Tail *tail : _tails) {
+                    if (tail->IsOpen() == true) {
+                        std::map<Identity, string>::const_iterator name(names.find(tail->Id()));
+
+                        if ((name != names.end()) && (name->second != tail->Path())) {
+                            tail->Rename(name->second);
+                            _dirty = true;
+                        }
+                        if (name != names.end()) {
+                            claimed.push_back(tail->Path());
+                        }
+                    }
+                }
+
+                std::list<Tail *>::iterator index(_tails.begin());
+                while (index != _tails.end()) {
+                    Tail *tail = *index;
+                    const bool lost = ((tail->IsOpen() == true) && (names.find(tail->Id()) == names.end()));
+
+                    if ((lost == true) && (std::find(claimed.begin(), claimed.end(), tail->Path()) != claimed.end())) {
+                        // Its name went to a file another tail follows, report what is left and let it go.
+                        tail->Drain(_buffer, _callback);
+                        delete tail;
+                        index = _tails.erase(index);
+                        _dirty = true;
+                    } else if ((found.find(tail->Path()) == found.end()) && (tail->IsOpen() == false)) {
+                        delete tail;
+                        index = _tails.erase(index);
+                        _dirty = true;
+                    } else {
+                        // An open tail that lost its file keeps its name, Follow handles the rotation.
+                        if (tail->IsOpen() == true) {
+                            names.erase(tail->Id());
+                        }
+                        found.erase(tail->Path());
+                        index++;
+                    }
+                }
+
+                for (const std::pair<const string, Identity> &entry : found) {
+                    const string &path(entry.first);
+
+                    // Skip a second name of a file that is followed already.
+                    if ((entry.second == Identity(0, 0)) || (names.erase(entry.second) != 0)) {
+                        Tail *tail = new Tail(path);
+                        Positions::const_iterator position(positions.find(path));
+
+                        if ((entry.second.second != 0) && ((position == positions.end()) || (position->second.first != entry.second.second))) {
+                            // Rotated while we were not running, the checkpoint might have it under its old name.
+                            Positions::const_iterator moved(positions.begin());
+
+                            while ((moved != positions.end()) && (moved->second.first != entry.second.second)) {
+                                moved++;
+                            }
+                            if (moved != positions.end()) {
+                                position = moved;
+                            }
+                        }
+
+                        if (position != positions.end()) {
+                            tail->Open(position->second.first, position->second.second, _fullFile);
+                        } else {
+                            // Files that show up while running, or since the last checkpoint, are new: all of them is shipped.
+                            tail->Open(0, 0, (_fullFile == true) || (initial == false) || (positions.empty() == false));
+                        }
+
+                        _tails.push_back(tail);
+                        _dirty = true;
+                    }
+                }
+            }
+            void LoadCheckpoint(Positions &positions) const
+            {
+                if (_checkpoint.empty() == false) {
+                    Core::File file(_checkpoint);
+
+                    if (file.Open(true) == true) {
+                        Checkpoints checkpoints;
+                        Core::OptionalType<Core::JSON::Error> error;
+
+                        checkpoints.IElement::FromFile(file, error);
+                        file.Close();
+
+                        if (error.IsSet() == false) {
+                            Core::JSON::ArrayType<Checkpoints::Entry>::ConstIterator index(checkpoints.Files.Elements());
+
+                            while (index.Next() == true) {
+                                positions[index.Current().Path.Value()] = std::pair<uint64_t, uint64_t>(index.Current().Inode.Value(), index.Current().Offset.Value());
+                            }
+                        }
+                    }
+                }
+            }
+            // Written aside and renamed over the old one, a crash never leaves half a checkpoint.
+            void SaveCheckpoint()
             {
-                long int pos = 0;
-                std::ifstream file(filePath.c_str());
-                if (file) {
-                    file.seekg(0, file.end);
-                    pos = file.tellg();
+                if ((_checkpoint.empty() == false) && (_dirty == true)) {
+                    Checkpoints checkpoints;
+                    Core::File file(_checkpoint + _T(".new"));
+
+                    for (const Tail *tail : _tails) {
+                        if (tail->IsOpen() == true) {
+                            Checkpoints::Entry &entry(checkpoints.Files.Add());
+
+                            entry.Path = tail->Path();
+                            entry.Inode = tail->Inode();
+                            entry.Offset = tail->Offset();
+                        }
+                    }
+
+                    if (file.Create() == true) {
+                        checkpoints.IElement::ToFile(file);
+                        file.Close();
+
+                        if (::rename(file.Name().c_str(), _checkpoint.c_str()) == 0) {
+                            _dirty = false;
+                        }
+                    }
+
+                    _lastCheckpoint = Core::Time::Now().Ticks();
                 }
-                return pos;
             }
             void Dispatch()
             {
-                std::ifstream file(_path);
-                if (file) {
-                    file.seekg(_position, file.beg);
-                    std::string str;
-                    while ((std::getline(file, str)) && (str.size() > 0)) {
-                        ASSERT(_callback != nullptr);
-                        _callback->NewLine(str);
+                _adminLock.Lock();
+
+                if (_callback != nullptr) {
+                    if (_rescan.exchange(false) == true) {
+                        Scan(Positions(), false);
+                    }
+
+                    for (Tail *tail : _tails) {
+                        if (tail->Follow(_buffer, _callback) == true) {
+                            _dirty = true;
+                        }
+                    }
+
+                    if (Core::Time::Now().Ticks() >= (_lastCheckpoint + CheckpointInterval)) {
+                        SaveCheckpoint();
                     }
                 }
-                _position = GetCurrentPosition(_path);
+
+                _adminLock.Unlock();
+            }
+            // Called from the monitor thread. Writes to a file only matter if it is one we might follow, other
+            // changes in the directory might add or take away such a file, those need a rescan.
+            void Changed(const uint32_t mask, const string &name)
+            {
+                if ((mask & ~(IN_MODIFY | IN_CLOSE_WRITE)) != 0) {
+                    _rescan = true;
+                    Updated();
+                } else if (Matches(name) == true) {
+                    Updated();
+                }
+            }
+            bool Matches(const string &name) const
+            {
+                std::list<string>::const_iterator index(_names.begin());
+
+                while ((index != _names.end()) && (::fnmatch(index->c_str(), name.c_str(), 0) != 0)) {
+                    index++;
+                }
+
+                return ((name.empty() == true) || (index != _names.end()));
             }
             void Updated()
             {
@@ -336,32 +819,79 @@ namespace Plugin
             }
 
         private:
+            Core::CriticalSection _adminLock;
             const Core::ProxyType<Sink> _job;
             ICallback *_callback;
-            long int _position;
-            string _path;
+            std::list<string> _patterns;
+            std::list<string> _names; // File name part of the patterns, to filter the directory events
+            std::list<string> _directories;
+            std::list<Tail *> _tails;
+            char *_buffer;
+            bool _fullFile;
+            string _checkpoint;
+            uint64_t _lastCheckpoint;
+            bool _dirty;
+            std::atomic<bool> _rescan;
         };
 
     class FileTransfer : public PluginHost::IPlugin {
         private:
 
-            static constexpr uint16_t MAX_BUFFER_LENGHT = 1024;
+            static constexpr uint16_t MAX_BUFFER_LENGHT = 8972; // Jumbo frame, less the IP and UDP headers
             static constexpr uint16_t TIMEOUT_MS = 0;
 
+            // Lines are queued in a preallocated ring of bytes, each prefixed by its length, so queueing a line
+            // does not allocate. When a line does not fit, the oldest lines are dropped to make room. In batch mode
+            // a datagram carries as many lines as fit in the MTU, after a header line "#<sequence> <time> <dropped>",
+            // with the time in milliseconds since the epoch and the number of lines dropped so far, so a receiver
+            // can tell lines lost on the network from lines dropped here.
             class TextChannel : public Core::SocketDatagram
             {
+                private:
+                    typedef uint16_t LineLength;
+
                 public:
                     TextChannel()
                         : Core::SocketDatagram(false, Core::NodeId().Origin(), Core::NodeId(), MAX_BUFFER_LENGHT, 0)
-                        , _sendQueue()
-                        , _offset(0)
+                        , _adminLock()
+                        , _queue()
+                        , _head(0)
+                        , _used(0)
+                        , _lines(0)
+                        , _mtu(MAX_BUFFER_LENGHT)
+                        , _batch(false)
+                        , _rate(0)
+                        , _credit(0)
+                        , _lastRefill(0)
+                        , _sequence(0)
+                        , _dropped(0)
+                        , _datagrams(0)
+                        , _bytes(0)
+                        , _retry(*this)
                     {
                     }
                     virtual ~TextChannel()
                     {
-                        _sendQueue.clear();
-                        _offset = 0;
+                        // Close first, the socket thread can still schedule a retry till it is done with us.
                         Close(Core::infinite);
+                        _retry.Revoke();
+                    }
+
+                    void Configure(const uint32_t queueSize, const uint16_t mtu, const uint32_t rate, const bool batch)
+                    {
+                        _adminLock.Lock();
+
+                        _queue.resize(std::max(queueSize, static_cast<uint32_t>(sizeof(LineLength) + MAX_BUFFER_LENGHT)));
+                        _head = 0;
+                        _used = 0;
+                        _lines = 0;
+                        _mtu = std::min(std::max(mtu, static_cast<uint16_t>(64)), MAX_BUFFER_LENGHT);
+                        _rate = rate;
+                        _credit = 0;
+                        _lastRefill = Core::Time::Now().Ticks();
+                        _batch = batch;
+
+                        _adminLock.Unlock();
                     }
 
                     void SetDestination(const string& binding, const uint16_t &port)
@@ -373,12 +903,26 @@ namespace Plugin
                         Open(TIMEOUT_MS);
                     }
 
-                    void NewLine(const string& text)
+                    void NewLine(const TCHAR text[], const uint32_t textLength)
                     {
                         _adminLock.Lock();
 
-                        _sendQueue.emplace_back(text);
-                        bool trigger = (_sendQueue.size() == 1);
+                        // A line never spans datagrams, cut it to what fits in one.
+                        const LineLength length = static_cast<LineLength>(std::min(static_cast<size_t>(textLength) * sizeof(TCHAR), static_cast<size_t>(_mtu - (_terminator.SizeOf() * sizeof(TCHAR)))));
+                        const uint32_t needed = sizeof(LineLength) + length;
+                        bool trigger = (_lines == 0);
+
+                        if (needed <= _queue.size()) {
+                            while ((_used + needed) > _queue.size()) {
+                                Pop(nullptr);
+                                _lines--;
+                                _dropped++;
+                            }
+
+                            Push(reinterpret_cast<const uint8_t*>(&length), sizeof(length));
+                            Push(reinterpret_cast<const uint8_t*>(text), length);
+                            _lines++;
+                        }
 
                         _adminLock.Unlock();
 
@@ -387,47 +931,70 @@ namespace Plugin
                             Trigger();
                         }
                     }
+
+                    void Statistics(uint64_t& datagrams, uint64_t& bytes, uint32_t& queued, uint32_t& dropped) const
+                    {
+                        _adminLock.Lock();
+
+                        datagrams = _datagrams;
+                        bytes = _bytes;
+                        queued = _lines;
+                        dropped = _dropped;
+
+                        _adminLock.Unlock();
+                    }
+
                 private:
                     // Methods to extract and insert data into the socket buffers
                     uint16_t SendData(uint8_t *dataFrame, const uint16_t maxSendSize) override
                     {
                         uint16_t result = 0;
+                        const uint16_t room = std::min(maxSendSize, _mtu);
+                        const uint8_t markerSize = static_cast<uint8_t>(_terminator.SizeOf() * sizeof(TCHAR));
 
                         _adminLock.Lock();
 
-                        if (_offset == static_cast<uint32_t>(~0)) {
-                            // We are done with this entry it has been sent!!! discard it.
-                            _sendQueue.pop_front();
-                            _offset = 0;
-                        }
-
-                        if (_sendQueue.size() > 0) {
-                            const string& sendObject = _sendQueue.front();
-
-                            // Do we still need to send data from the text..
-                            if (_offset < (sendObject.size() * sizeof(TCHAR))) {
-                                result = (((sendObject.size() * sizeof(TCHAR)) - _offset) > maxSendSize ? maxSendSize : ((sendObject.size() * sizeof(TCHAR)) - _offset));
+                        if ((_lines > 0) && (HasCredit() == true)) {
+                            if (_batch == true) {
+                                char header[64];
+                                const int length = snprintf(header, sizeof(header), "#%u %llu %u", _sequence,
+                                    static_cast<unsigned long long>(Core::Time::Now().Ticks() / 1000), _dropped);
 
-                                _offset += SendCharacters(dataFrame, &(sendObject.c_str()[(_offset / sizeof(TCHAR))]), (_offset % sizeof(TCHAR)), result);
+                                ::memcpy(dataFrame, header, length);
+                                ::memcpy(&(dataFrame[length]), _terminator.Marker(), markerSize);
+                                result = static_cast<uint16_t>(length + markerSize);
+                                _sequence++;
                             }
 
-                            // See if we can write the closing marker
-                            if ((maxSendSize != result) && (_offset >= (sendObject.size() * sizeof(TCHAR))) && (_offset < ((sendObject.size() + (_terminator.SizeOf())) * sizeof(TCHAR)))) {
-                                uint8_t markerSize = (static_cast<uint8_t>(_terminator.SizeOf()) * sizeof(TCHAR));
-                                uint8_t markerOffset = ((sendObject.size() * sizeof(TCHAR)) - _offset);
-                                uint16_t size = ((markerSize - markerOffset) > (maxSendSize - result) ? (maxSendSize - result) : (markerSize - markerOffset));
+                            // At least one line per datagram, as many more as fit.
+                            uint16_t packed = 0;
 
-                                _offset += SendCharacters(&(dataFrame[result]), &(_terminator.Marker()[(markerOffset / sizeof(TCHAR))]), (markerOffset % sizeof(TCHAR)), size);
-                                result += size;
+                            do {
+                                LineLength length;
+                                Peek(reinterpret_cast<uint8_t*>(&length), sizeof(length));
 
-                                if ((size + markerOffset) == markerSize) {
-                                    // Report as completed on the next run
-                                    _offset = static_cast<uint32_t>(~0);
+                                if ((result + length + markerSize) > room) {
+                                    if (packed != 0) {
+                                        break;
+                                    }
+                                    // Does not fit next to the header, the end of the line is lost.
+                                    length = room - result - markerSize;
                                 }
-                            }
 
-                            // If we went through this entry we must have processed something....
-                            ASSERT(result != 0);
+                                Pop(&(dataFrame[result]), length);
+                                ::memcpy(&(dataFrame[result + length]), _terminator.Marker(), markerSize);
+                                result += (length + markerSize);
+                                _lines--;
+                                packed++;
+
+                            } while ((_batch == true) && (_lines > 0));
+
+                            _datagrams++;
+                            _bytes += result;
+
+                            if (_rate != 0) {
+                                _credit -= result;
+                            }
                         }
 
                         _adminLock.Unlock();
@@ -444,19 +1011,90 @@ namespace Plugin
                     {
                     }
 
-                    uint16_t SendCharacters(uint8_t *dataFrame, const TCHAR stream[], const uint8_t delta, const uint16_t total)
+                    // Token bucket, refilled at the configured rate and allowed to go into debt for one datagram. When
+                    // in debt, sending resumes once the debt is paid off.
+                    bool HasCredit()
+                    {
+                        bool result = true;
+
+                        if (_rate != 0) {
+                            const uint64_t now = Core::Time::Now().Ticks();
+                            const int64_t burst = std::max(static_cast<int64_t>(_rate / 10), static_cast<int64_t>(_mtu));
+
+                            _credit = std::min(_credit + static_cast<int64_t>(((now - _lastRefill) * _rate) / 1000000), burst);
+                            _lastRefill = now;
+
+                            if (_credit < 0) {
+                                const uint32_t wait = static_cast<uint32_t>(((-_credit * 1000) / _rate) + 1);
+
+                                _retry.Schedule(Core::Time::Now().Add(wait));
+                                result = false;
+                            }
+                        }
+
+                        return (result);
+                    }
+                    void Dispatch()
                     {
-                        ASSERT(delta == 0);
-                        // Copying from an aligned position..
-                        ::memcpy(dataFrame, stream, total);
-                        return (total);
+                        Trigger();
+                    }
+
+                    // Ring buffer primitives, called with the lock taken.
+                    void Push(const uint8_t data[], const uint32_t length)
+                    {
+                        const uint32_t tail = (_head + _used) % _queue.size();
+                        const uint32_t first = std::min(length, static_cast<uint32_t>(_queue.size()) - tail);
+
+                        ::memcpy(&(_queue[tail]), data, first);
+                        ::memcpy(&(_queue[0]), &(data[first]), length - first);
+                        _used += length;
+                    }
+                    void Peek(uint8_t data[], const uint32_t length) const
+                    {
+                        const uint32_t first = std::min(length, static_cast<uint32_t>(_queue.size()) - _head);
+
+                        ::memcpy(data, &(_queue[_head]), first);
+                        ::memcpy(&(data[first]), &(_queue[0]), length - first);
+                    }
+                    void Skip(const uint32_t length)
+                    {
+                        _head = (_head + length) % _queue.size();
+                        _used -= length;
+                    }
+                    // Remove the oldest line, copy at most length bytes of it if a destination is given.
+                    void Pop(uint8_t data[], const LineLength length = 0)
+                    {
+                        LineLength size;
+
+                        Peek(reinterpret_cast<uint8_t*>(&size), sizeof(size));
+                        Skip(sizeof(size));
+
+                        if (data != nullptr) {
+                            Peek(data, std::min(size, length));
+                        }
+
+                        Skip(size);
                     }
 
                 private:
-                    Core::CriticalSection _adminLock;
-                    std::list<string> _sendQueue;
-                    uint32_t _offset;
+                    mutable Core::CriticalSection _adminLock;
+                    std::vector<uint8_t> _queue;
+                    uint32_t _head;
+                    uint32_t _used;
+                    uint32_t _lines;
+                    uint16_t _mtu;
+                    bool _batch;
+                    uint32_t _rate; // Bytes per second, 0 is unlimited
+                    int64_t _credit;
+                    uint64_t _lastRefill;
+                    uint32_t _sequence;
+                    uint32_t _dropped;
+                    uint64_t _datagrams;
+                    uint64_t _bytes;
                     Core::TerminatorCarriageReturn _terminator;
+                    Core::WorkerPool::JobType<TextChannel&> _retry;
+
+                    friend Core::ThreadPool::JobType<TextChannel&>;
             };
 
             class OnChangeFile: public FileObserver::ICallback
@@ -474,11 +1112,11 @@ namespace Plugin
                     OnChangeFile(const OnChangeFile &) = delete;
                     OnChangeFile &operator=(const OnChangeFile &) = delete;
 
-                    void NewLine(const string &text) override
+                    void NewLine(const TCHAR text[], const uint32_t length) override
                     {
                         _adminLock.Lock();
 
-                        _parent.NewLine(text);
+                        _parent.NewLine(text, length);
 
                         _adminLock.Unlock();
                     }
@@ -525,18 +1163,28 @@ namespace Plugin
 
                 public:
                     Config()
-                        : FilePath(_T("/var/log/messages")), FullFile(false), Destination()
+                        : FilePath(_T("/var/log/messages")), Files(), FullFile(false), Destination(), Batch(false), MTU(1472), Rate(0), QueueSize(256)
                     {
                         Add(_T("filepath"), &FilePath);
+                        Add(_T("files"), &Files);
                         Add(_T("fullfile"), &FullFile);
                         Add(_T("destination"), &Destination);
+                        Add(_T("batch"), &Batch);
+                        Add(_T("mtu"), &MTU);
+                        Add(_T("rate"), &Rate);
+                        Add(_T("queuesize"), &QueueSize);
                     }
                     ~Config() override {}
 
                 public:
                     Core::JSON::String FilePath;
+                    Core::JSON::ArrayType<Core::JSON::String> Files; // Paths, the file name may be a glob. Replaces filepath.
                     Core::JSON::Boolean FullFile;
                     NetworkNode Destination;
+                    Core::JSON::Boolean Batch; // Pack lines into datagrams, with a sequence number and timestamp
+                    Core::JSON::DecUInt16 MTU; // Largest datagram payload, in bytes
+                    Core::JSON::DecUInt32 Rate; // Bytes per second, 0 is unlimited
+                    Core::JSON::DecUInt32 QueueSize; // KB, the oldest lines are dropped beyond this
             };
 
             public:
@@ -120,6 +120,7 @@ namespace Plugin {
                 : messageType()
                 , gateway()
                 , broadcast()
+                , server()
                 , dns()
                 , netmask()
                 , leaseTime()
@@ -132,6 +133,7 @@ namespace Plugin {
                 : messageType()
                 , gateway()
                 , broadcast()
+                , server()
                 , dns()
                 , netmask()
                 , leaseTime()
@@ -197,6 +199,12 @@ namespace Plugin {
                         }
                         break;
                     }
+                    case OPTION_SERVERIDENTIFIER: {
+                        struct in_addr rInfo;
+                        rInfo.s_addr = htonl(optionsData[used] << 24 | optionsData[used + 1] << 16 | optionsData[used + 2] << 8 | optionsData[used + 3]);
+                        server = rInfo;
+                        break;
+                    }
                     case OPTION_BROADCASTADDRESS: {
                         struct in_addr rInfo;
                         rInfo.s_addr = htonl(optionsData[used] << 24 | optionsData[used + 1] << 16 | optionsData[used + 2] << 8 | optionsData[used + 3]);
@@ -228,6 +236,7 @@ namespace Plugin {
             Core::OptionalType<uint8_t> messageType;
             Core::NodeId gateway; /* the IP address that was offered to us */
             Core::NodeId broadcast; /* the IP address that was offered to us */
+            Core::NodeId server; /* the DHCP server that sent the message */
             std::list<Core::NodeId> dns; /* the IP address that was offered to us */
             Core::OptionalType<uint8_t> netmask;
             Core::OptionalType<uint32_t> leaseTime; /* lease time in seconds */
@@ -412,6 +421,10 @@ namespace Plugin {
             {
                 return (_source);
             }
+            void Source(const Core::NodeId& source)
+            {
+                _source = source;
+            }
             const Core::NodeId& Address() const
             {
                 return (_offer);
@@ -572,6 +585,46 @@ namespace Plugin {
 
             return (result);
         }
+        /* INIT-REBOOT (RFC 2131 section 3.2), verify a lease we had before, without a DISCOVER. */
+        inline uint32_t Reboot(const Offer& lease)
+        {
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+
+            if ((SocketDatagram::IsOpen() == true) || (SocketDatagram::Open(Core::infinite, _interfaceName) == Core::ERROR_NONE)) {
+
+                result = Core::ERROR_INPROGRESS;
+
+                _adminLock.Lock();
+
+                if ((_state == RECEIVING) || (_state == IDLE)) {
+
+                    ASSERT(lease.Address().IsValid() == true);
+
+                    Crypto::Random(_xid);
+
+                    _modus = CLASSIFICATION_REQUEST;
+                    _state = SENDING;
+                    _offer = lease;
+                    _expired = Core::Time();
+
+                    // The server identifier must not be send, whatever server is responsible for
+                    // the network we are on now, should answer.
+                    _serverIdentifier = 0;
+
+                    _adminLock.Unlock();
+
+                    result = Core::ERROR_NONE;
+
+                    Core::SocketDatagram::Broadcast(true);
+                    Core::SocketDatagram::Trigger();
+                }
+                else {
+                    _adminLock.Unlock();
+                }
+            }
+
+            return (result);
+        }
         inline uint32_t Release()
         {
             uint32_t result = Core::ERROR_OPENING_FAILED;
@@ -758,6 +811,11 @@ namespace Plugin {
                             if (xid == _xid) {
 
                                 _offer.Update(options); // Update if informations changed since offering
+
+                                if ((_serverIdentifier == 0) && (options.server.IsValid() == true)) {
+                                    // Acknowledge on an INIT-REBOOT, the lease is from now on owned by this server.
+                                    _offer.Source(options.server);
+                                }
                                 
                                 _expired = Core::Time::Now().Add(_offer.LeaseTime() * 1000);
 
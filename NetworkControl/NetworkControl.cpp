@@ -466,7 +466,12 @@ namespace Plugin
                 SYSLOG(Logging::Notification, (_T("Adapter [%s] not available or in the wrong state."), interfaceName.c_str()));
             }
             else {
+                if ( (dynamic == true) && (index->second.Outdated() == true) ) {
+                    // The lease ran out while we were away, do not claim its address before a server offers it again.
+                    index->second.ClearLease();
+                }
                 if (index->second.Info().Address().IsValid() == true) {
+                    // For a lease, we use it right away, the INIT-REBOOT that follows will confirm it.
                     result = SetIP(adapter, index->second.Info().Address(), index->second.Info().Gateway(), index->second.Info().Broadcast(), true);
                 }
                 else if (dynamic == false) {
@@ -485,6 +490,31 @@ namespace Plugin
         return (result);
     }
 
+    uint32_t NetworkControl::Measurements(const string& index, Core::JSON::ArrayType<StatisticsData>& statistics) const
+    {
+        uint32_t result = Core::ERROR_NONE;
+
+        _adminLock.Lock();
+
+        if (index.empty() == false) {
+            std::map<const string, DHCPEngine>::const_iterator entry(_dhcpInterfaces.find(index));
+
+            if (entry != _dhcpInterfaces.end()) {
+                entry->second.Get(statistics.Add());
+            } else {
+                result = Core::ERROR_UNAVAILABLE;
+            }
+        } else {
+            for (const std::pair<const string, DHCPEngine>& entry : _dhcpInterfaces) {
+                entry.second.Get(statistics.Add());
+            }
+        }
+
+        _adminLock.Unlock();
+
+        return (result);
+    }
+
     void NetworkControl::SubSystemValidation() {
 
         uint16_t count = 0;
@@ -48,6 +48,7 @@ namespace Plugin {
                 , LeaseTime(0)
                 , RenewalTime(0)
                 , RebindingTime(0)
+                , Expires(0)
                 , Xid(0)
                 , DNS()
                 , TimeOut(10)
@@ -64,6 +65,7 @@ namespace Plugin {
                 Add(_T("leaseTime"), &LeaseTime);
                 Add(_T("renewalTime"), &RenewalTime);
                 Add(_T("rebindingTime"), &RebindingTime);
+                Add(_T("expires"), &Expires);
                 Add(_T("xid"), &Xid);
                 Add(_T("dns"), &DNS);
                 Add(_T("timeout"), &TimeOut);
@@ -80,6 +82,7 @@ namespace Plugin {
                 , LeaseTime(copy.LeaseTime)
                 , RenewalTime(copy.RenewalTime)
                 , RebindingTime(copy.RebindingTime)
+                , Expires(copy.Expires)
                 , Xid(copy.Xid)
                 , DNS(copy.DNS)
                 , TimeOut(copy.TimeOut)
@@ -96,6 +99,7 @@ namespace Plugin {
                 Add(_T("leaseTime"), &LeaseTime);
                 Add(_T("renewalTime"), &RenewalTime);
                 Add(_T("rebindingTime"), &RebindingTime);
+                Add(_T("expires"), &Expires);
                 Add(_T("xid"), &Xid);
                 Add(_T("dns"), &DNS);
                 Add(_T("timeout"), &TimeOut);
@@ -113,6 +117,7 @@ namespace Plugin {
             Core::JSON::DecUInt32 LeaseTime;
             Core::JSON::DecUInt32 RenewalTime;
             Core::JSON::DecUInt32 RebindingTime;
+            Core::JSON::DecUInt64 Expires; // Ticks at which the lease runs out
             Core::JSON::DecUInt32 Xid;
             Core::JSON::ArrayType<Core::JSON::String> DNS;
             Core::JSON::DecUInt8 TimeOut;
@@ -144,6 +149,71 @@ namespace Plugin {
             Core::JSON::String _broadcast;
         };
 
+        // Time it took an interface to get its address after the link came up, all durations in milliseconds.
+        class StatisticsData : public Core::JSON::Container {
+        public:
+            StatisticsData()
+                : Core::JSON::Container()
+            {
+                Init();
+            }
+            StatisticsData(const StatisticsData& copy)
+                : Core::JSON::Container()
+                , Interface(copy.Interface)
+                , Reboots(copy.Reboots)
+                , Discovers(copy.Discovers)
+                , Fallbacks(copy.Fallbacks)
+                , Last(copy.Last)
+                , Reboot(copy.Reboot)
+                , Discover(copy.Discover)
+                , Minimum(copy.Minimum)
+                , Maximum(copy.Maximum)
+            {
+                Init();
+            }
+            StatisticsData& operator=(const StatisticsData& rhs)
+            {
+                Interface = rhs.Interface;
+                Reboots = rhs.Reboots;
+                Discovers = rhs.Discovers;
+                Fallbacks = rhs.Fallbacks;
+                Last = rhs.Last;
+                Reboot = rhs.Reboot;
+                Discover = rhs.Discover;
+                Minimum = rhs.Minimum;
+                Maximum = rhs.Maximum;
+                return (*this);
+            }
+            ~StatisticsData() override
+            {
+            }
+
+        private:
+            void Init()
+            {
+                Add(_T("interface"), &Interface);
+                Add(_T("reboots"), &Reboots);
+                Add(_T("discovers"), &Discovers);
+                Add(_T("fallbacks"), &Fallbacks);
+                Add(_T("last"), &Last);
+                Add(_T("reboot"), &Reboot);
+                Add(_T("discover"), &Discover);
+                Add(_T("minimum"), &Minimum);
+                Add(_T("maximum"), &Maximum);
+            }
+
+        public:
+            Core::JSON::String Interface;
+            Core::JSON::DecUInt32 Reboots; // Leases confirmed with an INIT-REBOOT
+            Core::JSON::DecUInt32 Discovers; // Leases obtained with a full DISCOVER
+            Core::JSON::DecUInt32 Fallbacks; // INIT-REBOOTs that were refused or not answered
+            Core::JSON::DecUInt32 Last;
+            Core::JSON::DecUInt32 Reboot; // Average over the INIT-REBOOTs
+            Core::JSON::DecUInt32 Discover; // Average over the DISCOVERs
+            Core::JSON::DecUInt32 Minimum;
+            Core::JSON::DecUInt32 Maximum;
+        };
+
     private:
         using Store = Core::JSON::ArrayType<Entry>;
 
@@ -275,6 +345,78 @@ namespace Plugin {
             std::list<Core::NodeId> _dns;
         };
 
+        class Statistics {
+        public:
+            Statistics& operator=(const Statistics&) = delete;
+
+            Statistics()
+                : _reboots(0)
+                , _discovers(0)
+                , _fallbacks(0)
+                , _last(0)
+                , _rebootTotal(0)
+                , _discoverTotal(0)
+                , _minimum(~0)
+                , _maximum(0)
+            {
+            }
+            Statistics(const Statistics& copy)
+                : _reboots(copy._reboots)
+                , _discovers(copy._discovers)
+                , _fallbacks(copy._fallbacks)
+                , _last(copy._last)
+                , _rebootTotal(copy._rebootTotal)
+                , _discoverTotal(copy._discoverTotal)
+                , _minimum(copy._minimum)
+                , _maximum(copy._maximum)
+            {
+            }
+            ~Statistics() = default;
+
+        public:
+            // Duration in ticks, from the link coming up till the lease was acknowledged.
+            void Acquired(const bool reboot, const uint64_t duration)
+            {
+                _last = static_cast<uint32_t>(duration / Core::Time::TicksPerMillisecond);
+
+                if (reboot == true) {
+                    _reboots++;
+                    _rebootTotal += _last;
+                } else {
+                    _discovers++;
+                    _discoverTotal += _last;
+                }
+
+                _minimum = std::min(_minimum, _last);
+                _maximum = std::max(_maximum, _last);
+            }
+            void Fallback()
+            {
+                _fallbacks++;
+            }
+            void Get(StatisticsData& info) const
+            {
+                info.Reboots = _reboots;
+                info.Discovers = _discovers;
+                info.Fallbacks = _fallbacks;
+                info.Last = _last;
+                info.Reboot = (_reboots == 0 ? 0 : static_cast<uint32_t>(_rebootTotal / _reboots));
+                info.Discover = (_discovers == 0 ? 0 : static_cast<uint32_t>(_discoverTotal / _discovers));
+                info.Minimum = ((_reboots + _discovers) == 0 ? 0 : _minimum);
+                info.Maximum = _maximum;
+            }
+
+        private:
+            uint32_t _reboots;
+            uint32_t _discovers;
+            uint32_t _fallbacks;
+            uint32_t _last;
+            uint64_t _rebootTotal;
+            uint64_t _discoverTotal;
+            uint32_t _minimum;
+            uint32_t _maximum;
+        };
+
         class AdapterObserver : public WPEFramework::Core::AdapterObserver::INotification {
         public:
             AdapterObserver() = delete;
@@ -389,6 +531,13 @@ namespace Plugin {
         class DHCPEngine : private DHCPClient::ICallback {
         private:
             static constexpr uint32_t AckWaitTimeout = 1000; // 1 second is a life time for a server to respond!
+            static constexpr uint8_t RebootRetries = 2; // INIT-REBOOTs resent, before falling back to a DISCOVER
+
+            enum boot : uint8_t {
+                DISCOVERING, // Full DISCOVER/OFFER/REQUEST/ACK cycle
+                REBOOTING, // INIT-REBOOT, the server is asked to confirm the lease we had
+                REFUSED // The INIT-REBOOT got a NAK, we are on another network
+            };
 
         public:
             DHCPEngine() = delete;
@@ -407,9 +556,14 @@ namespace Plugin {
                 , _offers()
                 , _job(*this)
                 , _settings(info)
+                , _boot(DISCOVERING)
+                , _cached()
+                , _expires()
+                , _linkUp(0)
+                , _statistics()
             {
                 if ( (_settings.Address().IsValid() == true) && (info.Source.IsSet() == true) ) {
-                    // We can start with an Request, i.s.o. an ack...?
+                    // This is the lease we had before, on link-up we start with an INIT-REBOOT, i.s.o. a DISCOVER.
                     Core::NodeId source(info.Source.Value().c_str());
 
                     if (source.IsValid() == true) {
@@ -426,7 +580,12 @@ namespace Plugin {
                             }
                         }
 
-                        _offers.emplace_back(source, static_cast<const Core::NodeId&>(_settings.Address()), _settings.Address().Mask(), _settings.Gateway(), _settings.Broadcast(), _settings.Xid(), std::move(dns));
+                        _cached = DHCPClient::Offer(source, static_cast<const Core::NodeId&>(_settings.Address()), _settings.Address().Mask(), _settings.Gateway(), _settings.Broadcast(), _settings.Xid(), std::move(dns));
+                        _cached.LeaseTime(info.LeaseTime.Value());
+
+                        if (info.Expires.Value() != 0) {
+                            _expires = Core::Time(info.Expires.Value());
+                        }
                     }
                 }
             }
@@ -441,18 +600,34 @@ namespace Plugin {
                 uint32_t result;
                 _retries = 0;
                 _job.Revoke();
-                if ( (_offers.size() > 0) && (_offers.front().Address() == preferred) ) {
+                _linkUp = Core::Time::Now().Ticks();
+
+                if (Outdated() == true) {
+                    _cached.Clear();
+                }
+
+                if ( (_cached.IsValid() == true) && (_cached.Address() == preferred) ) {
+                    // Ask if we can continue with the lease we had, if nobody answers, it is still ours
+                    // and we keep using it while we look for a server in the background.
+                    _offers.clear();
+                    _boot = REBOOTING;
                     _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
-                    result = _client.Request(_offers.front());
+                    result = _client.Reboot(_cached);
                 }
                 else {
                     ClearLease();
+                    _boot = DISCOVERING;
                     _job.Schedule(Core::Time::Now().Add(_handleTime));
                     result = _client.Discover(preferred);
                 }
 
                 return (result);
             }
+            // A lease we had, that ran out while we were away, its address might be in use by now.
+            inline bool Outdated() const
+            {
+                return ((_cached.IsValid() == true) && (_expires.IsValid() == true) && (_expires <= Core::Time::Now()));
+            }
             inline void UpdateMAC(const uint8_t buffer[], const uint8_t size) 
             {
                 _client.UpdateMAC(buffer, size);
@@ -485,15 +660,64 @@ namespace Plugin {
                     else {
                         TRACE(Trace::Information, ("Installing the lease, Rechecking in %d seconds from now", _client.Lease().LeaseTime()));
 
+                        if (_linkUp != 0) {
+                            // First lease since the link came up, this is what everybody was waiting for.
+                            _adminLock.Lock();
+                            _statistics.Acquired(_boot == REBOOTING, Core::Time::Now().Ticks() - _linkUp);
+                            _adminLock.Unlock();
+                            _linkUp = 0;
+                        }
+
+                        _boot = DISCOVERING;
+                        _cached = _client.Lease();
+                        _expires = _client.Expired();
+
                         // We are good to go report success!, if this is a different set..
                         if (_settings.Store(_client.Lease()) == true) {
                             _parent.Accepted(_client.Interface(), _client.Lease());
                             _client.Close();
                         }
+                        else {
+                            // Same lease, but it runs longer now, remember that for the next INIT-REBOOT.
+                            _parent.Save(_parent._persistentStoragePath);
+                        }
                         _retries = 0;
                         _job.Schedule(_client.Expired());
                     }
                 }
+                else if (_boot != DISCOVERING) {
+                    if ( (_boot == REBOOTING) && (_retries++ < RebootRetries) ) {
+                        // No answer (yet), the INIT-REBOOT or its reply might have been lost.
+                        _client.Reboot(_cached);
+                        _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
+                    }
+                    else {
+                        Core::NodeId preferred(_cached.Address());
+
+                        if (_boot == REFUSED) {
+                            TRACE(Trace::Information, ("Lease for [%s] refused, discovering a new one", _cached.Address().HostAddress().c_str()));
+
+                            // Not our network anymore, so stop using the address of the old one.
+                            hardware.Delete(Core::IPNode(_cached.Address(), _cached.Netmask()));
+                            _cached.Clear();
+                            _settings.Clear();
+                            preferred = Core::NodeId();
+                        }
+                        else {
+                            TRACE(Trace::Information, ("Lease for [%s] not confirmed, discovering while using it", _cached.Address().HostAddress().c_str()));
+                        }
+
+                        _adminLock.Lock();
+                        _statistics.Fallback();
+                        _adminLock.Unlock();
+
+                        _boot = DISCOVERING;
+                        _retries = 0;
+                        _offers.clear();
+                        _client.Discover(preferred);
+                        _job.Schedule(Core::Time::Now().Add(_handleTime));
+                    }
+                }
                 else if (_offers.size() == 0) {
                     // Looks like the Discovers did not discover anything, should we retry ?
                     if (_retries++ < _maxRetries) {
@@ -563,11 +787,42 @@ namespace Plugin {
                     DHCPClient::Offer offer(_client.Lease());
                     info.Source = offer.Source().HostAddress();
                     info.Xid = _settings.Xid();
+                    info.LeaseTime = offer.LeaseTime();
+                    info.Expires = _client.Expired().Ticks();
                     for (const Core::NodeId& value : offer.DNS()) {
                         Core::JSON::String& entry = info.DNS.Add();
                         entry = value.HostAddress();
                     }
                 }
+                else if (_cached.IsValid() == true) {
+                    // Not confirmed on this link (yet), keep it for the next INIT-REBOOT.
+                    info.Address = _cached.Address().HostAddress();
+                    info.Mask = _cached.Netmask();
+                    if (_cached.Gateway().IsValid() == true) {
+                        info.Gateway = _cached.Gateway().HostAddress();
+                    }
+                    if (_cached.Broadcast().IsValid() == true) {
+                        info.Broadcast(_cached.Broadcast());
+                    }
+                    info.Source = _cached.Source().HostAddress();
+                    info.Xid = _cached.Xid();
+                    info.LeaseTime = _cached.LeaseTime();
+                    if (_expires.IsValid() == true) {
+                        info.Expires = _expires.Ticks();
+                    }
+                    for (const Core::NodeId& value : _cached.DNS()) {
+                        Core::JSON::String& entry = info.DNS.Add();
+                        entry = value.HostAddress();
+                    }
+                }
+            }
+            void Get(StatisticsData& info) const
+            {
+                info.Interface = _client.Interface();
+
+                _adminLock.Lock();
+                _statistics.Get(info);
+                _adminLock.Unlock();
             }
             inline void ClearLease() {
                 _offers.clear();
@@ -593,13 +848,16 @@ namespace Plugin {
             }
             void Rejected(const DHCPClient::Offer& offer) override {
                 _retries = _maxRetries;
+                if (_boot == REBOOTING) {
+                    _boot = REFUSED;
+                }
                 TRACE(Trace::Information, ("Rejected an Offer from: %s for %s", offer.Source().HostAddress().c_str(), offer.Address().HostAddress().c_str()));
                 _job.Reschedule(Core::Time::Now());
             }
 
         private:
             NetworkControl& _parent;
-            Core::CriticalSection _adminLock;
+            mutable Core::CriticalSection _adminLock;
             uint8_t _retries;
             uint8_t _maxRetries;
             uint32_t _handleTime;
@@ -607,6 +865,11 @@ namespace Plugin {
             std::list<DHCPClient::Offer> _offers;
             Core::WorkerPool::JobType<DHCPEngine&> _job;
             Settings _settings;
+            boot _boot;
+            DHCPClient::Offer _cached; // Last lease we got, confirmed with an INIT-REBOOT on link-up
+            Core::Time _expires;
+            uint64_t _linkUp; // Ticks at which we started to look for a lease, 0 once we have one
+            Statistics _statistics;
         };
 
     public:
@@ -640,6 +903,7 @@ namespace Plugin {
         bool Load(const string& filename, std::map<const string, const Entry>& info);
 
         uint32_t Reload(const string& interfaceName, const bool dynamic);
+        uint32_t Measurements(const string& index, Core::JSON::ArrayType<StatisticsData>& statistics) const;
         uint32_t SetIP(Core::AdapterIterator& adapter, const Core::IPNode& ipAddress, const Core::NodeId& gateway, const Core::NodeId& broadcast, bool clearOld = false);
 
         void DNS(std::list<Core::NodeId>& servers) const;
@@ -669,6 +933,7 @@ namespace Plugin {
         uint32_t get_dns(Core::JSON::ArrayType<Core::JSON::String>& response) const;
         uint32_t set_dns(const Core::JSON::ArrayType<Core::JSON::String>& param);
         uint32_t get_up(const string& index, Core::JSON::Boolean& response) const;
+        uint32_t get_statistics(const string& index, Core::JSON::ArrayType<StatisticsData>& response) const;
         uint32_t set_up(const string& index, const Core::JSON::Boolean& param);
         void event_connectionchange(const string& name, const string& address, const JsonData::NetworkControl::ConnectionchangeParamsData::StatusType& status);
 
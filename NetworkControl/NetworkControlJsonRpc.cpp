@@ -39,6 +39,7 @@ namespace Plugin {
         Property<Core::JSON::ArrayType<NetworkData>>(_T("network"), &NetworkControl::get_network, &NetworkControl::set_network, this);
         Property<Core::JSON::ArrayType<Core::JSON::String>>(_T("dns"), &NetworkControl::get_dns, &NetworkControl::set_dns, this);
         Property<Core::JSON::Boolean>(_T("up"), &NetworkControl::get_up, &NetworkControl::set_up, this);
+        Property<Core::JSON::ArrayType<StatisticsData>>(_T("statistics"), &NetworkControl::get_statistics, nullptr, this);
     }
 
     void NetworkControl::UnregisterAll()
@@ -47,6 +48,7 @@ namespace Plugin {
         Unregister(_T("assign"));
         Unregister(_T("request"));
         Unregister(_T("reload"));
+        Unregister(_T("statistics"));
         Unregister(_T("up"));
         Unregister(_T("dns"));
         Unregister(_T("network"));
@@ -233,6 +235,15 @@ namespace Plugin {
         return result;
     }
 
+    // Property: statistics - Time it took the interfaces to get their address
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNAVAILABLE: Unavailable network interface
+    uint32_t NetworkControl::get_statistics(const string& index, Core::JSON::ArrayType<StatisticsData>& response) const
+    {
+        return Measurements(index, response);
+    }
+
     // Event: connectionchange - Notifies about connection status (update, connected or connectionfailed)
     void NetworkControl::event_connectionchange(const string& name, const string& address, const ConnectionchangeParamsData::StatusType& status)
     {
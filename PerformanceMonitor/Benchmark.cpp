@@ -0,0 +1,286 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceMonitor.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    uint32_t Benchmark::Channel::Connect(const uint32_t waitTime)
+    {
+        const uint64_t deadline = Core::Time::Now().Add(waitTime).Ticks();
+        uint64_t now = Core::Time::Now().Ticks();
+
+        _signal.ResetEvent();
+
+        BaseClass::Open(0);
+
+        // The socket reports once connected and once more when the upgrade to a websocket is done.
+        while ((BaseClass::IsOpen() == false) && (now < deadline)) {
+            _signal.Lock(static_cast<uint32_t>((deadline - now + 999) / 1000));
+            _signal.ResetEvent();
+            now = Core::Time::Now().Ticks();
+        }
+
+        return (BaseClass::IsOpen() == true ? Core::ERROR_NONE : Core::ERROR_UNAVAILABLE);
+    }
+
+    uint32_t Benchmark::Channel::Invoke(const uint32_t waitTime, const string& designator, const string& parameters, string& response)
+    {
+        uint32_t result = Core::ERROR_TIMEDOUT;
+        Core::ProxyType<Core::JSONRPC::Message> message(_factory.Message());
+
+        _adminLock.Lock();
+
+        _id++;
+        message->Id = _id;
+        message->Designator = designator;
+        message->Parameters = parameters;
+        _response.Release();
+        _signal.ResetEvent();
+
+        _adminLock.Unlock();
+
+        BaseClass::Submit(Core::proxy_cast<Core::JSON::IElement>(message));
+
+        if (_signal.Lock(waitTime) == Core::ERROR_NONE) {
+            _adminLock.Lock();
+
+            if (_response.IsValid() == false) {
+                // Woken up by the socket closing.
+                result = Core::ERROR_CONNECTION_CLOSED;
+            } else if (_response->Error.IsSet() == true) {
+                result = _response->Error.Code.Value();
+            } else {
+                result = Core::ERROR_NONE;
+                response = _response->Result.Value();
+            }
+
+            _response.Release();
+
+            _adminLock.Unlock();
+        }
+
+        return (result);
+    }
+
+    /* virtual */ void Benchmark::Channel::Received(Core::ProxyType<Core::JSON::IElement>& element)
+    {
+        Core::ProxyType<Core::JSONRPC::Message> inbound(Core::proxy_cast<Core::JSONRPC::Message>(element));
+
+        _adminLock.Lock();
+
+        // Anything but the answer to the call outstanding, e.g. one that came in after it timed out, is dropped.
+        if ((inbound.IsValid() == true) && (inbound->Id.IsSet() == true) && (inbound->Id.Value() == _id)) {
+            _response = inbound;
+            _signal.SetEvent();
+        }
+
+        _adminLock.Unlock();
+    }
+
+    Benchmark::Client::Client(Benchmark& parent, const Core::NodeId& remoteNode)
+        : Core::Thread(Core::Thread::DefaultStackSize(), _T("Benchmark"))
+        , _parent(parent)
+        , _channel(nullptr)
+        , _deadline(0)
+        , _buffer(parent._size)
+    {
+        if (_parent._kind == WEBSOCKET) {
+            _channel = new Channel(_parent._factory, remoteNode);
+        }
+    }
+
+    /* virtual */ Benchmark::Client::~Client()
+    {
+        Stop();
+        Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+
+        if (_channel != nullptr) {
+            delete _channel;
+        }
+    }
+
+    /* virtual */ uint32_t Benchmark::Client::Worker()
+    {
+        uint32_t result = 0;
+        uint32_t bytes = 0;
+        uint32_t packageSize = _parent._size;
+        const uint64_t start = Core::Time::Now().Ticks();
+
+        if (Request(bytes, packageSize) == Core::ERROR_NONE) {
+            const uint32_t elapsed = static_cast<uint32_t>(Core::Time::Now().Ticks() - start);
+
+            _parent._result->Requests++;
+            _parent._result->Bytes += bytes;
+            _parent._result->Latency.Record(elapsed);
+            _parent._store.Record(HistogramStore::TOTAL, packageSize, elapsed);
+        } else {
+            _parent._result->Errors++;
+        }
+
+        if ((Core::Time::Now().Ticks() >= _deadline) || (_parent._abort.load() == true)) {
+            Block();
+            result = Core::infinite;
+        }
+
+        return (result);
+    }
+
+    // Over JSON-RPC the samples are filed under the size of the data carried, like the plugin does, over COM-RPC
+    // under the payload size.
+    uint32_t Benchmark::Client::Request(uint32_t& bytes, uint32_t& packageSize)
+    {
+        uint32_t result = Core::ERROR_NONE;
+
+        if (_channel != nullptr) {
+            PerformanceMonitor::BufferData message;
+            PerformanceMonitor::BufferData response;
+            string parameters;
+            string answer;
+
+            if (_parent._call != RECEIVE) {
+                message.Data = _parent._encoded;
+                message.Length = static_cast<uint16_t>(_parent._encoded.length());
+                message.Duration = static_cast<uint16_t>(_parent._encoded.length() + 1);
+                message.Timestamp = Core::Time::Now().Ticks();
+                message.ToString(parameters);
+            }
+
+            if (_parent._call == SEND) {
+                result = _channel->Invoke(RequestTimeout, _parent._callsign + _T(".1.send"), parameters, answer);
+                bytes = _parent._size;
+            } else if (_parent._call == RECEIVE) {
+                Core::JSON::DecUInt32 maxSize(_parent._size);
+                maxSize.ToString(parameters);
+                result = _channel->Invoke(RequestTimeout, _parent._callsign + _T(".1.receive"), parameters, answer);
+                response.FromString(answer);
+                bytes = static_cast<uint32_t>((response.Data.Value().length() * 6) / 8);
+            } else {
+                result = _channel->Invoke(RequestTimeout, _parent._callsign + _T(".1.exchange"), parameters, answer);
+                response.FromString(answer);
+                bytes = _parent._size + static_cast<uint32_t>((response.Data.Value().length() * 6) / 8);
+            }
+
+            packageSize = static_cast<uint32_t>(std::max(message.Data.Value().length(), response.Data.Value().length()));
+
+            if ((result == Core::ERROR_NONE) && (response.Timestamp.IsSet() == true)) {
+                const uint64_t now = Core::Time::Now().Ticks();
+
+                // From the response being ready up to having it here, its serialization included.
+                if (response.Timestamp.Value() <= now) {
+                    _parent._store.Record(HistogramStore::COMMUNICATION, packageSize, static_cast<uint32_t>(now - response.Timestamp.Value()));
+                }
+            }
+        } else {
+            uint16_t length = _parent._size;
+
+            if (_parent._call == SEND) {
+                result = _parent._interface->Send(length, _parent._payload.data());
+                bytes = length;
+            } else if (_parent._call == RECEIVE) {
+                result = _parent._interface->Receive(length, _buffer.data());
+                bytes = length;
+            } else {
+                ::memcpy(_buffer.data(), _parent._payload.data(), length);
+                result = _parent._interface->Exchange(length, _buffer.data(), _parent._size);
+                bytes = _parent._size + length;
+            }
+        }
+
+        return (result);
+    }
+
+    uint32_t Benchmark::Run(PluginHost::IShell* service, const string& access, const uint16_t concurrency, const uint32_t duration, Result& result)
+    {
+        uint32_t error = Core::ERROR_NONE;
+        std::list<Client*> clients;
+
+        ASSERT((concurrency != 0) && (concurrency <= MaxConcurrency));
+
+        // Some payload that does not compress to nothing.
+        _payload.resize(_size);
+        for (uint16_t index = 0; index < _size; index++) {
+            _payload[index] = static_cast<uint8_t>((index * 31) ^ (index >> 8));
+        }
+        Core::ToString(_payload.data(), _size, false, _encoded);
+
+        if (_kind == COMRPC) {
+            ASSERT(service != nullptr);
+
+            _interface = service->QueryInterfaceByCallsign<Exchange::IPerformance>(_callsign);
+
+            if (_interface == nullptr) {
+                error = Core::ERROR_UNAVAILABLE;
+            }
+        } else if (access.empty() == true) {
+            error = Core::ERROR_UNAVAILABLE;
+        }
+
+        if (error == Core::ERROR_NONE) {
+            const Core::NodeId remoteNode(access.c_str());
+
+            for (uint16_t index = 0; index < concurrency; index++) {
+                clients.push_back(new Client(*this, remoteNode));
+            }
+
+            // All clients are connected before the clock starts.
+            std::list<Client*>::iterator index(clients.begin());
+
+            while ((error == Core::ERROR_NONE) && (index != clients.end())) {
+                error = (*index)->Connect();
+                index++;
+            }
+        }
+
+        if (error == Core::ERROR_NONE) {
+            _result = &result;
+
+            const uint64_t start = Core::Time::Now().Ticks();
+            const uint64_t deadline = Core::Time(start).Add(duration).Ticks();
+
+            for (Client* client : clients) {
+                client->Start(deadline);
+            }
+
+            // Every client blocks itself after its first request past the deadline. A request can take up to
+            // its timeout, give them that much on top.
+            for (Client* client : clients) {
+                client->Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, duration + RequestTimeout);
+            }
+
+            result.Duration = Core::Time::Now().Ticks() - start;
+        }
+
+        for (Client* client : clients) {
+            delete client;
+        }
+
+        _result = nullptr;
+
+        if (_interface != nullptr) {
+            _interface->Release();
+            _interface = nullptr;
+        }
+
+        return (error);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,232 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "Histogram.h"
+
+#include <interfaces/IPerformance.h>
+#include <websocket/websocket.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Closed loop load generator. A fixed number of clients each fire the next request as soon as the previous
+    // one is answered, for a fixed time. The throughput measured is what the target sustains at that level of
+    // concurrency, the latencies are those of the individual round trips.
+    class Benchmark {
+    public:
+        enum transport : uint8_t {
+            WEBSOCKET, // JSON-RPC over a websocket to the framework
+            COMRPC // Exchange::IPerformance, as handed out by the framework, a direct call if the plugin runs in process
+        };
+        enum method : uint8_t {
+            SEND,
+            RECEIVE,
+            EXCHANGE
+        };
+
+        static constexpr uint16_t MaxConcurrency = 64;
+        static constexpr uint32_t RequestTimeout = 10000;
+
+        class Result {
+        private:
+            Result(const Result&) = delete;
+            Result& operator=(const Result&) = delete;
+
+        public:
+            Result()
+                : Requests(0)
+                , Errors(0)
+                , Bytes(0)
+                , Duration(0)
+                , Latency()
+            {
+            }
+            ~Result()
+            {
+            }
+
+        public:
+            std::atomic<uint64_t> Requests;
+            std::atomic<uint64_t> Errors;
+            std::atomic<uint64_t> Bytes; // Payload bytes moved, both directions
+            uint64_t Duration; // Microseconds the run took
+            Histogram Latency; // Round trip time per request, in microseconds
+        };
+
+    private:
+        class Factory {
+        private:
+            Factory(const Factory&) = delete;
+            Factory& operator=(const Factory&) = delete;
+
+        public:
+            Factory()
+                : _messages(2)
+            {
+            }
+            ~Factory()
+            {
+            }
+
+        public:
+            Core::ProxyType<Core::JSON::IElement> Element(const string&)
+            {
+                return (Core::proxy_cast<Core::JSON::IElement>(_messages.Element()));
+            }
+            Core::ProxyType<Core::JSONRPC::Message> Message()
+            {
+                return (_messages.Element());
+            }
+
+        private:
+            Core::ProxyPoolType<Core::JSONRPC::Message> _messages;
+        };
+
+        // JSON-RPC over a websocket to the given framework, one call at a time. The JSON-RPC links of the
+        // framework find it through the environment, which is not ours to change from inside a plugin.
+        class Channel : public Core::StreamJSONType<Web::WebSocketClientType<Core::SocketStream>, Factory&, Core::JSON::IElement> {
+        private:
+            typedef Core::StreamJSONType<Web::WebSocketClientType<Core::SocketStream>, Factory&, Core::JSON::IElement> BaseClass;
+
+            Channel() = delete;
+            Channel(const Channel&) = delete;
+            Channel& operator=(const Channel&) = delete;
+
+        public:
+            Channel(Factory& factory, const Core::NodeId& remoteNode)
+                : BaseClass(5, factory, _T("/jsonrpc"), _T("JSON"), _T(""), _T(""), false, false, false, remoteNode.AnyInterface(), remoteNode, 256, 256)
+                , _factory(factory)
+                , _adminLock()
+                , _signal(false, true)
+                , _id(0)
+                , _response()
+            {
+            }
+            ~Channel() override
+            {
+                BaseClass::Close(Core::infinite);
+            }
+
+        public:
+            uint32_t Connect(const uint32_t waitTime);
+            uint32_t Invoke(const uint32_t waitTime, const string& designator, const string& parameters, string& response);
+
+        private:
+            void Received(Core::ProxyType<Core::JSON::IElement>& element) override;
+            void Send(Core::ProxyType<Core::JSON::IElement>&) override
+            {
+            }
+            void StateChange() override
+            {
+                _signal.SetEvent();
+            }
+            bool IsIdle() const override
+            {
+                return (true);
+            }
+
+        private:
+            Factory& _factory;
+            Core::CriticalSection _adminLock;
+            Core::Event _signal;
+            uint32_t _id;
+            Core::ProxyType<Core::JSONRPC::Message> _response;
+        };
+
+        class Client : public Core::Thread {
+        private:
+            Client() = delete;
+            Client(const Client&) = delete;
+            Client& operator=(const Client&) = delete;
+
+        public:
+            Client(Benchmark& parent, const Core::NodeId& remoteNode);
+            ~Client() override;
+
+        public:
+            uint32_t Connect()
+            {
+                return (_channel != nullptr ? _channel->Connect(RequestTimeout) : Core::ERROR_NONE);
+            }
+            void Start(const uint64_t deadline)
+            {
+                _deadline = deadline;
+                Run();
+            }
+
+        private:
+            uint32_t Worker() override;
+            uint32_t Request(uint32_t& bytes, uint32_t& packageSize);
+
+        private:
+            Benchmark& _parent;
+            Channel* _channel;
+            uint64_t _deadline;
+            std::vector<uint8_t> _buffer;
+        };
+
+    public:
+        Benchmark() = delete;
+        Benchmark(const Benchmark&) = delete;
+        Benchmark& operator=(const Benchmark&) = delete;
+
+        // The clients stop early once abort is set.
+        Benchmark(HistogramStore& store, const string& callsign, const transport kind, const method call, const uint16_t size, const std::atomic<bool>& abort)
+            : _store(store)
+            , _callsign(callsign)
+            , _kind(kind)
+            , _call(call)
+            , _size(size)
+            , _abort(abort)
+            , _factory()
+            , _interface(nullptr)
+            , _payload()
+            , _encoded()
+            , _result(nullptr)
+        {
+        }
+        ~Benchmark()
+        {
+            ASSERT(_interface == nullptr);
+        }
+
+    public:
+        // Run for the given time, in milliseconds, with the given number of clients. The service is only
+        // needed to find the target over COM-RPC, the access point, host:port, of the framework only over JSON-RPC.
+        uint32_t Run(PluginHost::IShell* service, const string& access, const uint16_t concurrency, const uint32_t duration, Result& result);
+
+    private:
+        HistogramStore& _store;
+        const string _callsign;
+        const transport _kind;
+        const method _call;
+        const uint16_t _size;
+        const std::atomic<bool>& _abort;
+        Factory _factory;
+        Exchange::IPerformance* _interface;
+        std::vector<uint8_t> _payload;
+        string _encoded;
+        Result* _result;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,284 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <atomic>
+#include <thread>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Fixed memory, log-linear histogram of durations in microseconds, in the spirit of HdrHistogram. Values
+    // below SubBuckets are counted exactly. Every power of two above that is split in SubBuckets / 2 linear
+    // buckets, which bounds the error of a reported percentile to 2 / SubBuckets (6.25%). Recording a value
+    // is a few relaxed atomic operations, there are no locks.
+    class Histogram {
+    public:
+        static constexpr uint8_t SubBucketBits = 5;
+        static constexpr uint32_t SubBuckets = (1 << SubBucketBits);
+        static constexpr uint32_t Buckets = ((34 - SubBucketBits) * (SubBuckets / 2));
+
+    private:
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+    public:
+        Histogram()
+        {
+            Clear();
+        }
+        ~Histogram()
+        {
+        }
+
+    public:
+        void Record(const uint32_t value)
+        {
+            _counts[Index(value)].fetch_add(1, std::memory_order_relaxed);
+            _count.fetch_add(1, std::memory_order_relaxed);
+            _total.fetch_add(value, std::memory_order_relaxed);
+
+            uint32_t current = _minimum.load(std::memory_order_relaxed);
+            while ((value < current) && (_minimum.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)) {
+            }
+            current = _maximum.load(std::memory_order_relaxed);
+            while ((value > current) && (_maximum.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)) {
+            }
+        }
+        void Clear()
+        {
+            for (uint32_t index = 0; index < Buckets; index++) {
+                _counts[index].store(0, std::memory_order_relaxed);
+            }
+            _count.store(0, std::memory_order_relaxed);
+            _total.store(0, std::memory_order_relaxed);
+            _minimum.store(~0, std::memory_order_relaxed);
+            _maximum.store(0, std::memory_order_relaxed);
+        }
+        inline uint64_t Count() const
+        {
+            return (_count.load(std::memory_order_relaxed));
+        }
+        inline uint32_t Minimum() const
+        {
+            return (Count() == 0 ? 0 : _minimum.load(std::memory_order_relaxed));
+        }
+        inline uint32_t Maximum() const
+        {
+            return (_maximum.load(std::memory_order_relaxed));
+        }
+        inline uint32_t Average() const
+        {
+            const uint64_t count = Count();
+
+            return (count == 0 ? 0 : static_cast<uint32_t>(_total.load(std::memory_order_relaxed) / count));
+        }
+        // The value below which the given fraction, in per mille, of the samples falls. It reports the upper
+        // edge of the bucket it lands in, capped at the largest value seen.
+        uint32_t Percentile(const uint16_t perMille) const
+        {
+            const uint64_t count = Count();
+            uint32_t result = 0;
+
+            if (count != 0) {
+                const uint64_t rank = std::max(static_cast<uint64_t>(1), ((count * perMille) + 999) / 1000);
+                uint64_t seen = 0;
+                uint32_t index = 0;
+
+                while ((index < (Buckets - 1)) && ((seen += _counts[index].load(std::memory_order_relaxed)) < rank)) {
+                    index++;
+                }
+
+                result = std::min(Highest(index), Maximum());
+            }
+
+            return (result);
+        }
+
+    private:
+        static uint32_t Index(const uint32_t value)
+        {
+            uint32_t result = value;
+
+            if (value >= SubBuckets) {
+                uint8_t magnitude = 0;
+
+                while ((magnitude < 31) && ((value >> (magnitude + 1)) != 0)) {
+                    magnitude++;
+                }
+
+                const uint8_t shift = (magnitude - SubBucketBits + 1);
+                result = (shift * (SubBuckets / 2)) + (value >> shift);
+            }
+
+            return (result);
+        }
+        static uint32_t Highest(const uint32_t index)
+        {
+            uint32_t result = index;
+
+            if (index >= SubBuckets) {
+                const uint8_t shift = static_cast<uint8_t>((index / (SubBuckets / 2)) - 1);
+                const uint64_t sub = (index - (shift * (SubBuckets / 2)));
+
+                result = static_cast<uint32_t>(std::min(static_cast<uint64_t>(~static_cast<uint32_t>(0)), ((sub + 1) << shift) - 1));
+            }
+
+            return (result);
+        }
+
+    private:
+        std::atomic<uint32_t> _counts[Buckets];
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _total;
+        std::atomic<uint32_t> _minimum;
+        std::atomic<uint32_t> _maximum;
+    };
+
+    // All histograms, per stage and per package size, in two banks. Samples go into the active bank. Clearing
+    // flips the active bank and waits for the samples that were being recorded into the old bank to land,
+    // before that bank is wiped. A sample is never torn between the two and recording never blocks.
+    class HistogramStore {
+    public:
+        // Deserialization, execution and serialization are timed by the handlers of send, receive and exchange.
+        // Threadpool and communication need the caller to share our clock, they are timed from the timestamps
+        // on the request and the response. Total is the round trip of a benchmark call.
+        enum stage : uint8_t {
+            SERIALIZATION,
+            DESERIALIZATION,
+            EXECUTION,
+            THREADPOOL,
+            COMMUNICATION,
+            TOTAL,
+            STAGES
+        };
+
+        // Package sizes are grouped per power of two, everything of 64KB and up shares the last group.
+        static constexpr uint8_t SizeClasses = 18;
+
+    private:
+        HistogramStore(const HistogramStore&) = delete;
+        HistogramStore& operator=(const HistogramStore&) = delete;
+
+    public:
+        HistogramStore()
+            : _lock()
+            , _active(0)
+        {
+            _writers[0] = 0;
+            _writers[1] = 0;
+
+            for (uint8_t bank = 0; bank < 2; bank++) {
+                for (uint8_t index = 0; index < (STAGES * SizeClasses); index++) {
+                    _histograms[bank][index] = nullptr;
+                }
+            }
+        }
+        ~HistogramStore()
+        {
+            for (uint8_t bank = 0; bank < 2; bank++) {
+                for (uint8_t index = 0; index < (STAGES * SizeClasses); index++) {
+                    delete _histograms[bank][index].load();
+                }
+            }
+        }
+
+    public:
+        void Record(const stage which, const uint32_t packageSize, const uint32_t duration)
+        {
+            uint8_t bank = _active.load();
+
+            // Announce ourselves on the bank, and make sure it did not flip in the mean time.
+            _writers[bank].fetch_add(1);
+            while (_active.load() != bank) {
+                _writers[bank].fetch_sub(1);
+                bank = _active.load();
+                _writers[bank].fetch_add(1);
+            }
+
+            std::atomic<Histogram*>& slot(_histograms[bank][Slot(which, packageSize)]);
+            Histogram* histogram = slot.load();
+
+            if (histogram == nullptr) {
+                // Histograms are allocated on first use, most size classes are never used.
+                Histogram* created = new Histogram();
+
+                if (slot.compare_exchange_strong(histogram, created) == true) {
+                    histogram = created;
+                } else {
+                    delete created;
+                }
+            }
+
+            histogram->Record(duration);
+
+            _writers[bank].fetch_sub(1);
+        }
+        void Clear()
+        {
+            _lock.Lock();
+
+            const uint8_t old = _active.load();
+
+            _active.store(old ^ 1);
+
+            while (_writers[old].load() != 0) {
+                std::this_thread::yield();
+            }
+
+            for (uint8_t index = 0; index < (STAGES * SizeClasses); index++) {
+                Histogram* histogram = _histograms[old][index].load();
+
+                if (histogram != nullptr) {
+                    histogram->Clear();
+                }
+            }
+
+            _lock.Unlock();
+        }
+        // Histogram of the active bank, nullptr if nothing was recorded for it yet.
+        const Histogram* Get(const stage which, const uint32_t packageSize) const
+        {
+            return (_histograms[_active.load()][Slot(which, packageSize)].load());
+        }
+
+    private:
+        static uint8_t Slot(const stage which, const uint32_t packageSize)
+        {
+            uint8_t sizeClass = 0;
+
+            while (((packageSize >> sizeClass) != 0) && (sizeClass < (SizeClasses - 1))) {
+                sizeClass++;
+            }
+
+            return ((which * SizeClasses) + sizeClass);
+        }
+
+    private:
+        Core::CriticalSection _lock;
+        std::atomic<uint8_t> _active;
+        std::atomic<uint32_t> _writers[2];
+        std::atomic<Histogram*> _histograms[2][STAGES * SizeClasses];
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
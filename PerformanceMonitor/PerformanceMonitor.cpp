@@ -20,6 +20,31 @@
 #include "PerformanceMonitor.h"
 
 namespace WPEFramework {
+
+ENUM_CONVERSION_BEGIN(Plugin::Benchmark::transport)
+
+    { Plugin::Benchmark::transport::WEBSOCKET, _TXT("jsonrpc") },
+    { Plugin::Benchmark::transport::COMRPC, _TXT("comrpc") },
+
+    ENUM_CONVERSION_END(Plugin::Benchmark::transport);
+
+ENUM_CONVERSION_BEGIN(Plugin::Benchmark::method)
+
+    { Plugin::Benchmark::method::SEND, _TXT("send") },
+    { Plugin::Benchmark::method::RECEIVE, _TXT("receive") },
+    { Plugin::Benchmark::method::EXCHANGE, _TXT("exchange") },
+
+    ENUM_CONVERSION_END(Plugin::Benchmark::method);
+
+ENUM_CONVERSION_BEGIN(Plugin::PerformanceMonitor::state)
+
+    { Plugin::PerformanceMonitor::state::IDLE, _TXT("idle") },
+    { Plugin::PerformanceMonitor::state::RUNNING, _TXT("running") },
+    { Plugin::PerformanceMonitor::state::COMPLETED, _TXT("completed") },
+    { Plugin::PerformanceMonitor::state::FAILED, _TXT("failed") },
+
+    ENUM_CONVERSION_END(Plugin::PerformanceMonitor::state);
+
 namespace Plugin {
 
     SERVICE_REGISTRATION(PerformanceMonitor, 1, 0);
@@ -31,12 +56,36 @@ namespace Plugin {
 
         ASSERT(service != nullptr);
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
+        _service = service;
+
+        // The JSON-RPC benchmark clients connect back to the framework we run in.
+        Core::URL accessor(service->Accessor());
+
+        if ((accessor.IsValid() == true) && (accessor.Host().IsSet() == true)) {
+            _access = accessor.Host().Value() + ':' + Core::NumberType<uint16_t>(accessor.Port().IsSet() == true ? accessor.Port().Value() : 80).Text();
+        }
 
         return string();
     }
 
     /* virtual */ void PerformanceMonitor::Deinitialize(PluginHost::IShell* service)
     {
+        ASSERT(_service == service);
+
+        // Cut a running benchmark short, it uses the service.
+        _abort = true;
+        _job.Revoke();
+        _abort = false;
+
+        _adminLock.Lock();
+        if (_state == RUNNING) {
+            // Revoked before it got to run.
+            _state = FAILED;
+            _error = Core::ERROR_ABORTED;
+        }
+        _adminLock.Unlock();
+
+        _service = nullptr;
     }
 
     /* virtual */ string PerformanceMonitor::Information() const
@@ -44,47 +93,41 @@ namespace Plugin {
         // No additional info to report.
         return ((_T("The purpose of this plugin is provide ability to collect performance values of JSONRPC communication")));
     }
-    uint32_t PerformanceMonitor::RetrieveInfo(const uint32_t packageSize, JsonData::PerformanceMonitor::MeasurementData& measurementData) const {
+    uint32_t PerformanceMonitor::RetrieveInfo(const uint32_t packageSize, MeasurementData& measurementData) const {
         const PluginHost::PerformanceAdministrator::Statistics& statistics(PluginHost::PerformanceAdministrator::Instance().Retrieve(packageSize));
 
-        Measurement(statistics.Serialization(), measurementData.Serialization);
-        Measurement(statistics.Deserialization(), measurementData.Deserialization);
-        Measurement(statistics.Execution(),  measurementData.Execution);
-        Measurement(statistics.ThreadPool(), measurementData.Threadpool);
-        Measurement(statistics.Communication(), measurementData.Communication);
-        Measurement(statistics.Total(), measurementData.Total);
+        Measurement(statistics.Serialization(), HistogramStore::SERIALIZATION, packageSize, measurementData.Serialization);
+        Measurement(statistics.Deserialization(), HistogramStore::DESERIALIZATION, packageSize, measurementData.Deserialization);
+        Measurement(statistics.Execution(), HistogramStore::EXECUTION, packageSize, measurementData.Execution);
+        Measurement(statistics.ThreadPool(), HistogramStore::THREADPOOL, packageSize, measurementData.Threadpool);
+        Measurement(statistics.Communication(), HistogramStore::COMMUNICATION, packageSize, measurementData.Communication);
+        Measurement(statistics.Total(), HistogramStore::TOTAL, packageSize, measurementData.Total);
 
         return Core::ERROR_NONE;
     }
 
-    uint32_t PerformanceMonitor::Send(const JsonData::PerformanceMonitor::BufferInfo& data, Core::JSON::DecUInt32& result)
+    uint32_t PerformanceMonitor::Send(const BufferData& data, Core::JSON::DecUInt32& result)
     {
         uint16_t length = static_cast<uint16_t>(((data.Data.Value().length() * 6) + 7) / 8);
-        uint8_t* buffer = static_cast<uint8_t*>(ALLOCA(length));
+        std::vector<uint8_t> storage(length);
+        uint8_t* buffer = storage.data();
         Core::FromString(data.Data.Value(), buffer, length);
         result = length;
 
         return Core::ERROR_NONE;
     }
 
-    uint32_t PerformanceMonitor::Receive(const Core::JSON::DecUInt32& maxSize, JsonData::PerformanceMonitor::BufferInfo& data)
+    uint32_t PerformanceMonitor::Receive(const Core::JSON::DecUInt32& maxSize, BufferData& data)
     {
         string convertedBuffer;
 
-        uint32_t length = maxSize.Value();
-        uint8_t* buffer = static_cast<uint8_t*>(ALLOCA(length));
-
-        static uint8_t pattern[] = { 0x00, 0x66, 0xBB, 0xEE };
-        uint8_t patternLength = sizeof(pattern);
-        uint32_t index = 0;
-        uint8_t patternIndex = 0;
+        // The caller picks the size, keep it off the stack and within what a BufferData can describe.
+        const uint16_t length = static_cast<uint16_t>(std::min(maxSize.Value(), static_cast<uint32_t>(0xFFFF)));
+        std::vector<uint8_t> storage(length);
+        uint8_t* buffer = storage.data();
 
-        while (index < length) {
-
-            buffer[index++] = pattern[patternIndex++];
-
-            patternIndex %= (patternLength - 1);
-        }
+        static const uint8_t pattern[] = { 0x00, 0x66, 0xBB };
+        Fill(buffer, length, pattern, sizeof(pattern));
 
         Core::ToString(buffer, length, false, convertedBuffer);
         data.Data = convertedBuffer;
@@ -94,25 +137,18 @@ namespace Plugin {
         return Core::ERROR_NONE;
     }
 
-    uint32_t PerformanceMonitor::Exchange(const JsonData::PerformanceMonitor::BufferInfo& data, JsonData::PerformanceMonitor::BufferInfo& result)
+    uint32_t PerformanceMonitor::Exchange(const BufferData& data, BufferData& result)
     {
         string convertedBuffer;
 
         uint16_t length = static_cast<uint16_t>(data.Data.Value().length());
-        uint8_t* buffer = static_cast<uint8_t*>(ALLOCA(length));
+        std::vector<uint8_t> storage(length);
+        uint8_t* buffer = storage.data();
         Core::FromString(data.Data.Value(), buffer, length);
 
-        static uint8_t pattern[] = { 0x00, 0x77, 0xCC, 0x88 };
-        uint8_t patternLength = sizeof(pattern);
-        uint16_t index = 0;
-        uint8_t patternIndex = 0;
-
-        while (index < data.Length.Value()) {
-
-            buffer[index++] = pattern[patternIndex++];
-
-            patternIndex %= (patternLength - 1);
-        }
+        // Overwrite the start of what came in, but never past what was decoded.
+        static const uint8_t pattern[] = { 0x00, 0x77, 0xCC };
+        Fill(buffer, std::min(length, static_cast<uint16_t>(data.Length.Value())), pattern, sizeof(pattern));
 
         Core::ToString(buffer, length, false, convertedBuffer);
         result.Data = convertedBuffer;
@@ -121,5 +157,75 @@ namespace Plugin {
 
         return Core::ERROR_NONE;
     }
+
+    uint32_t PerformanceMonitor::Send(const uint16_t sendSize, const uint8_t buffer[])
+    {
+        DEBUG_VARIABLE(sendSize);
+        DEBUG_VARIABLE(buffer);
+
+        return Core::ERROR_NONE;
+    }
+
+    uint32_t PerformanceMonitor::Receive(uint16_t& bufferSize, uint8_t buffer[])
+    {
+        static const uint8_t pattern[] = { 0x00, 0x66, 0xBB };
+        Fill(buffer, bufferSize, pattern, sizeof(pattern));
+
+        return Core::ERROR_NONE;
+    }
+
+    uint32_t PerformanceMonitor::Exchange(uint16_t& bufferSize, uint8_t buffer[], const uint16_t maxBufferSize)
+    {
+        static const uint8_t pattern[] = { 0x00, 0x77, 0xCC };
+        Fill(buffer, std::min(bufferSize, maxBufferSize), pattern, sizeof(pattern));
+
+        return Core::ERROR_NONE;
+    }
+
+    void PerformanceMonitor::Dispatch()
+    {
+        uint32_t result = Core::ERROR_NONE;
+
+        _adminLock.Lock();
+        const Settings settings(_settings);
+        _adminLock.Unlock();
+
+        std::list<uint16_t>::const_iterator size(settings.Sizes.begin());
+
+        while ((result == Core::ERROR_NONE) && (size != settings.Sizes.end()) && (_abort == false)) {
+            Benchmark benchmark(_histograms, settings.Callsign, settings.Transport, settings.Method, *size, _abort);
+            Benchmark::Result outcome;
+
+            result = benchmark.Run(_service, _access, settings.Concurrency, settings.Duration * 1000, outcome);
+
+            if (result == Core::ERROR_NONE) {
+                ReportData::RunData run;
+                const uint64_t elapsed = std::max(outcome.Duration, static_cast<uint64_t>(1));
+
+                run.Size = *size;
+                run.Requests = outcome.Requests.load();
+                run.Errors = outcome.Errors.load();
+                run.RequestsPerSecond = static_cast<uint32_t>((outcome.Requests.load() * 1000000) / elapsed);
+                run.BytesPerSecond = (outcome.Bytes.load() * 1000000) / elapsed;
+                Measurement(outcome.Latency, run.Latency);
+
+                _adminLock.Lock();
+                _runs.push_back(run);
+                _adminLock.Unlock();
+            }
+
+            size++;
+        }
+
+        if ((result == Core::ERROR_NONE) && (_abort == true)) {
+            result = Core::ERROR_ABORTED;
+        }
+
+        _adminLock.Lock();
+        _state = (result == Core::ERROR_NONE ? COMPLETED : FAILED);
+        _error = result;
+        _adminLock.Unlock();
+    }
+
 } // namespace Plugin
 } // namespace WPEFramework
@@ -20,20 +20,319 @@
 #pragma once
 
 #include "Module.h"
-
-#include <interfaces/json/JsonData_PerformanceMonitor.h>
+#include "Benchmark.h"
+#include "Histogram.h"
 
 namespace WPEFramework {
 namespace Plugin {
 
-    class PerformanceMonitor : public PluginHost::IPlugin, public PluginHost::JSONRPC {
+    class PerformanceMonitor : public PluginHost::IPlugin, public PluginHost::JSONRPC, public Exchange::IPerformance {
     public:
         PerformanceMonitor(const PerformanceMonitor&) = delete;
         PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
 
+        enum state : uint8_t {
+            IDLE,
+            RUNNING,
+            COMPLETED,
+            FAILED
+        };
+
+    public:
+        // The containers below are specified in PerformanceMonitorPlugin.json. They are kept here, the ones of
+        // the interface do not carry the timestamps nor the percentiles.
+
+        // Payload of send, receive and exchange. The timestamp is optional, microseconds since the epoch. A caller
+        // on the same device stamps its request with it, so the plugin can tell how long the request took to come
+        // in. The plugin stamps its response, so the caller can tell how long it took to come back.
+        class BufferData : public Core::JSON::Container {
+        private:
+            BufferData(const BufferData&) = delete;
+            BufferData& operator=(const BufferData&) = delete;
+
+        public:
+            BufferData()
+                : Core::JSON::Container()
+            {
+                Add(_T("data"), &Data);
+                Add(_T("length"), &Length);
+                Add(_T("duration"), &Duration);
+                Add(_T("timestamp"), &Timestamp);
+            }
+            ~BufferData()
+            {
+            }
+
+        public:
+            Core::JSON::String Data;
+            Core::JSON::DecUInt16 Length;
+            Core::JSON::DecUInt16 Duration;
+            Core::JSON::DecUInt64 Timestamp;
+        };
+
+        // Latency distribution of the samples the plugin took itself, all durations in microseconds.
+        class PercentilesData : public Core::JSON::Container {
+        private:
+            PercentilesData& operator=(const PercentilesData&) = delete;
+
+        public:
+            PercentilesData()
+                : Core::JSON::Container()
+            {
+                Init();
+            }
+            PercentilesData(const PercentilesData& copy)
+                : Core::JSON::Container()
+                , Count(copy.Count)
+                , P50(copy.P50)
+                , P90(copy.P90)
+                , P99(copy.P99)
+                , P999(copy.P999)
+            {
+                Init();
+            }
+            ~PercentilesData()
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt64 Count;
+            Core::JSON::DecUInt32 P50;
+            Core::JSON::DecUInt32 P90;
+            Core::JSON::DecUInt32 P99;
+            Core::JSON::DecUInt32 P999;
+
+        private:
+            void Init()
+            {
+                Add(_T("count"), &Count);
+                Add(_T("p50"), &P50);
+                Add(_T("p90"), &P90);
+                Add(_T("p99"), &P99);
+                Add(_T("p999"), &P999);
+            }
+        };
+
+        class StageData : public Core::JSON::Container {
+        private:
+            StageData& operator=(const StageData&) = delete;
+
+        public:
+            StageData()
+                : Core::JSON::Container()
+            {
+                Init();
+            }
+            StageData(const StageData& copy)
+                : Core::JSON::Container()
+                , Minimum(copy.Minimum)
+                , Maximum(copy.Maximum)
+                , Average(copy.Average)
+                , Count(copy.Count)
+                , Percentiles(copy.Percentiles)
+            {
+                Init();
+            }
+            ~StageData()
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt32 Minimum;
+            Core::JSON::DecUInt32 Maximum;
+            Core::JSON::DecUInt32 Average;
+            Core::JSON::DecUInt64 Count;
+            PercentilesData Percentiles;
+
+        private:
+            void Init()
+            {
+                Add(_T("minimum"), &Minimum);
+                Add(_T("maximum"), &Maximum);
+                Add(_T("average"), &Average);
+                Add(_T("count"), &Count);
+                Add(_T("percentiles"), &Percentiles);
+            }
+        };
+
+        class MeasurementData : public Core::JSON::Container {
+        private:
+            MeasurementData(const MeasurementData&) = delete;
+            MeasurementData& operator=(const MeasurementData&) = delete;
+
+        public:
+            MeasurementData()
+                : Core::JSON::Container()
+            {
+                Add(_T("serialization"), &Serialization);
+                Add(_T("deserialization"), &Deserialization);
+                Add(_T("execution"), &Execution);
+                Add(_T("threadpool"), &Threadpool);
+                Add(_T("communication"), &Communication);
+                Add(_T("total"), &Total);
+            }
+            ~MeasurementData()
+            {
+            }
+
+        public:
+            StageData Serialization;
+            StageData Deserialization;
+            StageData Execution;
+            StageData Threadpool;
+            StageData Communication;
+            StageData Total;
+        };
+
+        class BenchmarkParams : public Core::JSON::Container {
+        private:
+            BenchmarkParams(const BenchmarkParams&) = delete;
+            BenchmarkParams& operator=(const BenchmarkParams&) = delete;
+
+        public:
+            BenchmarkParams()
+                : Core::JSON::Container()
+                , Callsign(_T("PerformanceMonitor"))
+                , Transport(Benchmark::WEBSOCKET)
+                , Method(Benchmark::EXCHANGE)
+                , Concurrency(4)
+                , Sizes()
+                , Duration(5)
+            {
+                Add(_T("callsign"), &Callsign);
+                Add(_T("transport"), &Transport);
+                Add(_T("method"), &Method);
+                Add(_T("concurrency"), &Concurrency);
+                Add(_T("sizes"), &Sizes);
+                Add(_T("duration"), &Duration);
+            }
+            ~BenchmarkParams()
+            {
+            }
+
+        public:
+            Core::JSON::String Callsign;
+            Core::JSON::EnumType<Benchmark::transport> Transport;
+            Core::JSON::EnumType<Benchmark::method> Method;
+            Core::JSON::DecUInt16 Concurrency;
+            Core::JSON::ArrayType<Core::JSON::DecUInt16> Sizes; // Payload sizes, in bytes, one run per size
+            Core::JSON::DecUInt16 Duration; // Seconds per run
+        };
+
+        // Progress of the benchmark, the runs done so far.
+        class ReportData : public Core::JSON::Container {
+        public:
+            class RunData : public Core::JSON::Container {
+            public:
+                RunData()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                RunData(const RunData& copy)
+                    : Core::JSON::Container()
+                    , Size(copy.Size)
+                    , Requests(copy.Requests)
+                    , Errors(copy.Errors)
+                    , RequestsPerSecond(copy.RequestsPerSecond)
+                    , BytesPerSecond(copy.BytesPerSecond)
+                    , Latency(copy.Latency)
+                {
+                    Init();
+                }
+                RunData& operator=(const RunData& rhs)
+                {
+                    Size = rhs.Size;
+                    Requests = rhs.Requests;
+                    Errors = rhs.Errors;
+                    RequestsPerSecond = rhs.RequestsPerSecond;
+                    BytesPerSecond = rhs.BytesPerSecond;
+                    Latency.Minimum = rhs.Latency.Minimum;
+                    Latency.Maximum = rhs.Latency.Maximum;
+                    Latency.Average = rhs.Latency.Average;
+                    Latency.Count = rhs.Latency.Count;
+                    Latency.Percentiles.Count = rhs.Latency.Percentiles.Count;
+                    Latency.Percentiles.P50 = rhs.Latency.Percentiles.P50;
+                    Latency.Percentiles.P90 = rhs.Latency.Percentiles.P90;
+                    Latency.Percentiles.P99 = rhs.Latency.Percentiles.P99;
+                    Latency.Percentiles.P999 = rhs.Latency.Percentiles.P999;
+                    return (*this);
+                }
+                ~RunData()
+                {
+                }
+
+            public:
+                Core::JSON::DecUInt16 Size;
+                Core::JSON::DecUInt64 Requests;
+                Core::JSON::DecUInt64 Errors;
+                Core::JSON::DecUInt32 RequestsPerSecond;
+                Core::JSON::DecUInt64 BytesPerSecond;
+                StageData Latency;
+
+            private:
+                void Init()
+                {
+                    Add(_T("size"), &Size);
+                    Add(_T("requests"), &Requests);
+                    Add(_T("errors"), &Errors);
+                    Add(_T("requestspersecond"), &RequestsPerSecond);
+                    Add(_T("bytespersecond"), &BytesPerSecond);
+                    Add(_T("latency"), &Latency);
+                }
+            };
+
+        private:
+            ReportData(const ReportData&) = delete;
+            ReportData& operator=(const ReportData&) = delete;
+
+        public:
+            ReportData()
+                : Core::JSON::Container()
+            {
+                Add(_T("state"), &State);
+                Add(_T("error"), &Error);
+                Add(_T("runs"), &Runs);
+            }
+            ~ReportData()
+            {
+            }
+
+        public:
+            Core::JSON::EnumType<state> State;
+            Core::JSON::DecUInt32 Error; // Only set if it failed
+            Core::JSON::ArrayType<RunData> Runs;
+        };
+
+    public:
+        // A benchmark runs as a job, on a thread of the worker pool. Cap what one can hold it for.
+        static constexpr uint16_t MaxBenchmarkDuration = 60; // Seconds, of all runs together
+        static constexpr uint8_t MaxBenchmarkSizes = 8;
+
+    private:
+        // What the benchmark job is to run, taken from the parameters of the benchmark method.
+        struct Settings {
+            string Callsign;
+            Benchmark::transport Transport;
+            Benchmark::method Method;
+            uint16_t Concurrency;
+            uint16_t Duration;
+            std::list<uint16_t> Sizes;
+        };
+
     public:
         PerformanceMonitor()
             : _skipURL(0)
+            , _service(nullptr)
+            , _access()
+            , _histograms()
+            , _adminLock()
+            , _settings()
+            , _state(IDLE)
+            , _error(Core::ERROR_NONE)
+            , _runs()
+            , _abort(false)
+            , _job(*this)
         {
             RegisterAll();
         }
@@ -46,6 +345,7 @@ namespace Plugin {
         BEGIN_INTERFACE_MAP(PerformanceMonitor)
         INTERFACE_ENTRY(PluginHost::IPlugin)
         INTERFACE_ENTRY(PluginHost::IDispatcher)
+        INTERFACE_ENTRY(WPEFramework::Exchange::IPerformance)
         END_INTERFACE_MAP
 
         //   IPlugin methods
@@ -54,30 +354,153 @@ namespace Plugin {
         virtual void Deinitialize(PluginHost::IShell* service) override;
         virtual string Information() const override;
 
+        //   IPerformance methods, the payload goes as is, there is nothing to time but the call itself
+        // -------------------------------------------------------------------------------------------------------
+        uint32_t Send(const uint16_t sendSize, const uint8_t buffer[]) override;
+        uint32_t Receive(uint16_t& bufferSize, uint8_t buffer[]) override;
+        uint32_t Exchange(uint16_t& bufferSize, uint8_t buffer[], const uint16_t maxBufferSize) override;
+
+        // Worker pool job, runs the benchmark.
+        void Dispatch();
+
     private:
         void RegisterAll();
         void UnregisterAll();
         uint32_t endpoint_clear();
-        uint32_t endpoint_send(const JsonData::PerformanceMonitor::BufferInfo& params, Core::JSON::DecUInt32& response);
-        uint32_t endpoint_receive(const Core::JSON::DecUInt32& params, JsonData::PerformanceMonitor::BufferInfo& response);
-        uint32_t endpoint_exchange(const JsonData::PerformanceMonitor::BufferInfo& params, JsonData::PerformanceMonitor::BufferInfo& response);
-        uint32_t get_measurement(const string& index, JsonData::PerformanceMonitor::MeasurementData& response) const;
-
-        uint32_t RetrieveInfo(const uint32_t packageSize, JsonData::PerformanceMonitor::MeasurementData& measurementData) const;
-        uint32_t Send(const JsonData::PerformanceMonitor::BufferInfo& data, Core::JSON::DecUInt32& result);
-        uint32_t Receive(const Core::JSON::DecUInt32& maxSize, JsonData::PerformanceMonitor::BufferInfo& data);
-        uint32_t Exchange(const JsonData::PerformanceMonitor::BufferInfo& data, JsonData::PerformanceMonitor::BufferInfo& result);
-
-        inline void Measurement(const PluginHost::PerformanceAdministrator::Statistics::Tuple& statistics, JsonData::PerformanceMonitor::MeasurementData::StatisticsData& statisticsData) const {
-
-            statisticsData.Minimum = statistics.Minimum();
-            statisticsData.Maximum = statistics.Maximum();
-            statisticsData.Average = statistics.Average();
-            statisticsData.Count = statistics.Count();
+        uint32_t endpoint_send(const string& params, string& response);
+        uint32_t endpoint_receive(const string& params, string& response);
+        uint32_t endpoint_exchange(const string& params, string& response);
+        uint32_t endpoint_benchmark(const BenchmarkParams& params);
+        uint32_t get_measurement(const string& index, MeasurementData& response) const;
+        uint32_t get_report(ReportData& response) const;
+
+        uint32_t RetrieveInfo(const uint32_t packageSize, MeasurementData& measurementData) const;
+        uint32_t Send(const BufferData& data, Core::JSON::DecUInt32& result);
+        uint32_t Receive(const Core::JSON::DecUInt32& maxSize, BufferData& data);
+        uint32_t Exchange(const BufferData& data, BufferData& result);
+
+        // The send, receive and exchange handlers take the parameters as text and hand back the response as text,
+        // so the (de)serialization of a call can be timed along with its execution. Samples are filed under the
+        // size of the data carried, the larger of the request and the response.
+        template <typename INBOUND, typename OUTBOUND>
+        uint32_t Timed(const string& params, string& response, uint32_t (PerformanceMonitor::*handler)(const INBOUND&, OUTBOUND&))
+        {
+            INBOUND inbound;
+            OUTBOUND outbound;
+
+            const uint64_t start = Core::Time::Now().Ticks();
+            inbound.FromString(params);
+            const uint64_t decoded = Core::Time::Now().Ticks();
+            const uint32_t result = (this->*handler)(inbound, outbound);
+            const uint64_t executed = Core::Time::Now().Ticks();
+
+            Stamp(outbound, executed);
+
+            if (result == Core::ERROR_NONE) {
+                outbound.ToString(response);
+            }
+
+            const uint64_t encoded = Core::Time::Now().Ticks();
+            const uint64_t sent = Stamp(inbound);
+            const uint32_t packageSize = std::max(Size(inbound), Size(outbound));
+
+            _histograms.Record(HistogramStore::DESERIALIZATION, packageSize, static_cast<uint32_t>(decoded - start));
+            _histograms.Record(HistogramStore::EXECUTION, packageSize, static_cast<uint32_t>(executed - decoded));
+            _histograms.Record(HistogramStore::SERIALIZATION, packageSize, static_cast<uint32_t>(encoded - executed));
+
+            // A stamp from another clock, or none at all, tells nothing.
+            if ((sent != 0) && (sent <= start)) {
+                _histograms.Record(HistogramStore::THREADPOOL, packageSize, static_cast<uint32_t>(start - sent));
+            }
+
+            return (result);
+        }
+        static inline uint32_t Size(const BufferData& data)
+        {
+            return (static_cast<uint32_t>(data.Data.Value().length()));
+        }
+        static inline uint32_t Size(const Core::JSON::DecUInt32&)
+        {
+            return (0);
+        }
+        static inline uint64_t Stamp(const BufferData& data)
+        {
+            return (data.Timestamp.IsSet() == true ? data.Timestamp.Value() : 0);
+        }
+        static inline uint64_t Stamp(const Core::JSON::DecUInt32&)
+        {
+            return (0);
+        }
+        static inline void Stamp(BufferData& data, const uint64_t time)
+        {
+            data.Timestamp = time;
+        }
+        static inline void Stamp(Core::JSON::DecUInt32&, const uint64_t)
+        {
+        }
+
+        // Repeat the pattern over the buffer. It is laid down once and then doubled with every copy, which
+        // touches each byte once instead of stepping through the pattern per byte.
+        static void Fill(uint8_t buffer[], const uint16_t length, const uint8_t pattern[], const uint8_t patternLength)
+        {
+            uint16_t filled = std::min(length, static_cast<uint16_t>(patternLength));
+
+            ::memcpy(buffer, pattern, filled);
+
+            while (filled < length) {
+                const uint16_t chunk = std::min(filled, static_cast<uint16_t>(length - filled));
+                ::memcpy(&buffer[filled], buffer, chunk);
+                filled += chunk;
+            }
+        }
+        // Minimum, maximum, average and count are those of the framework, the percentiles those of the samples
+        // the plugin took itself. Percentiles of stages without samples are left out.
+        inline void Measurement(const PluginHost::PerformanceAdministrator::Statistics::Tuple& statistics, const HistogramStore::stage stage, const uint32_t packageSize, StageData& stageData) const {
+
+            const Histogram* histogram = _histograms.Get(stage, packageSize);
+
+            stageData.Minimum = statistics.Minimum();
+            stageData.Maximum = statistics.Maximum();
+            stageData.Average = statistics.Average();
+            stageData.Count = statistics.Count();
+
+            if (histogram != nullptr) {
+                Percentiles(*histogram, stageData.Percentiles);
+            }
+        }
+        inline void Measurement(const Histogram& histogram, StageData& stageData) const {
+
+            if (histogram.Count() != 0) {
+                stageData.Minimum = histogram.Minimum();
+                stageData.Maximum = histogram.Maximum();
+                stageData.Average = histogram.Average();
+                stageData.Count = histogram.Count();
+                Percentiles(histogram, stageData.Percentiles);
+            }
+        }
+        inline void Percentiles(const Histogram& histogram, PercentilesData& percentilesData) const {
+
+            if (histogram.Count() != 0) {
+                percentilesData.Count = histogram.Count();
+                percentilesData.P50 = histogram.Percentile(500);
+                percentilesData.P90 = histogram.Percentile(900);
+                percentilesData.P99 = histogram.Percentile(990);
+                percentilesData.P999 = histogram.Percentile(999);
+            }
         }
 
     private:
         uint8_t _skipURL;
+        PluginHost::IShell* _service;
+        string _access; // host:port of the framework, for the JSON-RPC benchmark clients
+        HistogramStore _histograms;
+        mutable Core::CriticalSection _adminLock;
+        Settings _settings;
+        state _state;
+        uint32_t _error;
+        std::list<ReportData::RunData> _runs;
+        std::atomic<bool> _abort;
+        Core::WorkerPool::JobType<PerformanceMonitor&> _job;
     };
 
 } // namespace Plugin
@@ -1,22 +1,27 @@
 #include "Module.h"
 #include "PerformanceMonitor.h"
-#include <interfaces/json/JsonData_PerformanceMonitor.h>
 
 namespace WPEFramework {
 namespace Plugin {
 
-    using namespace JsonData::PerformanceMonitor;
-
     // Registration
     //
 
     void PerformanceMonitor::RegisterAll()
     {
         Register<void,void>(_T("clear"), &PerformanceMonitor::endpoint_clear, this);
-        Register<BufferInfo,Core::JSON::DecUInt32>(_T("send"), &PerformanceMonitor::endpoint_send, this);
-        Register<Core::JSON::DecUInt32,BufferInfo>(_T("receive"), &PerformanceMonitor::endpoint_receive, this);
-        Register<BufferInfo,BufferInfo>(_T("exchange"), &PerformanceMonitor::endpoint_exchange, this);
+        Register(_T("send"), Core::JSONRPC::InvokeFunction([this](const Core::JSONRPC::Context&, const string&, const string& params, string& response) -> uint32_t {
+            return (endpoint_send(params, response));
+        }));
+        Register(_T("receive"), Core::JSONRPC::InvokeFunction([this](const Core::JSONRPC::Context&, const string&, const string& params, string& response) -> uint32_t {
+            return (endpoint_receive(params, response));
+        }));
+        Register(_T("exchange"), Core::JSONRPC::InvokeFunction([this](const Core::JSONRPC::Context&, const string&, const string& params, string& response) -> uint32_t {
+            return (endpoint_exchange(params, response));
+        }));
+        Register<BenchmarkParams,void>(_T("benchmark"), &PerformanceMonitor::endpoint_benchmark, this);
         Property<MeasurementData>(_T("measurement"), &PerformanceMonitor::get_measurement, nullptr, this);
+        Property<ReportData>(_T("report"), &PerformanceMonitor::get_report, nullptr, this);
     }
 
     void PerformanceMonitor::UnregisterAll()
@@ -24,8 +29,10 @@ namespace Plugin {
         Unregister(_T("send"));
         Unregister(_T("receive"));
         Unregister(_T("exchange"));
+        Unregister(_T("benchmark"));
         Unregister(_T("clear"));
         Unregister(_T("measurement"));
+        Unregister(_T("report"));
     }
 
     // API implementation
@@ -37,32 +44,90 @@ namespace Plugin {
     uint32_t PerformanceMonitor::endpoint_clear()
     {
         PluginHost::PerformanceAdministrator::Instance().Clear();
+        _histograms.Clear();
         return Core::ERROR_NONE;
     }
 
     // Method: send - Interface to test sending data
     // Return codes:
     //  - ERROR_NONE: Success
-    uint32_t PerformanceMonitor::endpoint_send(const BufferInfo& params, Core::JSON::DecUInt32& response)
+    uint32_t PerformanceMonitor::endpoint_send(const string& params, string& response)
+    {
+        return Timed<BufferData, Core::JSON::DecUInt32>(params, response, &PerformanceMonitor::Send);
+    }
+
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::endpoint_receive(const string& params, string& response)
     {
-        return Send(params, response);
+        return Timed<Core::JSON::DecUInt32, BufferData>(params, response, &PerformanceMonitor::Receive);
     }
 
     // Return codes:
     //  - ERROR_NONE: Success
-    uint32_t PerformanceMonitor::endpoint_receive(const Core::JSON::DecUInt32& params, BufferInfo& response)
+    uint32_t PerformanceMonitor::endpoint_exchange(const string& params, string& response)
     {
-        return Receive(params, response);
+        return Timed<BufferData, BufferData>(params, response, &PerformanceMonitor::Exchange);
     }
 
+    // Method: benchmark - Start a load against the send, receive or exchange interface of a plugin
     // Return codes:
     //  - ERROR_NONE: Success
-    uint32_t PerformanceMonitor::endpoint_exchange(const BufferInfo& params, BufferInfo& response)
+    //  - ERROR_BAD_REQUEST: Concurrency, duration, the number of sizes or one of the sizes is out of range
+    //  - ERROR_INPROGRESS: A benchmark is running already
+    //  - ERROR_ILLEGAL_STATE: The plugin is not initialized
+    uint32_t PerformanceMonitor::endpoint_benchmark(const BenchmarkParams& params)
     {
-        return Exchange(params, response);
+        uint32_t result = Core::ERROR_NONE;
+        const uint16_t concurrency = params.Concurrency.Value();
+        const uint16_t duration = params.Duration.Value();
+        std::list<uint16_t> sizes;
+
+        if (params.Sizes.IsSet() == false) {
+            sizes = { 64, 1024, 16384 };
+        } else {
+            Core::JSON::ArrayType<Core::JSON::DecUInt16>::ConstIterator index(params.Sizes.Elements());
+
+            while (index.Next() == true) {
+                sizes.push_back(index.Current().Value());
+            }
+        }
+
+        if (_service == nullptr) {
+            result = Core::ERROR_ILLEGAL_STATE;
+        } else if ((concurrency == 0) || (concurrency > Benchmark::MaxConcurrency) || (duration == 0) || (sizes.empty() == true) || (sizes.size() > MaxBenchmarkSizes)) {
+            result = Core::ERROR_BAD_REQUEST;
+        } else if ((static_cast<uint32_t>(duration) * sizes.size()) > MaxBenchmarkDuration) {
+            // One run per size, the total is what keeps the job busy.
+            result = Core::ERROR_BAD_REQUEST;
+        } else if (std::find(sizes.begin(), sizes.end(), 0) != sizes.end()) {
+            result = Core::ERROR_BAD_REQUEST;
+        } else {
+            _adminLock.Lock();
+
+            if (_state == RUNNING) {
+                result = Core::ERROR_INPROGRESS;
+            } else {
+                _settings.Callsign = params.Callsign.Value();
+                _settings.Transport = params.Transport.Value();
+                _settings.Method = params.Method.Value();
+                _settings.Concurrency = concurrency;
+                _settings.Duration = duration;
+                _settings.Sizes = sizes;
+                _state = RUNNING;
+                _error = Core::ERROR_NONE;
+                _runs.clear();
+                _job.Submit();
+            }
+
+            _adminLock.Unlock();
+        }
+
+        return result;
     }
 
-    // Property: measurement - Retrieve the performance measurement against given package size
+    // Property: measurement - Retrieve the performance measurement against given package size, with the
+    // percentiles of the samples taken by the plugin
     // Return codes:
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::get_measurement(const string& index, MeasurementData& response) const
@@ -71,6 +136,27 @@ namespace Plugin {
         return RetrieveInfo(packageSize, response);
     }
 
+    // Property: report - Progress and outcome of the last benchmark
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::get_report(ReportData& response) const
+    {
+        _adminLock.Lock();
+
+        response.State = _state;
+
+        if (_state == FAILED) {
+            response.Error = _error;
+        }
+
+        for (const ReportData::RunData& run : _runs) {
+            response.Runs.Add(run);
+        }
+
+        _adminLock.Unlock();
+
+        return Core::ERROR_NONE;
+    }
+
 } // namespace Plugin
 }
-
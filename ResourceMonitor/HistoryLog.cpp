@@ -0,0 +1,376 @@
+#include "HistoryLog.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    static_assert(sizeof(HistoryLog::Header) == 64, "The header layout is part of the file format");
+    static_assert(sizeof(HistoryLog::Record) == 72, "The record layout is part of the file format");
+
+    static const TCHAR CsvHeader[] = _T("time (s)\tjiffies\tVSS\tUSS\tPSS\tswap\tprocess jiffies\tCPU (%)\tthreads\tread (B)\twritten (B)\tvoluntary switches\tinvoluntary switches\tprocess\n");
+
+    // Widths of the numeric columns, wide enough for any value so every row is equally long.
+    static constexpr uint8_t Width16 = 5;
+    static constexpr uint8_t Width32 = 10;
+    static constexpr uint8_t Width64 = 20;
+    static constexpr uint8_t WidthLoad = Width32 - 2; // Whole percents, the decimal point and one decimal fill the rest.
+    static constexpr uint8_t Columns = 14;
+
+    HistoryLog::Writer::Writer()
+        : _fd(-1)
+        , _header()
+        , _names()
+    {
+        for (uint16_t index = 0; index < MaxNames; index++) {
+            _lastUsed[index] = 0;
+        }
+    }
+
+    HistoryLog::Writer::~Writer()
+    {
+        Close();
+    }
+
+    uint32_t HistoryLog::Writer::Open(const string& path, const uint32_t size)
+    {
+        uint32_t result = Core::ERROR_OPENING_FAILED;
+
+        ASSERT(_fd == -1);
+
+        const uint64_t available = (static_cast<uint64_t>(size) * 1024);
+        const uint32_t capacity = static_cast<uint32_t>(std::max(static_cast<uint64_t>(16), (available > RecordsOffset ? (available - RecordsOffset) / sizeof(Record) : 0)));
+
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        if (_fd != -1) {
+            if ((::pread(_fd, &_header, sizeof(_header), 0) == sizeof(_header)) && (_header.Magic == Magic) && (_header.Version == Version) && (_header.RecordSize == sizeof(Record)) && (_header.Capacity == capacity)) {
+                char names[MaxNames][NameSize];
+
+                if (::pread(_fd, names, sizeof(names), NamesOffset) == sizeof(names)) {
+                    for (uint16_t index = 0; index < MaxNames; index++) {
+                        if (names[index][0] != '\0') {
+                            _slots[index] = string(names[index], ::strnlen(names[index], NameSize - 1));
+                            _names[_slots[index]] = index;
+                        }
+                        // Whatever was logged before may still be in the ring.
+                        _lastUsed[index] = _header.Next - 1;
+                    }
+
+                    result = Core::ERROR_NONE;
+                }
+            }
+
+            if (result != Core::ERROR_NONE) {
+                // Not ours, or from a different configuration, start over.
+                ::memset(&_header, 0, sizeof(_header));
+                _header.Magic = Magic;
+                _header.Version = Version;
+                _header.RecordSize = sizeof(Record);
+                _header.Capacity = capacity;
+
+                if ((::ftruncate(_fd, 0) == 0) && (::ftruncate(_fd, RecordsOffset + (static_cast<uint64_t>(capacity) * sizeof(Record))) == 0) && (::pwrite(_fd, &_header, sizeof(_header), 0) == sizeof(_header))) {
+                    result = Core::ERROR_NONE;
+                }
+            }
+
+            if (result != Core::ERROR_NONE) {
+                Close();
+            }
+        }
+
+        return (result);
+    }
+
+    void HistoryLog::Writer::Close()
+    {
+        if (_fd != -1) {
+            ::close(_fd);
+            _fd = -1;
+        }
+        _names.clear();
+        for (uint16_t index = 0; index < MaxNames; index++) {
+            _slots[index].clear();
+        }
+    }
+
+    bool HistoryLog::Writer::Append(const string& name, Record& record)
+    {
+        bool result = false;
+
+        if (_fd != -1) {
+            const uint16_t index = Intern(name);
+
+            if (index != InvalidName) {
+                record.Sequence = _header.Next;
+                record.Name = index;
+
+                const off_t offset = RecordsOffset + (static_cast<off_t>(record.Sequence % _header.Capacity) * sizeof(Record));
+
+                if (::pwrite(_fd, &record, sizeof(record), offset) == sizeof(record)) {
+                    _lastUsed[index] = record.Sequence;
+                    _header.Next++;
+                    _header.Count = std::min(_header.Count + 1, _header.Capacity);
+
+                    // Next and Count are adjacent, readers see both change at once.
+                    ::pwrite(_fd, &(reinterpret_cast<const uint8_t*>(&_header)[offsetof(Header, Next)]), sizeof(_header.Next) + sizeof(_header.Count), offsetof(Header, Next));
+
+                    result = true;
+                }
+            } else {
+                TRACE_L1("No room to log %s, all %d names are in use", name.c_str(), MaxNames);
+            }
+        }
+
+        return (result);
+    }
+
+    uint16_t HistoryLog::Writer::Intern(const string& name)
+    {
+        uint16_t result = InvalidName;
+        std::map<string, uint16_t>::const_iterator entry(_names.find(name));
+
+        if (entry != _names.end()) {
+            result = entry->second;
+        } else {
+            const uint32_t oldest = _header.Next - _header.Count;
+
+            // A free slot, or else the slot of a name none of the records in the ring refers to anymore.
+            for (uint16_t index = 0; (index < MaxNames) && ((result == InvalidName) || (_slots[result].empty() == false)); index++) {
+                if ((_slots[index].empty() == true) || (static_cast<int32_t>(_lastUsed[index] - oldest) < 0)) {
+                    result = index;
+                }
+            }
+
+            if (result != InvalidName) {
+                char text[NameSize];
+
+                ::memset(text, 0, sizeof(text));
+                ::strncpy(text, name.c_str(), sizeof(text) - 1);
+
+                if (::pwrite(_fd, text, sizeof(text), NamesOffset + (result * NameSize)) == sizeof(text)) {
+                    if (_slots[result].empty() == false) {
+                        _names.erase(_slots[result]);
+                    }
+                    _slots[result] = name;
+                    _names[name] = result;
+                } else {
+                    result = InvalidName;
+                }
+            }
+        }
+
+        return (result);
+    }
+
+    HistoryLog::Reader::Reader()
+        : _fd(-1)
+        , _header()
+        , _longest(0)
+    {
+    }
+
+    HistoryLog::Reader::~Reader()
+    {
+        Close();
+    }
+
+    uint32_t HistoryLog::Reader::Open(const string& path)
+    {
+        uint32_t result = Core::ERROR_OPENING_FAILED;
+
+        ASSERT(_fd == -1);
+
+        _fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (_fd != -1) {
+            // Header first, names added after it are not referred to by any of the records it covers.
+            if ((::pread(_fd, &_header, sizeof(_header), 0) == sizeof(_header)) && (_header.Magic == Magic) && (_header.Version == Version) && (_header.RecordSize == sizeof(Record)) && (_header.Capacity != 0)
+                && (::pread(_fd, _names, sizeof(_names), NamesOffset) == sizeof(_names))) {
+
+                _longest = 0;
+                for (uint16_t index = 0; index < MaxNames; index++) {
+                    _names[index][NameSize - 1] = '\0';
+                    _longest = std::max(_longest, static_cast<uint8_t>(::strlen(_names[index])));
+                }
+
+                result = Core::ERROR_NONE;
+            } else {
+                Close();
+            }
+        }
+
+        return (result);
+    }
+
+    void HistoryLog::Reader::Close()
+    {
+        if (_fd != -1) {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    uint32_t HistoryLog::Reader::Timestamp(const uint32_t sequence) const
+    {
+        Record record;
+
+        record.Timestamp = 0;
+        ::pread(_fd, &record, sizeof(record), RecordsOffset + (static_cast<off_t>(sequence % _header.Capacity) * sizeof(Record)));
+
+        return (record.Timestamp);
+    }
+
+    void HistoryLog::Reader::Range(const uint32_t from, const uint32_t to, uint32_t& first, uint32_t& last) const
+    {
+        const uint32_t oldest = _header.Next - _header.Count;
+        uint32_t low = 0;
+        uint32_t high = _header.Count;
+
+        // First record at or after from.
+        while (low < high) {
+            const uint32_t middle = low + ((high - low) / 2);
+
+            if (Timestamp(oldest + middle) < from) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        first = oldest + low;
+
+        // First record after to.
+        high = _header.Count;
+        while (low < high) {
+            const uint32_t middle = low + ((high - low) / 2);
+
+            if (Timestamp(oldest + middle) <= to) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        last = oldest + low;
+    }
+
+    void HistoryLog::Reader::Read(const uint32_t sequence, const uint16_t count, Record records[]) const
+    {
+        const uint32_t slot = (sequence % _header.Capacity);
+        const uint32_t before = std::min(static_cast<uint32_t>(count), _header.Capacity - slot);
+
+        // At most two reads, the range may wrap around the end of the ring.
+        ssize_t loaded = ::pread(_fd, records, before * sizeof(Record), RecordsOffset + (static_cast<off_t>(slot) * sizeof(Record)));
+        if ((loaded == static_cast<ssize_t>(before * sizeof(Record))) && (before < count)) {
+            loaded += ::pread(_fd, &records[before], (count - before) * sizeof(Record), RecordsOffset);
+        }
+
+        for (uint16_t index = 0; index < count; index++) {
+            if (((index * sizeof(Record)) >= static_cast<size_t>(std::max(loaded, static_cast<ssize_t>(0)))) || (records[index].Sequence != (sequence + index)) || (records[index].Name >= MaxNames)) {
+                records[index].Name = InvalidName;
+            }
+        }
+    }
+
+    HistoryLog::Csv::Csv(const string& path, const uint32_t from, const uint32_t to)
+        : _reader()
+        , _first(0)
+        , _last(0)
+        , _sequence(0)
+        , _rowLength(0)
+        , _length(sizeof(CsvHeader) - sizeof(TCHAR))
+        , _pending()
+        , _offset(0)
+        , _headerSent(false)
+    {
+        if (_reader.Open(path) == Core::ERROR_NONE) {
+            _reader.Range(from, to, _first, _last);
+            _rowLength = RowLength(_reader.LongestName());
+            _length += static_cast<uint64_t>(_last - _first) * _rowLength;
+        }
+
+        _sequence = _first;
+    }
+
+    HistoryLog::Csv::~Csv()
+    {
+    }
+
+    uint32_t HistoryLog::Csv::Read(uint8_t stream[], const uint32_t maxLength)
+    {
+        uint32_t result = 0;
+
+        while (result < maxLength) {
+            if (_offset == _pending.length()) {
+                _pending.clear();
+                _offset = 0;
+
+                if (_headerSent == false) {
+                    _pending = CsvHeader;
+                    _headerSent = true;
+                } else if (_sequence != _last) {
+                    Refill();
+                } else {
+                    break;
+                }
+            }
+
+            const uint32_t size = std::min(maxLength - result, static_cast<uint32_t>(_pending.length() - _offset));
+
+            ::memcpy(&stream[result], &(_pending.c_str()[_offset]), size);
+            _offset += size;
+            result += size;
+        }
+
+        return (result);
+    }
+
+    void HistoryLog::Csv::Refill()
+    {
+        Record records[RecordsPerChunk];
+        const uint16_t count = static_cast<uint16_t>(std::min(static_cast<uint32_t>(RecordsPerChunk), _last - _sequence));
+
+        _reader.Read(_sequence, count, records);
+
+        for (uint16_t index = 0; index < count; index++) {
+            Format(records[index]);
+        }
+
+        _sequence += count;
+    }
+
+    /* static */ uint16_t HistoryLog::Csv::RowLength(const uint8_t nameWidth)
+    {
+        // Tabs between the columns and the newline.
+        return ((4 * Width64) + (8 * Width32) + Width16 + nameWidth + Columns);
+    }
+
+    void HistoryLog::Csv::Format(const Record& record)
+    {
+        char row[(4 * Width64) + (8 * Width32) + Width16 + NameSize + Columns + 1];
+        const int nameWidth = _reader.LongestName();
+        int length;
+
+        if (record.Name == InvalidName) {
+            // Overwritten while the text was produced, keep the row so the length still holds.
+            length = snprintf(row, sizeof(row), "%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%*s\t%-*s\n",
+                Width32, "-", Width64, "-", Width32, "-", Width32, "-", Width32, "-", Width32, "-", Width64, "-",
+                Width32, "-", Width16, "-", Width64, "-", Width64, "-", Width32, "-", Width32, "-", nameWidth, "-");
+        } else {
+            length = snprintf(row, sizeof(row), "%*u\t%*llu\t%*u\t%*u\t%*u\t%*u\t%*llu\t%*u.%u\t%*u\t%*llu\t%*llu\t%*u\t%*u\t%-*s\n",
+                Width32, record.Timestamp, Width64, static_cast<unsigned long long>(record.SystemJiffies),
+                Width32, record.Vss, Width32, record.Uss, Width32, record.Pss, Width32, record.Swap,
+                Width64, static_cast<unsigned long long>(record.Jiffies),
+                WidthLoad, std::min(record.CpuLoad / 10, static_cast<uint32_t>(99999999)), record.CpuLoad % 10, Width16, record.Threads,
+                Width64, static_cast<unsigned long long>(record.ReadBytes), Width64, static_cast<unsigned long long>(record.WriteBytes),
+                Width32, record.VoluntarySwitches, Width32, record.InvoluntarySwitches, nameWidth, _reader.Name(record.Name));
+        }
+
+        ASSERT(length == _rowLength);
+
+        _pending.append(row, _rowLength);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
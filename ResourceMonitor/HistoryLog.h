@@ -0,0 +1,173 @@
+#pragma once
+
+#include "Module.h"
+
+#include <map>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // The on disk history of the resource monitor. The file has three parts, all of a fixed size:
+    //  - a header with the sequence number of the next record and the number of records kept,
+    //  - a table of interned process names, records refer to a name by its index,
+    //  - a ring of fixed size records.
+    // Records are written in time order, so the ring itself is the time index: the records of a time range are
+    // found with a binary search, without reading anything in between. Once the ring is full the oldest record
+    // is overwritten, which caps the size of the file.
+    class HistoryLog {
+    public:
+        static constexpr uint32_t Magic = 0x474C4D52; // "RMLG"
+        static constexpr uint16_t Version = 2;
+        static constexpr uint16_t MaxNames = 256;
+        static constexpr uint8_t NameSize = 64;
+        static constexpr uint16_t InvalidName = static_cast<uint16_t>(~0);
+
+        struct Header {
+            uint32_t Magic;
+            uint16_t Version;
+            uint16_t RecordSize;
+            uint32_t Capacity; // Records in the ring
+            uint32_t Next; // Sequence number of the next record
+            uint32_t Count; // Records kept, the oldest has sequence number Next - Count
+            uint32_t Reserved[11];
+        };
+
+        // Memory in pages, jiffies as reported by the kernel. I/O and context switches are counted over the
+        // interval that ends with the record.
+        struct Record {
+            uint32_t Sequence;
+            uint32_t Timestamp; // Seconds since the epoch
+            uint16_t Name;
+            uint16_t Threads;
+            uint32_t Vss;
+            uint32_t Uss;
+            uint32_t Pss;
+            uint32_t Swap;
+            uint32_t CpuLoad; // Per mille of one CPU
+            uint64_t Jiffies; // Of the process tree
+            uint64_t SystemJiffies;
+            uint64_t ReadBytes;
+            uint64_t WriteBytes;
+            uint32_t VoluntarySwitches;
+            uint32_t InvoluntarySwitches;
+        };
+
+        static constexpr uint32_t NamesOffset = sizeof(Header);
+        static constexpr uint32_t RecordsOffset = NamesOffset + (MaxNames * NameSize);
+
+        class Writer {
+        private:
+            Writer(const Writer&) = delete;
+            Writer& operator=(const Writer&) = delete;
+
+        public:
+            Writer();
+            ~Writer();
+
+        public:
+            // Continues an existing log with the same layout, starts a new one otherwise. The size is in KB.
+            uint32_t Open(const string& path, const uint32_t size);
+            void Close();
+            // Fills in the sequence number and name index. Returns false if the record could not be stored.
+            bool Append(const string& name, Record& record);
+
+        private:
+            uint16_t Intern(const string& name);
+
+        private:
+            int _fd;
+            Header _header;
+            std::map<string, uint16_t> _names;
+            string _slots[MaxNames]; // Name per slot, empty if the slot is free.
+            uint32_t _lastUsed[MaxNames]; // Sequence number of the last record per slot, for recycling.
+        };
+
+        class Reader {
+        private:
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+        public:
+            Reader();
+            ~Reader();
+
+        public:
+            // Takes a snapshot of the header and name table, only records that exist at this point are read.
+            uint32_t Open(const string& path);
+            void Close();
+            bool IsOpen() const
+            {
+                return (_fd != -1);
+            }
+            // First and one past the last sequence number of the records within [from, to], in seconds.
+            void Range(const uint32_t from, const uint32_t to, uint32_t& first, uint32_t& last) const;
+            // Reads count records starting at the given sequence number. Records that were overwritten since
+            // the snapshot are returned with Name set to InvalidName.
+            void Read(const uint32_t sequence, const uint16_t count, Record records[]) const;
+            const char* Name(const uint16_t index) const
+            {
+                return ((index < MaxNames) ? _names[index] : "");
+            }
+            uint8_t LongestName() const
+            {
+                return (_longest);
+            }
+
+        private:
+            uint32_t Timestamp(const uint32_t sequence) const;
+
+        private:
+            int _fd;
+            Header _header;
+            char _names[MaxNames][NameSize];
+            uint8_t _longest;
+        };
+
+        // The records of a time range as tab separated text. Every row has the same length, so the length of
+        // the whole text is known before the first record is read, and it can be produced a chunk at a time.
+        class Csv {
+        private:
+            Csv(const Csv&) = delete;
+            Csv& operator=(const Csv&) = delete;
+
+            static constexpr uint16_t RecordsPerChunk = 64;
+
+        public:
+            Csv(const string& path, const uint32_t from, const uint32_t to);
+            ~Csv();
+
+        public:
+            uint64_t Length() const
+            {
+                return (_length);
+            }
+            // Start over from the first row.
+            void Reset()
+            {
+                _sequence = _first;
+                _pending.clear();
+                _offset = 0;
+                _headerSent = false;
+            }
+            uint32_t Read(uint8_t stream[], const uint32_t maxLength);
+
+        private:
+            void Refill();
+            void Format(const Record& record);
+            static uint16_t RowLength(const uint8_t nameWidth);
+
+        private:
+            Reader _reader;
+            uint32_t _first;
+            uint32_t _last;
+            uint32_t _sequence;
+            uint16_t _rowLength;
+            uint64_t _length;
+            string _pending;
+            uint32_t _offset;
+            bool _headerSent;
+        };
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -19,6 +19,7 @@ namespace Plugin {
         Config config;
         config.FromString(_service->ConfigLine());
         _skipURL = static_cast<uint32_t>(_service->WebPrefix().length());
+        _binPath = config.Path.Value();
 
         _monitor = _service->Root<Exchange::IResourceMonitor>(_connectionId, 2000, _T("ResourceMonitorImplementation"));
 
@@ -56,7 +57,5 @@ namespace Plugin {
     {
         return "";
     }
-
-    /* static */ Core::ProxyPoolType<Web::TextBody> ResourceMonitor::webBodyFactory(4);
 }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Module.h"
+#include "HistoryLog.h"
 #include <interfaces/IMemory.h>
 #include <interfaces/IResourceMonitor.h>
 
@@ -20,8 +21,10 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , OutOfProcess(true)
+                , Path(_T("/tmp/resource-log.bin"))
             {
                 Add(_T("outofprocess"), &OutOfProcess);
+                Add(_T("path"), &Path);
             }
             ~Config()
             {
@@ -29,6 +32,51 @@ namespace Plugin {
 
         public:
             Core::JSON::Boolean OutOfProcess;
+            Core::JSON::String Path;
+        };
+
+        // Produces the text while it is sent, a chunk at a time, straight from the log file.
+        class HistoryBody : public Web::IBody {
+        private:
+            HistoryBody() = delete;
+            HistoryBody(const HistoryBody&) = delete;
+            HistoryBody& operator=(const HistoryBody&) = delete;
+
+        public:
+            HistoryBody(const string& path, const uint32_t from, const uint32_t to)
+                : _csv(path, from, to)
+            {
+            }
+            ~HistoryBody() override
+            {
+            }
+
+        private:
+            uint32_t Serialize() const override
+            {
+                _csv.Reset();
+                return (static_cast<uint32_t>(_csv.Length()));
+            }
+            uint32_t Deserialize() override
+            {
+                ASSERT(false);
+                return (0);
+            }
+            void End() const override
+            {
+            }
+            uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+            {
+                return (static_cast<uint16_t>(_csv.Read(stream, maxLength)));
+            }
+            uint16_t Deserialize(const uint8_t[], const uint16_t) override
+            {
+                ASSERT(false);
+                return (0);
+            }
+
+        private:
+            mutable HistoryLog::Csv _csv;
         };
 
     public:
@@ -36,6 +84,7 @@ namespace Plugin {
             : _service(nullptr)
             , _monitor(nullptr)
             , _connectionId(0)
+            , _binPath()
         {
 
         }
@@ -63,13 +112,21 @@ namespace Plugin {
                 if (index.IsValid() == true && index.Next() == true) {
                     const string requestStr = index.Current().Text();
                     if (requestStr == "history") {
-                        // Asked for history csv
+                        // Asked for history csv, optionally limited to ?From=<seconds>&To=<seconds> since the epoch
+                        uint32_t from = 0;
+                        uint32_t to = static_cast<uint32_t>(~0);
+
+                        if (request.Query.IsSet() == true) {
+                            Core::URL::KeyValue options(request.Query.Value());
+
+                            from = options.Number<uint32_t>(_T("From"), from);
+                            to = options.Number<uint32_t>(_T("To"), to);
+                        }
+
                         result->ErrorCode = Web::STATUS_OK;
                         result->ContentType = Web::MIMETypes::MIME_TEXT;
                         result->Message = _T("OK");
-                        Core::ProxyType<Web::TextBody> body(webBodyFactory.Element());
-                        *body = _monitor->CompileMemoryCsv();
-                        result->Body(body);
+                        result->Body<HistoryBody>(Core::ProxyType<HistoryBody>::Create(_binPath, from, to));
                     }
                 }
             }
@@ -93,8 +150,8 @@ namespace Plugin {
         PluginHost::IShell* _service;
         Exchange::IResourceMonitor* _monitor;
         uint32_t _connectionId;
-        static Core::ProxyPoolType<Web::TextBody> webBodyFactory;
         uint32_t _skipURL;
+        string _binPath;
     };
 }
 }
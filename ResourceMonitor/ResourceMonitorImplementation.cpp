@@ -1,14 +1,18 @@
 #include "Module.h"
+#include "HistoryLog.h"
 #include <core/ProcessInfo.h>
 #include <interfaces/IMemory.h>
 #include <interfaces/IResourceMonitor.h>
-#include <sstream>
+#include <deque>
+#include <map>
+#include <time.h>
+#include <unistd.h>
+#include <unordered_set>
 #include <vector>
 
 using std::endl;
 using std::cerr; // TODO: temp
 using std::list;
-using std::stringstream;
 using std::vector;
 
 // TODO: don't create our own thread, use threadpool from WPEFramework
@@ -27,33 +31,70 @@ namespace Plugin {
             Invalid
          };
 
+         enum class MeasureMode {
+            Pagemap, // Walk the page map of every process, exact USS
+            Rollup   // Let the kernel sum up per process, adds PSS and swap
+         };
+
      private:
          Config& operator=(const Config&) = delete;
          
      public:
          Config()
              : Core::JSON::Container()
-             , Path()
+             , Path(_T("/tmp/resource-log.bin"))
+             , Size(1024)
              , Interval()
              , Mode()
              , ParentName()
+             , Measure(_T("pagemap"))
+             , Budget(0)
+             , MaxInterval(0)
+             , CpuThreshold(0)
+             , CpuSamples(3)
+             , GrowthThreshold(0)
+             , GrowthSamples(12)
          {
             Add(_T("path"), &Path);
+            Add(_T("size"), &Size);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("measure"), &Measure);
+            Add(_T("budget"), &Budget);
+            Add(_T("max-interval"), &MaxInterval);
+            Add(_T("cpu-threshold"), &CpuThreshold);
+            Add(_T("cpu-samples"), &CpuSamples);
+            Add(_T("growth-threshold"), &GrowthThreshold);
+            Add(_T("growth-samples"), &GrowthSamples);
          }
          Config(const Config& copy)
              : Core::JSON::Container()
              , Path(copy.Path)
+             , Size(copy.Size)
              , Interval(copy.Interval)
              , Mode(copy.Mode)
              , ParentName(copy.ParentName)
+             , Measure(copy.Measure)
+             , Budget(copy.Budget)
+             , MaxInterval(copy.MaxInterval)
+             , CpuThreshold(copy.CpuThreshold)
+             , CpuSamples(copy.CpuSamples)
+             , GrowthThreshold(copy.GrowthThreshold)
+             , GrowthSamples(copy.GrowthSamples)
          {
             Add(_T("path"), &Path);
+            Add(_T("size"), &Size);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("measure"), &Measure);
+            Add(_T("budget"), &Budget);
+            Add(_T("max-interval"), &MaxInterval);
+            Add(_T("cpu-threshold"), &CpuThreshold);
+            Add(_T("cpu-samples"), &CpuSamples);
+            Add(_T("growth-threshold"), &GrowthThreshold);
+            Add(_T("growth-samples"), &GrowthSamples);
          }
          ~Config()
          {
@@ -76,25 +117,104 @@ namespace Plugin {
              return CollectMode::Invalid;
          }
 
+         MeasureMode GetMeasureMode() const
+         {
+             return (Measure == "rollup" ? MeasureMode::Rollup : MeasureMode::Pagemap);
+         }
+
      public:
          Core::JSON::String Path;
+         Core::JSON::DecUInt32 Size; // KB, the oldest samples are overwritten beyond this.
          Core::JSON::DecUInt32 Interval;
          Core::JSON::String Mode;
          Core::JSON::String ParentName;
+         Core::JSON::String Measure;
+         Core::JSON::DecUInt8 Budget; // Percentage of one CPU a collection may take, 0 disables adapting the interval.
+         Core::JSON::DecUInt32 MaxInterval; // Seconds, the interval is never stretched beyond this.
+         Core::JSON::DecUInt16 CpuThreshold; // Percentage of one CPU, 0 disables the CpuSpike event.
+         Core::JSON::DecUInt8 CpuSamples; // Consecutive samples above the threshold before it is reported.
+         Core::JSON::DecUInt32 GrowthThreshold; // KB of USS per minute, 0 disables the MemoryGrowth event.
+         Core::JSON::DecUInt8 GrowthSamples; // Samples the growth is measured over.
       };
 
       class StatCollecter {
+     private:
+         // One tree of processes that gets its own columns in the log.
+         struct Tracked {
+            string Name;
+            Core::ProcessInfo Info; // Root of the tree, its jiffies are logged.
+            list<::ThreadId> Ids;   // Every process in the tree.
+         };
+
+         // Memory of a tracked tree, in pages. PSS and swap are only known when measured through the rollup.
+         struct Usage {
+            uint32_t Vss;
+            uint32_t Uss;
+            uint32_t Pss;
+            uint32_t Swap;
+         };
+
+         // Running totals of one process, as the kernel reports them.
+         struct Counters {
+            uint64_t Jiffies;
+            uint64_t ReadBytes;
+            uint64_t WriteBytes;
+            uint64_t VoluntarySwitches;
+            uint64_t InvoluntarySwitches;
+            uint16_t Threads;
+         };
+
+         // What happened in a tracked tree since the previous sample.
+         struct Activity {
+            uint32_t CpuLoad; // Per mille of one CPU
+            uint16_t Threads;
+            uint64_t ReadBytes;
+            uint64_t WriteBytes;
+            uint32_t VoluntarySwitches;
+            uint32_t InvoluntarySwitches;
+         };
+
+         // Per tracked tree, to tell a spike or a trend from a single odd sample.
+         struct Alarm {
+            uint8_t CpuStreak;
+            bool CpuActive;
+            bool GrowthActive;
+            std::deque<std::pair<uint32_t, uint32_t>> Uss; // Timestamp and USS of the last samples
+         };
+
      public:
-         explicit StatCollecter(const Config& config)
-             : _binFile(nullptr)
-             , _otherMap(nullptr)
-             , _ourMap(nullptr)
+         StatCollecter(const Config& config, PluginHost::IShell* service)
+             : _service(service)
+             , _log()
+             , _otherMap()
+             , _sharedMap()
+             , _seenMap()
+             , _treeMaps()
              , _bufferEntries(0)
+             , _pageSize(static_cast<uint32_t>(::sysconf(_SC_PAGESIZE)))
              , _interval(0)
+             , _maxInterval(0)
+             , _currentInterval(0)
+             , _budget(0)
              , _collectMode(Config::CollectMode::Invalid)
+             , _measureMode(Config::MeasureMode::Pagemap)
+             , _ticksPerSecond(static_cast<uint32_t>(::sysconf(_SC_CLK_TCK)))
+             , _lastSample(0)
+             , _counters()
+             , _alarms()
+             , _cpuThreshold(config.CpuThreshold.Value())
+             , _cpuSamples(std::max(config.CpuSamples.Value(), static_cast<uint8_t>(1)))
+             , _growthThreshold(config.GrowthThreshold.Value())
+             , _growthSamples(std::max(config.GrowthSamples.Value(), static_cast<uint8_t>(2)))
              , _activity(*this)
          {
-            _binFile = fopen(config.Path.Value().c_str(), "w");
+            if (_service != nullptr) {
+               _service->AddRef();
+            }
+
+            if (_log.Open(config.Path.Value(), config.Size.Value()) != Core::ERROR_NONE) {
+               TRACE_L1("Could not open %s, nothing will be logged", config.Path.Value().c_str());
+            }
 
             uint32_t pageCount = Core::SystemInfo::Instance().GetPhysicalPageCount();
             const uint32_t bitPersUint32 = 32;
@@ -107,262 +227,535 @@ namespace Plugin {
             //    allocate a little extra to make sure we don't miss the highest ones.
             _bufferEntries += _bufferEntries / 10;
 
-            _ourMap = new uint32_t[_bufferEntries];
-            _otherMap = new uint32_t[_bufferEntries];
-            _interval = config.Interval.Value();
+            _interval = std::max(config.Interval.Value(), static_cast<uint32_t>(1));
+            _maxInterval = (config.MaxInterval.IsSet() == true ? std::max(config.MaxInterval.Value(), _interval) : (_interval * 12));
+            _currentInterval = _interval;
+            _budget = config.Budget.Value();
             _collectMode = config.GetCollectMode();
+            _measureMode = config.GetMeasureMode();
             _parentName = config.ParentName.Value();
 
+            if (_measureMode == Config::MeasureMode::Pagemap) {
+               _otherMap.resize(_bufferEntries);
+               _sharedMap.resize(_bufferEntries);
+               _seenMap.resize(_bufferEntries);
+            }
+
             _activity.Submit();
          }
 
          ~StatCollecter()
          {
-            fclose(_binFile);
+            _activity.Revoke();
 
-            delete [] _ourMap;
-            delete [] _otherMap;
-         }
+            _log.Close();
 
-         void GetProcessNames(vector<string>& processNames)
-         {
-            _namesLock.Lock();
-            processNames = _processNames;
-            _namesLock.Unlock();
+            if (_service != nullptr) {
+               _service->Release();
+            }
          }
 
       private:
-         // TODO: combine these "Collect*" methods
-         void CollectSingle()
+         // Find the trees to log, per collect mode.
+         void SelectSingle(vector<Tracked>& tracked)
          {
             list<Core::ProcessInfo> processes;
             Core::ProcessInfo::FindByName(_parentName, false, processes);
 
-            // TODO: check if only one, warning otherwise?
-            // TOOD: what if none found? will cause segfault when using .front() later on.
             if (processes.empty()) {
-               TRACE_L1("Failed to find process %s", _parentName);
+               TRACE_L1("Failed to find process %s", _parentName.c_str());
                return;
             }
 
             if (processes.size() > 1) {
-               TRACE_L1("Found more than one process named %s, only tracking first", _parentName);
+               TRACE_L1("Found more than one process named %s, only logging jiffies of the first", _parentName.c_str());
             }
 
-            uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-            memset(_ourMap, 0, mapBufferSize);
-            memset(_otherMap, 0, mapBufferSize);
+            // All matches are accounted as one tree.
+            tracked.push_back(Tracked { _parentName, processes.front(), list<::ThreadId>() });
+
+            for (const Core::ProcessInfo& processInfo : processes) {
+               Core::ProcessTree processTree(processInfo.Id());
+               list<::ThreadId> addedProcessIds;
+               processTree.GetProcessIds(addedProcessIds);
+               tracked.back().Ids.splice(tracked.back().Ids.end(), addedProcessIds);
+            }
+         }
 
-            vector<::ThreadId> processIds;
+         void SelectMultiple(vector<Tracked>& tracked)
+         {
+            list<Core::ProcessInfo> processes;
+            Core::ProcessInfo::FindByName(_parentName, false, processes);
 
             for (const Core::ProcessInfo& processInfo : processes) {
-               string processName = processInfo.Name();
+               string processName = processInfo.Name() + " (" + std::to_string(processInfo.Id()) + ")";
 
-               _namesLock.Lock();
-               if (find(_processNames.begin(), _processNames.end(), _parentName) == _processNames.end()) {
-                  _processNames.push_back(_parentName);
-               }
-               _namesLock.Unlock();
+               tracked.push_back(Tracked { processName, processInfo, list<::ThreadId>() });
+               Core::ProcessTree(processInfo.Id()).GetProcessIds(tracked.back().Ids);
+            }
+         }
 
-               Core::ProcessTree processTree(processInfo.Id());
+         void SelectWPEProcess(const string& argument, vector<Tracked>& tracked)
+         {
+            const string processName = "WPEProcess-1.0.0";
 
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
+            list<Core::ProcessInfo> processes;
+            Core::ProcessInfo::FindByName(processName, false, processes);
 
-               std::list<::ThreadId> addedProcessIds;
-               processTree.GetProcessIds(addedProcessIds);
-               processIds.insert(processIds.end(), addedProcessIds.begin(), addedProcessIds.end());
+            for (const Core::ProcessInfo& processInfo : processes) {
+               std::list<string> commandLine = processInfo.CommandLine();
+
+               // Get callsign/classname
+               std::list<string>::const_iterator i = std::find(commandLine.cbegin(), commandLine.cend(), argument);
+               if ((i != commandLine.cend()) && (++i != commandLine.cend()) && (*i == _parentName)) {
+                  string columnName = _parentName + " (" + std::to_string(processInfo.Id()) + ")";
+
+                  tracked.push_back(Tracked { columnName, processInfo, list<::ThreadId>() });
+                  Core::ProcessTree(processInfo.Id()).GetProcessIds(tracked.back().Ids);
+               }
+            }
+         }
+
+         // Walks the page map of every process on the system once per interval, no matter how many trees are
+         // tracked. Each tree gets its own map; the pages of all other processes go into one shared map, and
+         // pages that show up in more than one tracked tree are collected on the side. A page is unique to a tree
+         // if it is in neither of the latter two.
+         void MeasurePagemap(const vector<Tracked>& tracked, vector<Usage>& usage)
+         {
+            const uint32_t mapBufferSize = sizeof(uint32_t) * _bufferEntries;
+
+            if (_treeMaps.size() < tracked.size()) {
+               _treeMaps.resize(tracked.size(), vector<uint32_t>(_bufferEntries));
             }
 
-            memset(_otherMap, 0, mapBufferSize);
+            memset(_otherMap.data(), 0, mapBufferSize);
+            memset(_sharedMap.data(), 0, mapBufferSize);
+            memset(_seenMap.data(), 0, mapBufferSize);
+
+            std::unordered_set<::ThreadId> trackedIds;
+
+            for (uint32_t index = 0; index < tracked.size(); index++) {
+               uint32_t* treeMap = _treeMaps[index].data();
+
+               memset(treeMap, 0, mapBufferSize);
+
+               for (const ::ThreadId id : tracked[index].Ids) {
+                  Core::ProcessInfo(id).MarkOccupiedPages(treeMap, mapBufferSize);
+                  trackedIds.insert(id);
+               }
+
+               for (uint32_t entry = 0; entry < _bufferEntries; entry++) {
+                  _sharedMap[entry] |= (_seenMap[entry] & treeMap[entry]);
+                  _seenMap[entry] |= treeMap[entry];
+               }
+            }
 
-            // Find other processes
-            list<Core::ProcessInfo> otherProcesses;
             Core::ProcessInfo::Iterator otherIterator;
             while (otherIterator.Next()) {
-               ::ThreadId otherId = otherIterator.Current().Id();
-               if (find(processIds.begin(), processIds.end(), otherId) == processIds.end()) {
-                  otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
+               if (trackedIds.find(otherIterator.Current().Id()) == trackedIds.end()) {
+                  otherIterator.Current().MarkOccupiedPages(_otherMap.data(), mapBufferSize);
                }
             }
 
-            StartLogLine(1);
-            LogProcess(_parentName, processes.front());
+            for (uint32_t index = 0; index < tracked.size(); index++) {
+               const uint32_t* treeMap = _treeMaps[index].data();
+               uint32_t vss = 0;
+               uint32_t uss = 0;
+
+               for (uint32_t entry = 0; entry < _bufferEntries; entry++) {
+                  vss += __builtin_popcount(treeMap[entry]);
+                  uss += __builtin_popcount(treeMap[entry] & ~(_otherMap[entry] | _sharedMap[entry]));
+               }
+
+               usage.push_back(Usage { vss, uss, 0, 0 });
+            }
          }
 
-         void CollectMultiple()
+         // The kernel already did the accounting, only a few lines per process are read. The "VSS" column holds
+         // the resident set here, just as the page map walk reports it.
+         void MeasureRollup(const vector<Tracked>& tracked, vector<Usage>& usage)
          {
-            list<Core::ProcessInfo> processes;
-            Core::ProcessInfo::FindByName(_parentName, false, processes);
+            for (const Tracked& tree : tracked) {
+               uint64_t rss = 0, uss = 0, pss = 0, swap = 0;
 
-            StartLogLine(processes.size());
+               for (const ::ThreadId id : tree.Ids) {
+                  ReadRollup(id, rss, uss, pss, swap);
+               }
 
-            for (const Core::ProcessInfo& processInfo : processes) {
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
+               usage.push_back(Usage { ToPages(rss), ToPages(uss), ToPages(pss), ToPages(swap) });
+            }
+         }
 
-               string processName = processInfo.Name() + " (" + std::to_string(processInfo.Id()) + ")";
+         // Sizes in kB. Falls back to the full smaps on kernels without smaps_rollup, the same fields summed
+         // over all mappings give the same totals.
+         static void ReadRollup(const ::ThreadId id, uint64_t& rss, uint64_t& uss, uint64_t& pss, uint64_t& swap)
+         {
+            const string base = "/proc/" + std::to_string(id) + "/smaps";
+            FILE* file = fopen((base + "_rollup").c_str(), "r");
 
-               _namesLock.Lock();
-               if (find(_processNames.begin(), _processNames.end(), processName) == _processNames.end()) {
-                  _processNames.push_back(processName);
+            if (file == nullptr) {
+               file = fopen(base.c_str(), "r");
+            }
+
+            if (file != nullptr) {
+               char line[256];
+
+               while (fgets(line, sizeof(line), file) != nullptr) {
+                  char key[64];
+                  unsigned long long value;
+
+                  if (sscanf(line, "%63[^:]: %llu kB", key, &value) == 2) {
+                     if (strcmp(key, "Rss") == 0) {
+                        rss += value;
+                     } else if (strcmp(key, "Pss") == 0) {
+                        pss += value;
+                     } else if ((strcmp(key, "Private_Clean") == 0) || (strcmp(key, "Private_Dirty") == 0)) {
+                        uss += value;
+                     } else if (strcmp(key, "Swap") == 0) {
+                        swap += value;
+                     }
+                  }
                }
-               _namesLock.Unlock();
 
-               Core::ProcessTree processTree(processInfo.Id());
+               fclose(file);
+            }
+         }
 
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
+         // CPU time and thread count from stat, I/O from io, context switches from the status of every thread;
+         // the process level status only counts those of the main thread. Whatever cannot be read stays 0.
+         static void ReadCounters(const ::ThreadId id, Counters& counters)
+         {
+            const string base = "/proc/" + std::to_string(id);
+            char line[512];
+            FILE* file = fopen((base + "/stat").c_str(), "r");
+
+            memset(&counters, 0, sizeof(counters));
+
+            if (file != nullptr) {
+               if (fgets(line, sizeof(line), file) != nullptr) {
+                  // The command name can hold spaces and parentheses, the fields start after the last one.
+                  const char* fields = strrchr(line, ')');
+                  unsigned long long utime, stime;
+                  long threads;
+
+                  if ((fields != nullptr) && (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %ld", &utime, &stime, &threads) == 3)) {
+                     counters.Jiffies = utime + stime;
+                     counters.Threads = static_cast<uint16_t>(std::min(threads, 0xFFFFL));
+                  }
+               }
+               fclose(file);
+            }
 
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!processTree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
+            file = fopen((base + "/io").c_str(), "r");
+            if (file != nullptr) {
+               while (fgets(line, sizeof(line), file) != nullptr) {
+                  unsigned long long value;
+
+                  if (sscanf(line, "read_bytes: %llu", &value) == 1) {
+                     counters.ReadBytes = value;
+                  } else if (sscanf(line, "write_bytes: %llu", &value) == 1) {
+                     counters.WriteBytes = value;
                   }
                }
+               fclose(file);
+            }
+
+            Core::Directory tasks((base + "/task").c_str());
+            while (tasks.Next() == true) {
+               const string task(Core::File::FileName(tasks.Current()));
+
+               if ((task != _T(".")) && (task != _T(".."))) {
+                  file = fopen((tasks.Current() + "/status").c_str(), "r");
+
+                  if (file != nullptr) {
+                     while (fgets(line, sizeof(line), file) != nullptr) {
+                        unsigned long long value;
 
-               LogProcess(processName, processInfo);
+                        if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1) {
+                           counters.VoluntarySwitches += value;
+                        } else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1) {
+                           counters.InvoluntarySwitches += value;
+                        }
+                     }
+                     fclose(file);
+                  }
+               }
             }
          }
 
-         void CollectWPEProcess(const string& argument)
+         // Differences with the previous sample, summed over the tree. A process seen for the first time only
+         // sets its baseline, so a tree that gains a process does not show its whole history as one spike.
+         void MeasureActivity(const vector<Tracked>& tracked, const uint64_t elapsed, vector<Activity>& activity)
          {
-            const string processName = "WPEProcess-1.0.0";
+            std::map<::ThreadId, Counters> current;
 
-            list<Core::ProcessInfo> processes;
-            Core::ProcessInfo::FindByName(processName, false, processes);
+            for (const Tracked& tree : tracked) {
+               uint64_t jiffies = 0;
+               uint64_t switches[2] = { 0, 0 };
+               Activity result;
 
-            vector<std::pair<Core::ProcessInfo, string> > processIds;
-            for (const Core::ProcessInfo& processInfo : processes) {
-               std::list<string> commandLine = processInfo.CommandLine();
+               memset(&result, 0, sizeof(result));
 
-               bool shouldTrack = false;
-               string columnName;
+               for (const ::ThreadId id : tree.Ids) {
+                  Counters& counters(current[id]);
 
-               // Get callsign/classname
-               std::list<string>::const_iterator i = std::find(commandLine.cbegin(), commandLine.cend(), argument);
-               if (i != commandLine.cend()) {
-                  i++;
-                  if (i != commandLine.cend()) {
-                     if (*i == _parentName) {
-                        columnName = _parentName + " (" + std::to_string(processInfo.Id()) + ")";
-                        processIds.push_back(std::pair<::ThreadId, string>(processInfo.Id(), columnName));
-                        shouldTrack = true;
-                     }
+                  ReadCounters(id, counters);
+
+                  result.Threads = static_cast<uint16_t>(std::min(static_cast<uint32_t>(result.Threads) + counters.Threads, static_cast<uint32_t>(0xFFFF)));
+
+                  std::map<::ThreadId, Counters>::const_iterator previous(_counters.find(id));
+
+                  if (previous != _counters.end()) {
+                     // Exited threads take their context switches along, never count backwards.
+                     jiffies += Delta(counters.Jiffies, previous->second.Jiffies);
+                     result.ReadBytes += Delta(counters.ReadBytes, previous->second.ReadBytes);
+                     result.WriteBytes += Delta(counters.WriteBytes, previous->second.WriteBytes);
+                     switches[0] += Delta(counters.VoluntarySwitches, previous->second.VoluntarySwitches);
+                     switches[1] += Delta(counters.InvoluntarySwitches, previous->second.InvoluntarySwitches);
                   }
                }
 
-               if (!shouldTrack) {
-                  continue;
+               if ((elapsed != 0) && (_ticksPerSecond != 0)) {
+                  result.CpuLoad = static_cast<uint32_t>(std::min((jiffies * 1000 * 1000000) / (elapsed * _ticksPerSecond), static_cast<uint64_t>(~static_cast<uint32_t>(0))));
                }
+               result.VoluntarySwitches = static_cast<uint32_t>(std::min(switches[0], static_cast<uint64_t>(~static_cast<uint32_t>(0))));
+               result.InvoluntarySwitches = static_cast<uint32_t>(std::min(switches[1], static_cast<uint64_t>(~static_cast<uint32_t>(0))));
 
-               _namesLock.Lock();
-               if (std::find(_processNames.cbegin(), _processNames.cend(), columnName) == _processNames.cend()) {
-                  _processNames.push_back(columnName);
-               }
-               _namesLock.Unlock();
+               activity.push_back(result);
             }
 
-            StartLogLine(processIds.size());
-            for (std::pair<Core::ProcessInfo, string> processDesc : processIds) {
-               Core::ProcessTree tree(processDesc.first);
+            // Processes that are gone are forgotten.
+            _counters.swap(current);
+         }
 
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
+         static uint64_t Delta(const uint64_t now, const uint64_t before)
+         {
+            return (now > before ? now - before : 0);
+         }
 
-               tree.MarkOccupiedPages(_ourMap, mapBufferSize);
+         // Raise an event when a tree crosses a threshold, and again when it drops back below it.
+         void CheckThresholds(const uint32_t timestamp, const vector<Tracked>& tracked, const vector<Usage>& usage, const vector<Activity>& activity)
+         {
+            std::map<string, Alarm> current;
+
+            for (uint32_t index = 0; index < tracked.size(); index++) {
+               std::map<string, Alarm>::iterator previous(_alarms.find(tracked[index].Name));
+               Alarm& alarm(current[tracked[index].Name]);
+
+               if (previous != _alarms.end()) {
+                  alarm = std::move(previous->second);
+               } else {
+                  alarm.CpuStreak = 0;
+                  alarm.CpuActive = false;
+                  alarm.GrowthActive = false;
+               }
+
+               if (_cpuThreshold != 0) {
+                  const uint32_t load = activity[index].CpuLoad;
 
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!tree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
+                  alarm.CpuStreak = static_cast<uint8_t>(load >= (static_cast<uint32_t>(_cpuThreshold) * 10) ? std::min(alarm.CpuStreak + 1, 255) : 0);
+
+                  if ((alarm.CpuActive == false) && (alarm.CpuStreak >= _cpuSamples)) {
+                     alarm.CpuActive = true;
+                     Notify(_T("CpuSpike"), tracked[index].Name, load / 10, true);
+                  } else if ((alarm.CpuActive == true) && (alarm.CpuStreak == 0)) {
+                     alarm.CpuActive = false;
+                     Notify(_T("CpuSpike"), tracked[index].Name, load / 10, false);
                   }
                }
 
-               LogProcess(processDesc.second, processDesc.first);
+               if (_growthThreshold != 0) {
+                  alarm.Uss.emplace_back(timestamp, usage[index].Uss);
+                  if (alarm.Uss.size() > _growthSamples) {
+                     alarm.Uss.pop_front();
+                  }
+
+                  if (alarm.Uss.size() == _growthSamples) {
+                     const int64_t growth = Growth(alarm.Uss);
+
+                     if ((alarm.GrowthActive == false) && (growth >= static_cast<int64_t>(_growthThreshold))) {
+                        alarm.GrowthActive = true;
+                        Notify(_T("MemoryGrowth"), tracked[index].Name, growth, true);
+                     } else if ((alarm.GrowthActive == true) && (growth < static_cast<int64_t>(_growthThreshold / 2))) {
+                        alarm.GrowthActive = false;
+                        Notify(_T("MemoryGrowth"), tracked[index].Name, growth, false);
+                     }
+                  }
+               }
+            }
+
+            // Trees that are gone are forgotten.
+            _alarms.swap(current);
+         }
+
+         // Least squares slope of the USS over the samples, in KB per minute. A fit instead of first versus last
+         // sample, so a single sample taken during a short lived allocation does not decide.
+         int64_t Growth(const std::deque<std::pair<uint32_t, uint32_t>>& samples) const
+         {
+            const double count = static_cast<double>(samples.size());
+            const uint32_t base = samples.front().first;
+            double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+
+            for (const std::pair<uint32_t, uint32_t>& sample : samples) {
+               const double x = static_cast<double>(sample.first - base);
+               const double y = static_cast<double>(sample.second);
+
+               sumX += x;
+               sumY += y;
+               sumXX += x * x;
+               sumXY += x * y;
+            }
+
+            const double denominator = (count * sumXX) - (sumX * sumX);
+            int64_t result = 0;
+
+            if (denominator > 0) {
+               const double pagesPerSecond = ((count * sumXY) - (sumX * sumY)) / denominator;
+               result = static_cast<int64_t>((pagesPerSecond * _pageSize * 60) / 1024);
+            }
+
+            return (result);
+         }
+
+         void Notify(const TCHAR event[], const string& name, const int64_t value, const bool active)
+         {
+            if (_service != nullptr) {
+               string quoted;
+               Core::JSON::String(name).ToString(quoted);
+
+               _service->Notify(_T("{ \"event\": \"") + string(event) + _T("\", \"process\": ") + quoted + _T(", \"value\": ") + std::to_string(value) + _T(", \"active\": ") + (active ? _T("true") : _T("false")) + _T(" }"));
+            }
+
+            TRACE_L1("%s %s for %s (%d)", event, (active ? "raised" : "cleared"), name.c_str(), static_cast<int32_t>(value));
+         }
+
+         uint32_t ToPages(const uint64_t kiloBytes) const
+         {
+            return static_cast<uint32_t>((kiloBytes * 1024) / _pageSize);
+         }
+
+         // Stretch the interval when a collection costs more CPU than the budget allows, and go back to the
+         // configured interval once it is cheap again.
+         void AdaptInterval(const uint64_t cost)
+         {
+            if (_budget != 0) {
+               // The interval, in seconds, at which this cost is exactly the budget.
+               const uint64_t needed = ((cost * 100) + ((static_cast<uint64_t>(_budget) * 1000000) - 1)) / (static_cast<uint64_t>(_budget) * 1000000);
+               const uint32_t next = static_cast<uint32_t>(std::min(std::max(needed, static_cast<uint64_t>(_interval)), static_cast<uint64_t>(_maxInterval)));
+
+               if (next != _currentInterval) {
+                  TRACE_L1("Collection took %u us of CPU, interval changed from %u s to %u s", static_cast<uint32_t>(cost), _currentInterval, next);
+                  _currentInterval = next;
+               }
             }
          }
 
+         static uint64_t ThreadTime()
+         {
+            struct timespec now;
+            ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+            return (static_cast<uint64_t>(now.tv_sec) * 1000000) + (now.tv_nsec / 1000);
+         }
+
      protected:
          void Dispatch()
          {
+            const uint64_t started = ThreadTime();
+            vector<Tracked> tracked;
+
             switch(_collectMode) {
                case Config::CollectMode::Single:
-                  CollectSingle();
+                  SelectSingle(tracked);
                   break;
                case Config::CollectMode::Multiple: 
-                  CollectMultiple();
+                  SelectMultiple(tracked);
                   break;
                case Config::CollectMode::Callsign: 
-                  CollectWPEProcess("-C");
+                  SelectWPEProcess("-C", tracked);
                   break;
                case Config::CollectMode::ClassName:
-                  CollectWPEProcess("-c");
+                  SelectWPEProcess("-c", tracked);
                   break;
                case Config::CollectMode::Invalid:
                   // TODO: ASSERT?
                   break;
             }
 
-            _activity.Schedule(Core::Time::Now().Add(_interval * 1000));
-         }
+            const uint64_t now = Core::Time::Now().Ticks();
+            vector<Activity> activity;
 
-    private:
-         uint32_t CountSetBits(uint32_t pageBuffer[], const uint32_t* inverseMask)
-         {
-            uint32_t count = 0;
+            MeasureActivity(tracked, (_lastSample != 0 ? now - _lastSample : 0), activity);
+            _lastSample = now;
+
+            if (tracked.empty() == false) {
+               vector<Usage> usage;
 
-            if (inverseMask == nullptr) {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index]);
+               if (_measureMode == Config::MeasureMode::Rollup) {
+                  MeasureRollup(tracked, usage);
+               } else {
+                  MeasurePagemap(tracked, usage);
                }
-            } else {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index] & (~inverseMask[index]));
+
+               const uint32_t timestamp = static_cast<uint32_t>(now / 1000 / 1000);
+               const uint64_t systemJiffies = Core::SystemInfo::Instance().GetJiffies();
+
+               for (uint32_t index = 0; index < tracked.size(); index++) {
+                  LogProcess(timestamp, systemJiffies, tracked[index], usage[index], activity[index]);
                }
+
+               CheckThresholds(timestamp, tracked, usage, activity);
             }
 
-            return count;
-         }
+            AdaptInterval(ThreadTime() - started);
 
-         void LogProcess(const string& name, const Core::ProcessInfo& info)
-         {
-            uint32_t vss = CountSetBits(_ourMap, nullptr);
-            uint32_t uss = CountSetBits(_ourMap, _otherMap);
-            uint64_t jiffies = info.Jiffies();
-
-            uint32_t nameSize = name.length();
-            fwrite(&nameSize, sizeof(nameSize), 1, _binFile);
-            fwrite(name.c_str(), sizeof(name[0]), name.length(), _binFile);
-            fwrite(&vss, 1, sizeof(vss), _binFile);
-            fwrite(&uss, 1, sizeof(uss), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
-            fflush(_binFile);
+            _activity.Schedule(Core::Time::Now().Add(_currentInterval * 1000));
          }
 
-         void StartLogLine(uint32_t processCount)
+    private:
+         void LogProcess(const uint32_t timestamp, const uint64_t systemJiffies, const Tracked& tree, const Usage& usage, const Activity& activity)
          {
-            // TODO: no simple time_t alike in Thunder?
-            uint32_t timestamp = static_cast<uint32_t>(Core::Time::Now().Ticks() / 1000 / 1000);
-            uint64_t jiffies = Core::SystemInfo::Instance().GetJiffies();
-
-            fwrite(&timestamp, 1, sizeof(timestamp), _binFile);
-            fwrite(&processCount, 1, sizeof(processCount), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
+            HistoryLog::Record record;
+
+            memset(&record, 0, sizeof(record));
+            record.Timestamp = timestamp;
+            record.Vss = usage.Vss;
+            record.Uss = usage.Uss;
+            record.Pss = usage.Pss;
+            record.Swap = usage.Swap;
+            record.Jiffies = tree.Info.Jiffies();
+            record.SystemJiffies = systemJiffies;
+            record.CpuLoad = activity.CpuLoad;
+            record.Threads = activity.Threads;
+            record.ReadBytes = activity.ReadBytes;
+            record.WriteBytes = activity.WriteBytes;
+            record.VoluntarySwitches = activity.VoluntarySwitches;
+            record.InvoluntarySwitches = activity.InvoluntarySwitches;
+
+            _log.Append(tree.Name, record);
          }
 
-         FILE *_binFile;
-         vector<string> _processNames; // Seen process names.
-         Core::CriticalSection _namesLock;
-         uint32_t * _otherMap; // Buffer used to mark other processes pages.
-         uint32_t * _ourMap;   // Buffer for pages used by our process (tree).
+         PluginHost::IShell* _service;
+         HistoryLog::Writer _log;
+         vector<uint32_t> _otherMap;  // Pages of all untracked processes.
+         vector<uint32_t> _sharedMap; // Pages found in more than one tracked tree.
+         vector<uint32_t> _seenMap;   // Pages found in any tracked tree so far.
+         vector<vector<uint32_t>> _treeMaps; // Pages per tracked tree, kept between intervals.
          uint32_t _bufferEntries; // Numer of entries in each buffer.
-         uint32_t _interval; // Seconds between measurement.
+         uint32_t _pageSize;
+         uint32_t _interval; // Seconds between measurement, as configured.
+         uint32_t _maxInterval; // Upper limit when the interval is stretched.
+         uint32_t _currentInterval; // Seconds until the next measurement.
+         uint8_t _budget; // Percentage of one CPU the collection may use, 0 is unlimited.
          Config::CollectMode _collectMode; // Collection style.
+         Config::MeasureMode _measureMode; // How memory is measured.
+         uint32_t _ticksPerSecond;
+         uint64_t _lastSample; // Time of the previous sample, in microseconds.
+         std::map<::ThreadId, Counters> _counters; // Per process, as of the previous sample.
+         std::map<string, Alarm> _alarms; // Per tracked tree.
+         uint16_t _cpuThreshold;
+         uint8_t _cpuSamples;
+         uint32_t _growthThreshold;
+         uint8_t _growthSamples;
          string _parentName; // Process/plugin name we are looking for.
          Core::WorkerPool::JobType<StatCollecter&> _activity;
 
@@ -376,7 +769,7 @@ namespace Plugin {
   public:
       ResourceMonitorImplementation()
           : _processThread(nullptr)
-          , _binPath(_T("/tmp/resource-log.bin"))
+          , _binPath()
       {
       }
 
@@ -396,97 +789,31 @@ namespace Plugin {
 
          Config config;
          config.FromString(service->ConfigLine());
-         if (config.Path.IsSet() == true) {
-             _binPath = config.Path.Value().c_str();
-         }
+         _binPath = config.Path.Value();
 
          result = Core::ERROR_NONE;
 
-         _processThread = new StatCollecter(config);
+         _processThread = new StatCollecter(config, service);
 
          return (result);
       }
 
+      // The whole history in one string, kept for COM-RPC clients. The web interface of the plugin streams
+      // a time range of it instead.
       string CompileMemoryCsv() override
       {
-         // TODO: should we worry about doing this as repsonse to RPC (could take too long?)
-         FILE* inFile = fopen(_binPath.c_str(), "rb");
-
-         stringstream output;
-         if (inFile != nullptr) {
+         HistoryLog::Csv csv(_binPath, 0, static_cast<uint32_t>(~0));
+         string output;
+         uint8_t buffer[4096];
+         uint32_t loaded;
 
-            vector<string> processNames;
-            _processThread->GetProcessNames(processNames);
-
-            output << _T("time (s)\tJiffies");
-            for (const string& processName : processNames) {
-               output << _T("\t") << processName << _T(" (VSS)\t") << processName << _T(" (USS)\t") << processName << _T(" (jiffies)");
-            }
-            output << endl;
-
-            vector<uint64_t> pageVector(processNames.size() * 3);
-            bool seenFirstTimestamp = false;
-            uint32_t firstTimestamp = 0;
-
-            while (true) {
-               std::fill(pageVector.begin(), pageVector.end(), 0);
-
-               uint32_t timestamp = 0;
-               size_t readCount = fread(&timestamp, sizeof(timestamp), 1, inFile);
-               if (readCount != 1) {
-                  break;
-               }
-
-               if (!seenFirstTimestamp) {
-                  firstTimestamp = timestamp;
-                  seenFirstTimestamp = true;
-               }
-
-               uint32_t processCount = 0;
-               fread(&processCount, sizeof(processCount), 1, inFile);
-
-               uint64_t totalJiffies = 0;
-               fread(&totalJiffies, sizeof(totalJiffies), 1, inFile);
-
-               for (uint32_t processIndex = 0; processIndex < processCount; processIndex++) {
-                  uint32_t nameLength = 0;
-                  fread(&nameLength, sizeof(nameLength), 1, inFile);
-                  // TODO: unicode?
-                  char nameBuffer[nameLength + 1];
-                  fread(nameBuffer, sizeof(char), nameLength, inFile);
-
-                  nameBuffer[nameLength] = '\0';
-                  string name(nameBuffer);
-
-                  vector<string>::const_iterator nameIterator = std::find(processNames.cbegin(), processNames.cend(), name);
-
-                  uint32_t vss, uss;
-                  uint64_t jiffies;
-                  fread(&vss, sizeof(vss), 1, inFile);
-                  fread(&uss, sizeof(uss), 1, inFile);
-                  fread(&jiffies, sizeof(jiffies), 1, inFile);
-                  if (nameIterator == processNames.cend()) {
-                     continue;
-                  }
-
-                  int index = nameIterator - processNames.cbegin();
-
-                  pageVector[index * 3] = static_cast<uint64_t>(vss);
-                  pageVector[index * 3 + 1] = static_cast<uint64_t>(uss);
-                  pageVector[index * 3 + 2] = jiffies;
-               }
-
-               output << (timestamp - firstTimestamp) << "\t" << totalJiffies;
-               for (uint32_t pageEntry : pageVector) {
-                  output << "\t" << pageEntry;
-               }
-               output << endl;
-            }
+         output.reserve(static_cast<size_t>(csv.Length()));
 
-            fclose(inFile);
+         while ((loaded = csv.Read(buffer, sizeof(buffer))) != 0) {
+            output.append(reinterpret_cast<const char*>(buffer), loaded);
          }
 
-         return output.str();
+         return output;
       }
 
       BEGIN_INTERFACE_MAP(ResourceMonitorImplementation)
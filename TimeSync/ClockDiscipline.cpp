@@ -0,0 +1,156 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ClockDiscipline.h"
+
+#include <cmath>
+
+#ifndef __WINDOWS__
+#include <sys/timex.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    /* static */ constexpr double ClockDiscipline::MaxFrequency;
+    /* static */ constexpr uint8_t ClockDiscipline::MinPoll;
+    /* static */ constexpr uint8_t ClockDiscipline::MaxPoll;
+
+    ClockDiscipline::ClockDiscipline()
+        : _frequency(0)
+        , _reference(0)
+        , _poll(MinPoll)
+        , _maxPoll(MaxPoll)
+        , _stable(0)
+    {
+#ifndef __WINDOWS__
+        // Continue from the correction that is in place, it was probably estimated by a previous run.
+        struct timex info;
+        ::memset(&info, 0, sizeof(info));
+
+        if (::adjtimex(&info) != -1) {
+            _frequency = static_cast<double>(info.freq) / 65536.0;
+        }
+#endif
+    }
+
+    ClockDiscipline::action ClockDiscipline::Update(const double offset, const uint64_t now, const uint8_t serverPoll)
+    {
+        action result = STEP;
+
+        if (std::abs(offset) <= StepThreshold) {
+            const double pending = Pending();
+
+            if (_reference != 0) {
+                const double interval = static_cast<double>(now - _reference) / (1000 * 1000);
+
+                if (interval >= (1 << MinPoll) / 2) {
+                    // What was still being slewed will be corrected anyway, the rest built up by drifting.
+                    const double drift = ((offset - pending) / interval) * (1000 * 1000);
+
+                    _frequency = std::max(-MaxFrequency, std::min(MaxFrequency, _frequency + (FrequencyGain * drift)));
+
+                    if (Frequency(_frequency) == false) {
+                        TRACE(Trace::Warning, (_T("Could not correct the clock frequency to %lf ppm"), _frequency));
+                    }
+                }
+            }
+
+            if (Slew(offset) == true) {
+                _reference = now;
+                result = SLEW;
+
+                if (std::abs(offset) < StableThreshold) {
+                    if ((++_stable >= StableRounds) && (_poll < _maxPoll)) {
+                        _poll++;
+                        _stable = 0;
+                    }
+                } else {
+                    _poll = std::max(MinPoll, static_cast<uint8_t>(_poll - 1));
+                    _stable = 0;
+                }
+            }
+        }
+
+        if (result == STEP) {
+            // The interval since the last offset says nothing about the drift anymore.
+            _reference = 0;
+            _poll = MinPoll;
+            _stable = 0;
+        }
+
+        _poll = std::max(_poll, std::min(serverPoll, _maxPoll));
+
+        TRACE(Trace::Information, (_T("TimeSync: offset %lf s %s, frequency %lf ppm, next in %d s"), offset, (result == STEP ? _T("stepped") : _T("slewed")), _frequency, (1 << _poll)));
+
+        return (result);
+    }
+
+#ifndef __WINDOWS__
+    /* static */ bool ClockDiscipline::Slew(const double offset)
+    {
+        struct timex info;
+        ::memset(&info, 0, sizeof(info));
+
+        // Replaces whatever was still being slewed.
+        info.modes = ADJ_OFFSET_SINGLESHOT;
+        info.offset = static_cast<long>(offset * 1000 * 1000);
+
+        return (::adjtimex(&info) != -1);
+    }
+
+    /* static */ double ClockDiscipline::Pending()
+    {
+        struct timex info;
+        ::memset(&info, 0, sizeof(info));
+
+        info.modes = ADJ_OFFSET_SS_READ;
+
+        return (::adjtimex(&info) != -1 ? static_cast<double>(info.offset) / (1000 * 1000) : 0);
+    }
+
+    /* static */ bool ClockDiscipline::Frequency(const double ppm)
+    {
+        struct timex info;
+        ::memset(&info, 0, sizeof(info));
+
+        info.modes = ADJ_FREQUENCY;
+        info.freq = static_cast<long>(ppm * 65536.0);
+
+        return (::adjtimex(&info) != -1);
+    }
+#else
+    /* static */ bool ClockDiscipline::Slew(const double)
+    {
+        return (false);
+    }
+
+    /* static */ double ClockDiscipline::Pending()
+    {
+        return (0);
+    }
+
+    /* static */ bool ClockDiscipline::Frequency(const double)
+    {
+        return (false);
+    }
+#endif
+
+} // namespace Plugin
+} // namespace WPEFramework
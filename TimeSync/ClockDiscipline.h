@@ -0,0 +1,94 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMESYNC_CLOCKDISCIPLINE_H
+#define TIMESYNC_CLOCKDISCIPLINE_H
+
+#include "Module.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Keeps the system clock on time without making it jump. An offset below the step threshold is slewed
+    // away by the kernel. The offset that builds up between two synchronizations, minus what was still being
+    // slewed, is the frequency error of the local oscillator; it is corrected as well, so the clock drifts less
+    // the longer it runs. While the offsets stay small the interval between synchronizations doubles, up to
+    // the maximum, a large offset brings it back down.
+    class ClockDiscipline {
+    public:
+        enum action {
+            STEP, // Set the clock, the offset is too large to slew (or slewing is not possible)
+            SLEW // The kernel takes care of it
+        };
+
+        static constexpr double StepThreshold = 0.128; // seconds, as ntpd
+        static constexpr double StableThreshold = 0.005; // seconds, below this the clock counts as on time
+        static constexpr double MaxFrequency = 500; // ppm, what the kernel accepts
+        static constexpr double FrequencyGain = 0.5;
+        static constexpr uint8_t MinPoll = 6; // 64 seconds
+        static constexpr uint8_t MaxPoll = 17; // 36 hours
+        static constexpr uint8_t StableRounds = 3; // Small offsets in a row before the interval grows
+
+    private:
+        ClockDiscipline(const ClockDiscipline&) = delete;
+        ClockDiscipline& operator=(const ClockDiscipline&) = delete;
+
+    public:
+        ClockDiscipline();
+        ~ClockDiscipline()
+        {
+        }
+
+    public:
+        // Longest interval allowed, in log2 seconds.
+        void Limit(const uint8_t maxPoll)
+        {
+            _maxPoll = std::max(MinPoll, std::min(maxPoll, MaxPoll));
+            _poll = std::min(_poll, _maxPoll);
+        }
+        // Take in the offset measured at the given time (ticks), positive if the clock is behind. The server
+        // may ask not to be polled more often than the given interval (log2 seconds).
+        action Update(const double offset, const uint64_t now, const uint8_t serverPoll);
+        // Milliseconds until the next synchronization.
+        uint32_t Interval() const
+        {
+            return ((static_cast<uint32_t>(1) << _poll) * 1000);
+        }
+        double Frequency() const
+        {
+            return (_frequency);
+        }
+
+    private:
+        static bool Slew(const double offset);
+        static double Pending();
+        static bool Frequency(const double ppm);
+
+    private:
+        double _frequency; // ppm correction applied
+        uint64_t _reference; // Ticks of the last offset that was slewed, 0 if there is none
+        uint8_t _poll;
+        uint8_t _maxPoll;
+        uint8_t _stable;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
+
+#endif // TIMESYNC_CLOCKDISCIPLINE_H
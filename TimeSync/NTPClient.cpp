@@ -37,6 +37,12 @@ namespace Plugin {
         , _fired(true)
         , _WaitForNetwork(2000) // Wait for 2 Seconds for a new attempt
         , _retryAttempts(5)
+        , _parallel(false)
+        , _collecting(false)
+        , _sources()
+        , _systemPeer()
+        , _offset(0)
+        , _poll(0)
         , _activity(Core::ProxyType<Activity>::Create(this))
         , _clients()
     {
@@ -61,11 +67,13 @@ namespace Plugin {
         Close(Core::infinite);
     }
 
-    void NTPClient::Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay)
+    void NTPClient::Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay, const bool parallel)
     {
         _retryAttempts = retries;
         _WaitForNetwork = (delay * 1000); /* in ms */
+        _parallel = parallel;
         _servers.clear();
+        _sources.clear();
 
         while (sources.Next() == true) {
             Core::URL url(sources.Current().Value());
@@ -83,6 +91,7 @@ namespace Plugin {
                 }
 
                 _servers.push_back(hostname);
+                _sources.emplace_back(hostname);
             }
         }
 
@@ -134,8 +143,30 @@ namespace Plugin {
         return (_syncedTimestamp.IsValid() ? _syncedTimestamp.Ticks() : 0);
     }
 
+    double NTPClient::Offset() const
+    {
+        _adminLock.Lock();
+        const double result = _offset;
+        _adminLock.Unlock();
+
+        return (result);
+    }
+
+    uint8_t NTPClient::Poll() const
+    {
+        _adminLock.Lock();
+        const uint8_t result = _poll;
+        _adminLock.Unlock();
+
+        return (result);
+    }
+
     /* virtual */ string NTPClient::Source() const
     {
+        if (_parallel == true) {
+            return (_systemPeer.empty() == false ? string(_T("NTP://")) + _systemPeer + '/' : _T("NTP:///"));
+        }
+
         return (_serverIndex.IsValid() == true ? string(_T("NTP://")) + (*_serverIndex) + '/' : _T("NTP:///"));
     }
 
@@ -174,7 +205,28 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        if (_fired == false) {
+        if (_parallel == true) {
+            // One request per source, all from this socket. Each goes to its own server.
+            std::vector<Source>::iterator index(_sources.begin());
+
+            while ((index != _sources.end()) && ((index->IsPending() == false) || (index->Sent() != 0))) {
+                index++;
+            }
+
+            if (index != _sources.end()) {
+                const Core::Time now(Core::Time::Now());
+
+                RemoteNode(index->Remote());
+                index->Sent(now.Ticks());
+
+                DataFrame newFrame(dataFrame, maxSendSize);
+                DataFrame::Writer writer(newFrame, 0);
+                _packet.TransmitTimestamp(NTPPacket::Timestamp(now));
+                _packet.Serialize(writer);
+
+                result = newFrame.Size();
+            }
+        } else if (_fired == false) {
 
             _fired = true;
 
@@ -192,20 +244,30 @@ namespace Plugin {
         return result;
     }
 
-    inline static uint64_t SecondsToTicks(double seconds)
-    {
-        return static_cast<uint64_t>(seconds * NTPClient::MicroSeconds);
-    }
-
     /* virtual */ uint16_t NTPClient::ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
     {
-        double received = static_cast<double>(Core::Time::Now().Ticks() / MicroSeconds);
+        const uint64_t arrival = Core::Time::Now().Ticks();
+        double received = static_cast<double>(arrival) / MicroSeconds;
 
         TRACE_L1("Timesync: Received data: %d bytes", receivedSize);
 
         _adminLock.Lock();
 
-        if (receivedSize == NTPPacket::PacketSize) {
+        if (_parallel == true) {
+            if (receivedSize == NTPPacket::PacketSize) {
+                DataFrame frame(dataFrame, receivedSize, receivedSize);
+                NTPPacket packet;
+                packet.Deserialize(DataFrame::Reader(frame, 0));
+
+                Sample(packet, arrival);
+
+                if (std::find_if(_sources.begin(), _sources.end(), [](const Source& source) { return (source.IsPending()); }) == _sources.end()) {
+                    // Everybody answered, no need to wait for the timeout.
+                    Core::IWorkerPool::Instance().Revoke(_activity);
+                    Core::IWorkerPool::Instance().Submit(_activity);
+                }
+            }
+        } else if (receivedSize == NTPPacket::PacketSize) {
 
             DataFrame frame(dataFrame, receivedSize, receivedSize);
             NTPPacket packet;
@@ -242,9 +304,10 @@ namespace Plugin {
             TRACE(Trace::Information, (_T("TimeSync: Response time diff  = %lf s"), diffResponse));
             TRACE(Trace::Information, (_T("TimeSync: Offset time         = %lf s"), offset));
 
-            uint64_t receivedTicks = SecondsToTicks(received);
-            TRACE(Trace::Information, (_T("TimeSync: Current time: %s"), Core::Time(receivedTicks).ToRFC1123(false).c_str()));
-            _syncedTimestamp = Core::Time(receivedTicks + SecondsToTicks(offset));
+            TRACE(Trace::Information, (_T("TimeSync: Current time: %s"), Core::Time(arrival).ToRFC1123(false).c_str()));
+            _offset = offset;
+            _poll = packet.Poll();
+            _syncedTimestamp = Core::Time(arrival + static_cast<int64_t>(offset * MicroSeconds));
             TRACE(Trace::Information, (_T("TimeSync: New time:     %s"), _syncedTimestamp.ToRFC1123(false).c_str()));
 
             _state = SUCCESS;
@@ -334,6 +397,229 @@ namespace Plugin {
         return (activated);
     }
 
+    // Send a request to all sources that resolve. Returns the number of requests fired.
+    uint16_t NTPClient::FireRound()
+    {
+        uint16_t result = 0;
+        Core::NodeId first;
+
+        if (!IsClosed()) {
+            TRACE(Trace::Information, (_T("Lingering socket, closing")));
+            Close(1000);
+        }
+
+        for (Source& source : _sources) {
+            if (source.Resolve() == true) {
+                source.Pending(true);
+                if (first.IsValid() == false) {
+                    first = source.Remote();
+                }
+                result++;
+            } else {
+                source.Pending(false);
+                TRACE(Trace::Warning, (_T("Could not resolve NTP Server [%s]"), source.Name().c_str()));
+            }
+        }
+
+        if (result != 0) {
+            RemoteNode(first);
+            LocalNode(first.AnyInterface());
+
+            const uint32_t status = Open(100);
+
+            if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+                Trigger();
+            } else {
+                TRACE(Trace::Warning, (_T("Could not open a socket for the NTP requests")));
+
+                for (Source& source : _sources) {
+                    source.Pending(false);
+                }
+                result = 0;
+            }
+        }
+
+        return (result);
+    }
+
+    // Turn a reply into a sample of the source it came from (RFC 5905 section 8).
+    void NTPClient::Sample(const NTPPacket& packet, const uint64_t received)
+    {
+        const Core::NodeId& origin(ReceivedNode());
+        std::vector<Source>::iterator index(_sources.begin());
+
+        while ((index != _sources.end()) && ((index->IsPending() == false) || (index->Sent() == 0) || (!(index->Remote() == origin)))) {
+            index++;
+        }
+
+        if (index != _sources.end()) {
+            const int64_t t1 = static_cast<int64_t>(index->Sent());
+            const int64_t t2 = static_cast<int64_t>(Core::Time(packet.ReceiveTimestamp()).Ticks());
+            const int64_t t3 = static_cast<int64_t>(Core::Time(packet.TransmitTimestamp()).Ticks());
+            const int64_t t4 = static_cast<int64_t>(received);
+            const int64_t echoed = static_cast<int64_t>(Core::Time(packet.OriginalTimestamp()).Ticks());
+
+            // The server echoes our transmit time, anything else is a stale or forged reply. The conversions
+            // round, allow for a microsecond.
+            if (std::abs(echoed - t1) > 1) {
+                TRACE(Trace::Warning, (_T("NTP Server [%s] replied to another request"), index->Name().c_str()));
+            } else if ((packet.NTPMode() != 4) || (packet.Stratum() == 0) || (packet.Stratum() > 15) || (packet.LeapIndicator() == 3) || (t3 == 0)) {
+                // Kiss-o'-death or not synchronized itself, do not wait for it any longer.
+                TRACE(Trace::Warning, (_T("NTP Server [%s] is not usable, stratum %d"), index->Name().c_str(), packet.Stratum()));
+                index->Pending(false);
+            } else {
+                const double Fraction_16_16 = 65536.0;
+                Source::Sample sample;
+
+                sample.Offset = static_cast<double>((t2 - t1) + (t3 - t4)) / (2 * MicroSeconds);
+                sample.Delay = std::max(static_cast<double>((t4 - t1) - (t3 - t2)) / MicroSeconds, 1.0 / MicroSeconds);
+                sample.Distance = ((packet.RootDelay() / Fraction_16_16) + sample.Delay) / 2 + (packet.RootDispersion() / Fraction_16_16)
+                    + ::ldexp(1.0, static_cast<int8_t>(packet.Precision())) + (1.0 / MicroSeconds);
+
+                TRACE(Trace::Information, (_T("TimeSync: [%s] offset %lf s, delay %lf s, distance %lf s"), index->Name().c_str(), sample.Offset, sample.Delay, sample.Distance));
+
+                index->Add(sample);
+                _poll = std::max(_poll, packet.Poll());
+            }
+        }
+    }
+
+    // Pick the time from the sources that agree (RFC 5905 section 11.2): intersect the intervals in which
+    // their true offsets lie, drop the falsetickers that fall outside, prune the outliers of what is left and
+    // average the survivors weighted by their accuracy.
+    bool NTPClient::Select(double& offset)
+    {
+        struct Candidate {
+            const Source* Peer;
+            double Offset;
+            double Distance;
+            double Jitter;
+        };
+        struct Edge {
+            double Value;
+            int8_t Type; // -1 low end, 0 midpoint, +1 high end
+            bool operator<(const Edge& rhs) const
+            {
+                return (Value < rhs.Value);
+            }
+        };
+
+        std::vector<Candidate> candidates;
+        std::vector<Edge> edges;
+
+        for (const Source& source : _sources) {
+            if (source.HasSamples() == true) {
+                const Source::Sample& best(source.Best());
+                const double jitter = source.Jitter();
+
+                candidates.push_back({ &source, best.Offset, best.Distance + jitter, jitter });
+                edges.push_back({ best.Offset - (best.Distance + jitter), -1 });
+                edges.push_back({ best.Offset, 0 });
+                edges.push_back({ best.Offset + (best.Distance + jitter), +1 });
+            }
+        }
+
+        const int32_t count = static_cast<int32_t>(candidates.size());
+        double low = 0;
+        double high = 0;
+        int32_t allow = 0;
+
+        std::sort(edges.begin(), edges.end());
+
+        // Find the smallest interval that the majority of the candidates agree on.
+        for (; (2 * allow) < count; allow++) {
+            int32_t found = 0;
+            int32_t chime = 0;
+
+            for (const Edge& edge : edges) {
+                chime -= edge.Type;
+                if (chime >= (count - allow)) {
+                    low = edge.Value;
+                    break;
+                }
+                found += (edge.Type == 0 ? 1 : 0);
+            }
+
+            chime = 0;
+            for (std::vector<Edge>::const_reverse_iterator edge(edges.rbegin()); edge != edges.rend(); edge++) {
+                chime += edge->Type;
+                if (chime >= (count - allow)) {
+                    high = edge->Value;
+                    break;
+                }
+                found += (edge->Type == 0 ? 1 : 0);
+            }
+
+            if ((found <= allow) && (high > low)) {
+                break;
+            }
+        }
+
+        bool result = false;
+
+        if ((count > 0) && ((2 * allow) < count)) {
+            std::vector<Candidate> survivors;
+
+            for (const Candidate& candidate : candidates) {
+                if (((candidate.Offset - candidate.Distance) <= high) && ((candidate.Offset + candidate.Distance) >= low)) {
+                    survivors.push_back(candidate);
+                } else {
+                    TRACE(Trace::Warning, (_T("NTP Server [%s] is a falseticker, offset %lf s"), candidate.Peer->Name().c_str(), candidate.Offset));
+                }
+            }
+
+            // Drop the survivor that is furthest from the others, as long as that spread exceeds the jitter
+            // the best of them shows on its own.
+            while (survivors.size() > MinSurvivors) {
+                double worst = 0;
+                double steadiest = survivors.front().Jitter;
+                uint32_t outlier = 0;
+
+                for (uint32_t index = 0; index < survivors.size(); index++) {
+                    double spread = 0;
+
+                    for (const Candidate& other : survivors) {
+                        spread += (other.Offset - survivors[index].Offset) * (other.Offset - survivors[index].Offset);
+                    }
+                    spread = ::sqrt(spread / (survivors.size() - 1));
+
+                    if (spread > worst) {
+                        worst = spread;
+                        outlier = index;
+                    }
+                    steadiest = std::min(steadiest, survivors[index].Jitter);
+                }
+
+                if (worst <= steadiest) {
+                    break;
+                }
+
+                survivors.erase(survivors.begin() + outlier);
+            }
+
+            double weights = 0;
+            double sum = 0;
+            const Candidate* peer = &(survivors.front());
+
+            for (const Candidate& survivor : survivors) {
+                weights += 1.0 / survivor.Distance;
+                sum += survivor.Offset / survivor.Distance;
+
+                if (survivor.Distance < peer->Distance) {
+                    peer = &survivor;
+                }
+            }
+
+            offset = (sum / weights);
+            _systemPeer = peer->Peer->Name();
+            result = true;
+
+            TRACE(Trace::Information, (_T("TimeSync: %d of %d sources survived, offset %lf s, system peer [%s]"), static_cast<uint32_t>(survivors.size()), count, offset, _systemPeer.c_str()));
+        }
+
+        return (result);
+    }
+
     void NTPClient::Update()
     {
 
@@ -364,8 +650,48 @@ namespace Plugin {
             _serverIndex.Reset(0);
             _state = INPROGRESS;
             _currentAttempt = _retryAttempts;
+            _collecting = false;
+            _poll = 0;
+
+            // Offsets measured before the clock was set are meaningless now.
+            for (Source& source : _sources) {
+                source.Clear();
+            }
         }
         case INPROGRESS: {
+            if (_parallel == true) {
+                double offset;
+
+                if (_collecting == true) {
+                    // The round is complete or timed out, see what the answers tell us.
+                    _collecting = false;
+                    Close(0);
+
+                    if (Select(offset) == true) {
+                        _offset = offset;
+                        _syncedTimestamp = Core::Time(Core::Time::Now().Ticks() + static_cast<int64_t>(offset * MicroSeconds));
+                        _state = SUCCESS;
+                        Update();
+                    } else if (_currentAttempt-- != 0) {
+                        // No majority yet, the next round adds samples.
+                        result = _WaitForNetwork;
+                    } else {
+                        _state = FAILED;
+                        Update();
+                    }
+                } else if (FireRound() != 0) {
+                    _collecting = true;
+                    result = WaitForResponse;
+                } else if (_currentAttempt-- != 0) {
+                    result = _WaitForNetwork;
+                } else {
+                    _state = FAILED;
+                    Update();
+                }
+                break;
+            }
+
+
             // If we end up here in this state, it means that the package was send but no response was received,
             // or a response was received but is was not properly formatted...
             // Lets move to the next server in the list, see if that one responds correctly, if we tried all servers let's
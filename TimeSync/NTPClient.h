@@ -22,6 +22,7 @@
 
 #include "Module.h"
 #include <interfaces/ITimeSync.h>
+#include <cmath>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -39,6 +40,9 @@ namespace Plugin {
         using ServerIterator = Core::IteratorType<const ServerList, const string&, ServerList::const_iterator>;
         using DataFrame = Core::FrameType<0>;
 
+        // Clustering stops at this many survivors (RFC 5905 section 11.2.2).
+        static constexpr uint8_t MinSurvivors = 3;
+
         // This enum tracks the state for actions begin performed. As the Worker() method is re-entered,
         // we need to keep track of state.
         enum state {
@@ -328,6 +332,131 @@ namespace Plugin {
                 // bit (NTP time)
         };
 
+        // A server queried in parallel mode, with the last samples it delivered. The sample with the lowest
+        // round trip delay is the one used, it suffers least from queueing in the network (RFC 5905, the clock
+        // filter).
+        class Source {
+        public:
+            static constexpr uint8_t MaxSamples = 8;
+
+            struct Sample {
+                double Offset; // Seconds the server is ahead of us
+                double Delay; // Round trip, in seconds
+                double Distance; // Maximum error of the offset, in seconds
+            };
+
+        public:
+            Source() = delete;
+            Source& operator=(const Source&) = delete;
+
+            Source(const string& name)
+                : _name(name)
+                , _remote()
+                , _sent(0)
+                , _pending(false)
+                , _count(0)
+                , _next(0)
+            {
+            }
+            Source(const Source& copy)
+                : _name(copy._name)
+                , _remote(copy._remote)
+                , _sent(copy._sent)
+                , _pending(copy._pending)
+                , _count(copy._count)
+                , _next(copy._next)
+            {
+                ::memcpy(_samples, copy._samples, sizeof(_samples));
+            }
+            ~Source()
+            {
+            }
+
+        public:
+            const string& Name() const
+            {
+                return (_name);
+            }
+            const Core::NodeId& Remote() const
+            {
+                return (_remote);
+            }
+            bool Resolve()
+            {
+                _remote = Core::NodeId(_name.c_str(), Core::NodeId::TYPE_IPV4);
+                return (_remote.IsValid());
+            }
+            bool IsPending() const
+            {
+                return (_pending);
+            }
+            void Pending(const bool pending)
+            {
+                _pending = pending;
+                _sent = 0;
+            }
+            // The transmit timestamp of the outstanding request, 0 if it was not sent yet.
+            uint64_t Sent() const
+            {
+                return (_sent);
+            }
+            void Sent(const uint64_t ticks)
+            {
+                _sent = ticks;
+            }
+            void Add(const Sample& sample)
+            {
+                _samples[_next] = sample;
+                _next = (_next + 1) % MaxSamples;
+                _count = std::min(static_cast<uint8_t>(_count + 1), MaxSamples);
+                _pending = false;
+            }
+            void Clear()
+            {
+                _count = 0;
+                _next = 0;
+            }
+            bool HasSamples() const
+            {
+                return (_count != 0);
+            }
+            const Sample& Best() const
+            {
+                uint8_t best = 0;
+                for (uint8_t index = 1; index < _count; index++) {
+                    if (_samples[index].Delay < _samples[best].Delay) {
+                        best = index;
+                    }
+                }
+                return (_samples[best]);
+            }
+            // RMS difference of the offsets with the best one.
+            double Jitter() const
+            {
+                double result = 0;
+
+                if (_count > 1) {
+                    const double offset = Best().Offset;
+
+                    for (uint8_t index = 0; index < _count; index++) {
+                        result += (_samples[index].Offset - offset) * (_samples[index].Offset - offset);
+                    }
+                    result = ::sqrt(result / (_count - 1));
+                }
+
+                return (result);
+            }
+
+        private:
+            string _name;
+            Core::NodeId _remote;
+            uint64_t _sent;
+            bool _pending;
+            uint8_t _count;
+            uint8_t _next;
+            Sample _samples[MaxSamples];
+        };
+
         class Activity : public Core::IDispatchType<void> {
         private:
             Activity() = delete;
@@ -363,7 +492,7 @@ namespace Plugin {
         virtual ~NTPClient();
 
     public:
-        void Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay);
+        void Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay, const bool parallel = false);
         virtual void Register(Exchange::ITimeSync::INotification* notification) override;
         virtual void Unregister(Exchange::ITimeSync::INotification* notification) override;
 
@@ -372,6 +501,11 @@ namespace Plugin {
         virtual string Source() const override;
         virtual uint64_t SyncTime() const override;
 
+        // Seconds the clock was behind at the last synchronization, and the poll interval (log2 seconds) the
+        // server(s) asked for.
+        double Offset() const;
+        uint8_t Poll() const;
+
         // ITime methods
         virtual uint64_t TimeSync() const override
         {
@@ -394,9 +528,12 @@ namespace Plugin {
         void Update();
         void Dispatch();
         bool FireRequest();
+        uint16_t FireRound();
+        void Sample(const NTPPacket& packet, const uint64_t received);
+        bool Select(double& offset);
 
     private:
-        Core::CriticalSection _adminLock;
+        mutable Core::CriticalSection _adminLock;
         NTPPacket _packet;
         Core::Time _syncedTimestamp;
         state _state;
@@ -406,6 +543,12 @@ namespace Plugin {
         uint32_t _currentAttempt;
         ServerList _servers;
         ServerIterator _serverIndex;
+        bool _parallel;
+        bool _collecting;
+        std::vector<Source> _sources;
+        string _systemPeer;
+        double _offset;
+        uint8_t _poll;
         Core::ProxyType<Core::IDispatchType<void>> _activity;
         std::list<Exchange::ITimeSync::INotification*> _clients;
     };
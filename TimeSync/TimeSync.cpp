@@ -37,6 +37,8 @@ namespace Plugin {
     TimeSync::TimeSync()
         : _skipURL(0)
         , _periodicity(0)
+        , _disciplined(false)
+        , _discipline()
         , _client(Core::Service<NTPClient>::Create<Exchange::ITimeSync>())
         , _activity(Core::ProxyType<PeriodicSync>::Create(_client))
         , _sink(this)
@@ -62,10 +64,20 @@ namespace Plugin {
         _skipURL = static_cast<uint16_t>(service->WebPrefix().length());
         _periodicity = config.Periodicity.Value() * 60 /* minutes */ * 60 /* seconds */ * 1000 /* milliSeconds */;
         bool start = (((config.Deferred.IsSet() == true) && (config.Deferred.Value() == true)) == false);
+        _disciplined = config.Discipline.Value();
+
+        if (_periodicity != 0) {
+            // The periodicity caps the interval the discipline may grow to.
+            uint8_t maxPoll = 0;
+            while ((static_cast<uint64_t>(1000) << (maxPoll + 1)) <= _periodicity) {
+                maxPoll++;
+            }
+            _discipline.Limit(maxPoll);
+        }
 
         NTPClient::SourceIterator index(config.Sources.Elements());
 
-        static_cast<NTPClient*>(_client)->Initialize(index, config.Retries.Value(), config.Interval.Value());
+        static_cast<NTPClient*>(_client)->Initialize(index, config.Retries.Value(), config.Interval.Value(), config.Parallel.Value());
 
         ASSERT(service != nullptr);
         ASSERT(_service == nullptr);
@@ -174,11 +186,31 @@ namespace Plugin {
     {
         Core::Time newTime(time);
 
-        TRACE(Trace::Information, (_T("Syncing time to %s."), newTime.ToRFC1123(false).c_str()));
+        if (_disciplined == true) {
+            const NTPClient* client = static_cast<const NTPClient*>(_client);
 
-        Core::SystemInfo::Instance().SetTime(newTime);
+            if (_discipline.Update(client->Offset(), Core::Time::Now().Ticks(), client->Poll()) == ClockDiscipline::STEP) {
+                TRACE(Trace::Information, (_T("Syncing time to %s."), newTime.ToRFC1123(false).c_str()));
 
-        if (_periodicity != 0) {
+                Core::SystemInfo::Instance().SetTime(newTime);
+            }
+
+            // Keep measuring, the discipline decides how often.
+            Core::Time newSyncTime(Core::Time::Now());
+
+            newSyncTime.Add(_discipline.Interval());
+
+            TRACE_L1("Waking up again at %s.", newSyncTime.ToRFC1123(false).c_str());
+            Core::IWorkerPool::Instance().Schedule(newSyncTime, _activity);
+
+            event_timechange();
+        } else {
+            TRACE(Trace::Information, (_T("Syncing time to %s."), newTime.ToRFC1123(false).c_str()));
+
+            Core::SystemInfo::Instance().SetTime(newTime);
+        }
+
+        if ((_disciplined == false) && (_periodicity != 0)) {
             Core::Time newSyncTime(Core::Time::Now());
 
             newSyncTime.Add(_periodicity);
@@ -21,6 +21,7 @@
 #define TIMESYNC_H
 
 #include "Module.h"
+#include "ClockDiscipline.h"
 #include <interfaces/ITimeSync.h>
 #include <interfaces/json/JsonData_TimeSync.h>
 
@@ -155,12 +156,16 @@ namespace Plugin {
                 , Retries(8)
                 , Sources()
                 , Periodicity(0)
+                , Parallel(false)
+                , Discipline(false)
             {
                 Add(_T("deferred"), &Deferred);
                 Add(_T("interval"), &Interval);
                 Add(_T("retries"), &Retries);
                 Add(_T("sources"), &Sources);
                 Add(_T("periodicity"), &Periodicity);
+                Add(_T("parallel"), &Parallel);
+                Add(_T("discipline"), &Discipline);
             }
             ~Config()
             {
@@ -172,6 +177,8 @@ namespace Plugin {
             Core::JSON::DecUInt8 Retries;
             Core::JSON::ArrayType<Core::JSON::String> Sources;
             Core::JSON::DecUInt16 Periodicity;
+            Core::JSON::Boolean Parallel;
+            Core::JSON::Boolean Discipline;
         };
 
         class PeriodicSync : public Core::IDispatch {
@@ -248,6 +255,8 @@ namespace Plugin {
     private:
         uint16_t _skipURL;
         uint32_t _periodicity;
+        bool _disciplined;
+        ClockDiscipline _discipline;
         Exchange::ITimeSync* _client;
         Core::ProxyType<Core::IDispatch> _activity;
         Core::Sink<Notification> _sink;
@@ -177,18 +177,16 @@ namespace Plugin {
 #ifdef __WINDOWS__
 #pragma warning(disable : 4355)
 #endif
-        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t bufferSize)
-            : WebProxy::Connector(channel, &_streamType)
-            , _streamType(*this, bufferSize)
-        {
-        }
-        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t bufferSize, const Core::NodeId& remoteId)
-            : WebProxy::Connector(channel, &_streamType)
+        inline ConnectorWrapper(PluginHost::Channel& channel, const string& name, WebProxy::Statistics& statistics, const uint32_t linkBuffer, const bool datagram, const uint32_t bufferSize, const Core::NodeId& remoteId)
+            : WebProxy::Connector(channel, &_streamType, name, statistics, linkBuffer, datagram)
             , _streamType(*this, bufferSize, remoteId)
         {
         }
         inline ConnectorWrapper(
             PluginHost::Channel& channel,
+            const string& name,
+            WebProxy::Statistics& statistics,
+            const uint32_t linkBuffer,
             const uint32_t bufferSize,
             const string& deviceName,
             const Core::SerialPort::BaudRate baudrate,
@@ -196,7 +194,7 @@ namespace Plugin {
             const Core::SerialPort::DataBits dataBits,
             const Core::SerialPort::StopBits stopBits,
             const Core::SerialPort::FlowControl flowControl)
-            : WebProxy::Connector(channel, &_streamType)
+            : WebProxy::Connector(channel, &_streamType, name, statistics, linkBuffer, false)
             , _streamType(*this, bufferSize, deviceName, baudrate, parityE, dataBits, stopBits, flowControl)
         {
         }
@@ -234,6 +232,8 @@ namespace Plugin {
             while (index.Next() == true) {
                 if (index.Current().Name.IsSet() == true) {
                     _linkInfo.insert(std::pair<const string, Config::Link>(index.Current().Name.Value(), index.Current()));
+                    _pools[index.Current().Name.Value()];
+                    _statistics[index.Current().Name.Value()];
                 }
             }
         }
@@ -246,6 +246,18 @@ namespace Plugin {
 
     /* virtual */ void WebProxy::Deinitialize(PluginHost::IShell* service)
     {
+        _adminLock.Lock();
+
+        // Parked connectors have no channel that will detach them, close them now.
+        for (std::pair<const string, std::list<Connector*>>& pool : _pools) {
+            for (Connector* connector : pool.second) {
+                connector->Detach();
+                _closing.push_back(connector);
+            }
+            pool.second.clear();
+        }
+
+        _adminLock.Unlock();
 
         service->DisableWebServer();
     }
@@ -255,25 +267,21 @@ namespace Plugin {
     /* virtual */ bool WebProxy::Attach(PluginHost::Channel& channel)
     {
         bool added = false;
-        Core::NodeId nodeId;
 
-        // First do a cleanup of all "completely" closed channels.
-        std::map<const uint32_t, Connector*>::iterator connection(_connectionMap.begin());
+        _adminLock.Lock();
 
-        while (connection != _connectionMap.end()) {
-            if (connection->second->IsClosed() == true) {
-                delete connection->second;
-                connection = _connectionMap.erase(connection);
-            } else {
-                connection++;
-            }
-        }
+        // First get rid of the connectors that have completely closed by now.
+        Cleanup();
 
         // See if we are still allowed to create a new connection..
         if (_connectionMap.size() < _maxConnections) {
-            Connector* newLink = CreateConnector(channel);
+            Connector* newLink = Reuse(channel);
 
             if (newLink != nullptr) {
+                _connectionMap.insert(std::pair<uint32_t, Connector*>(channel.Id(), newLink));
+                TRACE(Trace::Information, (Trace::Format(_T("Proxy connection channel ID [%d] reuses %s"), channel.Id(), newLink->RemoteId().c_str()).c_str()));
+                added = true;
+            } else if ((newLink = CreateConnector(channel)) != nullptr) {
                 _connectionMap.insert(std::pair<uint32_t, Connector*>(channel.Id(), newLink));
                 TRACE(Trace::Information, (Trace::Format(_T("Proxy connection channel ID [%d] to %s"), channel.Id(), newLink->RemoteId().c_str()).c_str()));
                 added = true;
@@ -282,17 +290,25 @@ namespace Plugin {
             }
         }
 
+        _adminLock.Unlock();
+
         return (added);
     }
 
     /* virtual */ void WebProxy::Detach(PluginHost::Channel& channel)
     {
+        _adminLock.Lock();
+
         // See if we can forward this info..
         std::map<const uint32_t, Connector*>::iterator connection = _connectionMap.find(channel.Id());
 
         if (connection != _connectionMap.end()) {
-            connection->second->Detach();
+            Connector* connector = connection->second;
+            _connectionMap.erase(connection);
+            Release(connector);
         }
+
+        _adminLock.Unlock();
     }
 
     /* virtual */ string WebProxy::Information() const
@@ -309,11 +325,23 @@ namespace Plugin {
     {
         uint32_t result = length;
 
-        // See if we can forward this info..
+        Connector* connector = nullptr;
+
+        // Only the lookup needs the plugin lock, the data moves through the rings of the connector.
+        _adminLock.Lock();
+
         std::map<const uint32_t, Connector*>::iterator connection = _connectionMap.find(ID);
 
         if (connection != _connectionMap.end()) {
-            result = connection->second->ChannelReceive(data, length);
+            connector = connection->second;
+            connector->Enter();
+        }
+
+        _adminLock.Unlock();
+
+        if (connector != nullptr) {
+            result = connector->ChannelReceive(data, length);
+            connector->Leave();
         }
 
         return (result);
@@ -325,17 +353,102 @@ namespace Plugin {
     {
         uint32_t result = 0;
 
-        // See if we can forward this info..
+        Connector* connector = nullptr;
+
+        // Only the lookup needs the plugin lock, the data moves through the rings of the connector.
+        _adminLock.Lock();
+
         std::map<const uint32_t, Connector*>::const_iterator connection = _connectionMap.find(ID);
 
         if (connection != _connectionMap.end()) {
-            result = connection->second->ChannelSend(data, length);
+            connector = connection->second;
+            connector->Enter();
+        }
+
+        _adminLock.Unlock();
+
+        if (connector != nullptr) {
+            result = connector->ChannelSend(data, length);
+            connector->Leave();
+        }
+
+        return (result);
+    }
+
+    // Delete the detached connectors whose link has completely closed and that no channel thread is using
+    // anymore. Only detached connectors are on this list, so it stays short.
+    void WebProxy::Cleanup()
+    {
+        std::list<Connector*>::iterator index(_closing.begin());
+
+        while (index != _closing.end()) {
+            if ((*index)->IsClosed() == true) {
+                delete (*index);
+                index = _closing.erase(index);
+            } else {
+                index++;
+            }
+        }
+    }
+
+    // A channel for a configured link can take over a parked connector of that link, if it is still open.
+    // A connector that is still busy with a frame of its previous channel stays parked, nothing waits for it.
+    // Only channels of the connection map enter a connector, so a parked one that is idle stays idle.
+    WebProxy::Connector* WebProxy::Reuse(PluginHost::Channel& channel)
+    {
+        Connector* result = nullptr;
+
+        if ((channel.Query().empty() == true) && (channel.Name().empty() == false)) {
+            std::map<const string, std::list<Connector*>>::iterator pool(_pools.find(channel.Name()));
+
+            if (pool != _pools.end()) {
+                std::list<Connector*>::iterator index(pool->second.begin());
+
+                while ((result == nullptr) && (index != pool->second.end())) {
+                    Connector* connector = (*index);
+
+                    if (connector->IsOpen() == false) {
+                        connector->Detach();
+                        _closing.push_back(connector);
+                        index = pool->second.erase(index);
+                    } else if (connector->IsBusy() == true) {
+                        index++;
+                    } else {
+                        result = connector;
+                        pool->second.erase(index);
+                    }
+                }
+
+                if (result != nullptr) {
+                    const Config::Link& linkInfo(_linkInfo.find(channel.Name())->second);
+
+                    if ((linkInfo.Text.IsSet() == true) && (linkInfo.Text.Value() == true)) {
+                        channel.Binary(false);
+                    }
+
+                    result->Rebind(channel);
+                }
+            }
         }
 
         return (result);
     }
 
-    WebProxy::Connector* WebProxy::CreateConnector(PluginHost::Channel& channel) const
+    // The channel is gone. Park the connector if its link keeps a pool with room left, otherwise close it.
+    void WebProxy::Release(Connector* connector)
+    {
+        std::map<const string, std::list<Connector*>>::iterator pool(_pools.find(connector->Name()));
+
+        if ((pool != _pools.end()) && (connector->IsOpen() == true) && (pool->second.size() < _linkInfo.find(connector->Name())->second.Pool.Value())) {
+            connector->Park();
+            pool->second.push_back(connector);
+        } else {
+            connector->Detach();
+            _closing.push_back(connector);
+        }
+    }
+
+    WebProxy::Connector* WebProxy::CreateConnector(PluginHost::Channel& channel)
     {
         Core::TextFragment host;
         Core::TextFragment device;
@@ -346,8 +459,11 @@ namespace Plugin {
         Core::SerialPort::StopBits stopBits(Core::SerialPort::StopBits::BITS_1);
         Core::SerialPort::FlowControl flowControl(Core::SerialPort::FlowControl::OFF);
         const string& options(channel.Query());
+        string name;
+        Statistics* statistics(&_unnamed);
         bool datagram(false);
         bool text(false);
+        uint32_t linkBuffer(DefaultBufferSize);
 
         if (options.empty() == false) {
             Core::TextSegmentIterator index(Core::TextFragment(options), true, '&');
@@ -374,12 +490,19 @@ namespace Plugin {
             if (index != _linkInfo.end()) {
                 const Config::Link& linkInfo(index->second);
 
+                name = index->first;
+                statistics = &(_statistics.find(name)->second);
+
                 // Seems like we have a valid entry, get the config.
                 text = ((linkInfo.Text.IsSet() == true) && (linkInfo.Text.Value() == true));
                 host = Core::TextFragment(linkInfo.Host.Value());
                 device = Core::TextFragment(linkInfo.Device.Value());
                 datagram = ((linkInfo.Type.IsSet() == true) && (linkInfo.Type.Value() == Config::Link::UDP));
 
+                if ((linkInfo.Buffer.IsSet() == true) && (linkInfo.Buffer.Value() != 0)) {
+                    linkBuffer = linkInfo.Buffer.Value();
+                }
+
                 if (linkInfo.Configuration.IsSet() == true) {
                     const Config::Link::Settings& configInfo(linkInfo.Configuration);
 
@@ -395,12 +518,12 @@ namespace Plugin {
             Core::NodeId remote(host.Text().c_str());
 
             if (datagram == true) {
-                result = new ConnectorWrapper<DatagramChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<DatagramChannel>(channel, name, *statistics, linkBuffer, true, 1024, remote);
             } else {
-                result = new ConnectorWrapper<StreamChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<StreamChannel>(channel, name, *statistics, linkBuffer, false, 1024, remote);
             }
         } else if ((device.Length() > 0) && (host.Length() == 0)) {
-            result = new ConnectorWrapper<DeviceChannel>(channel, 1024, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
+            result = new ConnectorWrapper<DeviceChannel>(channel, name, *statistics, linkBuffer, 1024, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
         }
 
         if ((result != nullptr) && (text == true)) {
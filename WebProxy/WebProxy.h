@@ -25,24 +25,255 @@
 namespace WPEFramework {
 namespace Plugin {
 
-    class WebProxy : public PluginHost::IPluginExtended, public PluginHost::IChannel {
+    class WebProxy : public PluginHost::IPluginExtended, public PluginHost::IChannel, public PluginHost::JSONRPC {
     private:
         WebProxy(const WebProxy&) = delete;
         WebProxy& operator=(const WebProxy&) = delete;
 
     public:
+        // Single producer, single consumer ring buffer. One side only moves the head, the other side only
+        // moves the tail, so no lock is needed. The capacity is rounded up to a power of two.
+        class RingBuffer {
+        private:
+            RingBuffer() = delete;
+            RingBuffer(const RingBuffer&) = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+        public:
+            RingBuffer(const uint32_t size)
+                : _mask(Capacity(size) - 1)
+                , _buffer(new uint8_t[_mask + 1])
+                , _head(0)
+                , _tail(0)
+            {
+            }
+            ~RingBuffer()
+            {
+                delete[] _buffer;
+            }
+
+        public:
+            inline uint32_t Size() const
+            {
+                return (_mask + 1);
+            }
+            inline bool IsEmpty() const
+            {
+                return (_head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire));
+            }
+            inline uint32_t Used() const
+            {
+                return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire));
+            }
+            inline uint32_t Free() const
+            {
+                return (Size() - Used());
+            }
+            // Producer side, returns the number of bytes that fitted.
+            uint16_t Write(const uint8_t data[], const uint16_t length)
+            {
+                const uint32_t head = _head.load(std::memory_order_relaxed);
+                const uint32_t tail = _tail.load(std::memory_order_acquire);
+                const uint32_t size = std::min(static_cast<uint32_t>(length), Size() - (head - tail));
+                const uint32_t offset = (head & _mask);
+                const uint32_t first = std::min(size, Size() - offset);
+
+                ::memcpy(&(_buffer[offset]), data, first);
+                ::memcpy(_buffer, &(data[first]), size - first);
+
+                _head.store(head + size, std::memory_order_release);
+
+                return (static_cast<uint16_t>(size));
+            }
+            // Consumer side, returns the number of bytes read.
+            uint16_t Read(uint8_t data[], const uint16_t length)
+            {
+                const uint32_t tail = _tail.load(std::memory_order_relaxed);
+                const uint32_t head = _head.load(std::memory_order_acquire);
+                const uint32_t size = std::min(static_cast<uint32_t>(length), head - tail);
+                const uint32_t offset = (tail & _mask);
+                const uint32_t first = std::min(size, Size() - offset);
+
+                ::memcpy(data, &(_buffer[offset]), first);
+                ::memcpy(&(data[first]), _buffer, size - first);
+
+                _tail.store(tail + size, std::memory_order_release);
+
+                return (static_cast<uint16_t>(size));
+            }
+
+        private:
+            static uint32_t Capacity(const uint32_t size)
+            {
+                uint32_t result = 64;
+
+                while (result < size) {
+                    result <<= 1;
+                }
+
+                return (result);
+            }
+
+        private:
+            const uint32_t _mask;
+            uint8_t* _buffer;
+            std::atomic<uint32_t> _head;
+            std::atomic<uint32_t> _tail;
+        };
+
+        // Counters for all connectors of one configured link. They are updated from the socket and channel
+        // threads, so all of them are atomic.
+        class Statistics {
+        private:
+            Statistics(const Statistics&) = delete;
+            Statistics& operator=(const Statistics&) = delete;
+
+        public:
+            Statistics()
+                : _sent(0)
+                , _received(0)
+                , _sendHighWater(0)
+                , _receiveHighWater(0)
+                , _drops(0)
+                , _connects(0)
+                , _reuses(0)
+                , _connectTime(0)
+                , _connectMax(0)
+            {
+            }
+            ~Statistics()
+            {
+            }
+
+        public:
+            inline void Sent(const uint32_t bytes)
+            {
+                _sent.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            inline void Received(const uint32_t bytes)
+            {
+                _received.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            inline void SendQueue(const uint32_t pending)
+            {
+                HighWater(_sendHighWater, pending);
+            }
+            inline void ReceiveQueue(const uint32_t pending)
+            {
+                HighWater(_receiveHighWater, pending);
+            }
+            inline void Dropped(const uint32_t bytes)
+            {
+                _drops.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            inline void Connected(const uint64_t duration)
+            {
+                _connects.fetch_add(1, std::memory_order_relaxed);
+                _connectTime.fetch_add(duration, std::memory_order_relaxed);
+                HighWater(_connectMax, duration);
+            }
+            inline void Reused()
+            {
+                _reuses.fetch_add(1, std::memory_order_relaxed);
+            }
+            inline uint64_t SentBytes() const
+            {
+                return (_sent.load(std::memory_order_relaxed));
+            }
+            inline uint64_t ReceivedBytes() const
+            {
+                return (_received.load(std::memory_order_relaxed));
+            }
+            inline uint32_t SendHighWater() const
+            {
+                return (static_cast<uint32_t>(_sendHighWater.load(std::memory_order_relaxed)));
+            }
+            inline uint32_t ReceiveHighWater() const
+            {
+                return (static_cast<uint32_t>(_receiveHighWater.load(std::memory_order_relaxed)));
+            }
+            inline uint64_t Drops() const
+            {
+                return (_drops.load(std::memory_order_relaxed));
+            }
+            inline uint32_t Connects() const
+            {
+                return (_connects.load(std::memory_order_relaxed));
+            }
+            inline uint32_t Reuses() const
+            {
+                return (_reuses.load(std::memory_order_relaxed));
+            }
+            // Average and worst connect latency in microseconds.
+            inline uint64_t ConnectTime() const
+            {
+                const uint32_t connects = _connects.load(std::memory_order_relaxed);
+
+                return (connects == 0 ? 0 : (_connectTime.load(std::memory_order_relaxed) / connects));
+            }
+            inline uint64_t ConnectMax() const
+            {
+                return (_connectMax.load(std::memory_order_relaxed));
+            }
+
+        private:
+            static void HighWater(std::atomic<uint64_t>& mark, const uint64_t value)
+            {
+                uint64_t current = mark.load(std::memory_order_relaxed);
+
+                while ((value > current) && (mark.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)) {
+                }
+            }
+
+        private:
+            std::atomic<uint64_t> _sent;
+            std::atomic<uint64_t> _received;
+            std::atomic<uint64_t> _sendHighWater;
+            std::atomic<uint64_t> _receiveHighWater;
+            std::atomic<uint64_t> _drops;
+            std::atomic<uint32_t> _connects;
+            std::atomic<uint32_t> _reuses;
+            std::atomic<uint64_t> _connectTime;
+            std::atomic<uint64_t> _connectMax;
+        };
+
+        // The Connector glues a websocket channel to a socket or serial port. Each direction has exactly one
+        // producer and one consumer, so data moves through lock-free rings. The lock only protects the
+        // channel pointer, which is needed to wake up the other side.
+        //
+        // If the ring towards the channel is full, the rest of a stream or serial port is held back by the
+        // connector, up to the size of the ring. The channel triggers the link once it freed up room, which
+        // runs SendData on the link thread, where the held back data is delivered again. Only if that is full
+        // as well, the data is not consumed and the sender gets throttled in the link buffers. A datagram that
+        // does not fit as a whole is dropped. Towards the link, data that does not fit stays with the channel.
+        //
+        // A connector for a configured link can be parked when its channel goes away. The link stays open, so the
+        // next channel for that link can be rebound to it without reconnecting. Data from the remote side is
+        // dropped while the connector is parked.
         class Connector {
         private:
             Connector(const Connector&) = delete;
             Connector& operator=(const Connector&) = delete;
 
         public:
-            Connector(PluginHost::Channel& channel, Core::IStream* link)
+            Connector(PluginHost::Channel& channel, Core::IStream* link, const string& name, Statistics& statistics, const uint32_t bufferSize, const bool datagram)
                 : _link(link)
                 , _channel(&channel)
                 , _adminLock()
-                , _channelBuffer()
-                , _socketBuffer()
+                , _name(name)
+                , _statistics(statistics)
+                , _datagram(datagram)
+                , _channelBuffer(bufferSize)
+                , _socketBuffer(bufferSize)
+                , _channelArmed(false)
+                , _socketArmed(false)
+                , _channelStalled(false)
+                , _discard(false)
+                , _backlog()
+                , _backlogOffset(0)
+                , _attached(true)
+                , _opening(0)
+                , _users(0)
             {
             }
             virtual ~Connector()
@@ -67,66 +298,117 @@ namespace Plugin {
             {
                 return (_link->RemoteId());
             }
+            // Name of the configured link, empty if the connector was created from the query string.
+            inline const string& Name() const
+            {
+                return (_name);
+            }
+            inline bool IsOpen() const
+            {
+                return (_link->IsOpen());
+            }
             inline bool IsClosed() const
             {
-                return ((_channel == nullptr) && (_link->IsClosed()));
+                return ((_channel == nullptr) && (_link->IsClosed()) && (_users.load() == 0));
+            }
+            // A channel thread moving data through this connector. As long as there is one, it is not deleted.
+            inline void Enter() const
+            {
+                _users.fetch_add(1);
+            }
+            inline void Leave() const
+            {
+                _users.fetch_sub(1);
+            }
+            inline bool IsBusy() const
+            {
+                return (_users.load() != 0);
             }
             // Methods to extract and insert data into the socket buffers
             uint16_t SendData(uint8_t* dataFrame, const uint16_t maxSendSize)
             {
-                _adminLock.Lock();
+                if (Redeliver() != 0) {
+                    Arm();
+                }
 
                 uint16_t result = _socketBuffer.Read(dataFrame, maxSendSize);
 
-                _adminLock.Unlock();
+                if (result != 0) {
+                    _statistics.Sent(result);
+                }
+
+                if (result < maxSendSize) {
+                    Drained(_socketBuffer, _socketArmed);
+                }
 
                 return (result);
             }
 
             uint16_t ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
             {
-                _adminLock.Lock();
+                uint16_t result = 0;
 
-                bool wasEmpty = _channelBuffer.IsEmpty();
+                // What was held back goes first, to keep the order.
+                Redeliver();
 
-                uint16_t result = _channelBuffer.Write(dataFrame, receivedSize);
+                if ((_attached.load() == false) || ((_datagram == true) && (_channelBuffer.Free() < receivedSize))) {
+                    // Nobody is listening or the datagram does not fit, drop it.
+                    _statistics.Dropped(receivedSize);
+                } else {
+                    if (_backlogOffset == _backlog.size()) {
+                        result = _channelBuffer.Write(dataFrame, receivedSize);
+                    }
 
-                if (wasEmpty == true) {
-                    // This is new data, there was nothing pending, trigger a request for a frambuffer.
-                    _channel->RequestOutbound();
+                    if (result < receivedSize) {
+                        // Hold back what did not fit, as far as there is room for it. What is left after that
+                        // stays in the link buffer.
+                        const uint32_t held = static_cast<uint32_t>(_backlog.size() - _backlogOffset);
+                        const uint16_t size = static_cast<uint16_t>(std::min(static_cast<uint32_t>(receivedSize - result), (held < _channelBuffer.Size() ? _channelBuffer.Size() - held : 0)));
+
+                        _backlog.insert(_backlog.end(), &(dataFrame[result]), &(dataFrame[result + size]));
+                        result += size;
+
+                        Stalled();
+                    }
+
+                    _statistics.Received(result);
+                    _statistics.ReceiveQueue(_channelBuffer.Used() + static_cast<uint32_t>(_backlog.size() - _backlogOffset));
                 }
 
-                _adminLock.Unlock();
+                if (result != 0) {
+                    Arm();
+                }
 
-                return (result);
+                return (((_datagram == true) || (_attached.load() == false)) ? receivedSize : result);
             }
 
             uint16_t ChannelSend(uint8_t* dataFrame, const uint16_t maxSendSize) const
             {
-                _adminLock.Lock();
-
                 uint16_t result = _channelBuffer.Read(dataFrame, maxSendSize);
 
-                _adminLock.Unlock();
+                if ((result != 0) && (_channelStalled.exchange(false) == true)) {
+                    // There is room again, the SendData the link runs delivers what was held back.
+                    _link->Trigger();
+                }
+
+                if (result < maxSendSize) {
+                    Drained(_channelBuffer, _channelArmed);
+                }
 
                 return (result);
             }
 
             uint16_t ChannelReceive(const uint8_t* dataFrame, const uint16_t receivedSize)
             {
-                _adminLock.Lock();
-
-                bool wasEmpty = _socketBuffer.IsEmpty();
-
                 uint16_t result = _socketBuffer.Write(dataFrame, receivedSize);
 
-                if (wasEmpty == true) {
+                _statistics.SendQueue(_socketBuffer.Used());
+
+                if ((result != 0) && (_socketArmed.exchange(true) == false)) {
                     // This is new data, there was nothing pending, trigger a request for a frambuffer.
                     _link->Trigger();
                 }
 
-                _adminLock.Unlock();
-
                 return (result);
             }
 
@@ -134,6 +416,12 @@ namespace Plugin {
             void StateChange()
             {
                 if (_link->IsOpen() == true) {
+                    const uint64_t opening = _opening.exchange(0);
+
+                    if (opening != 0) {
+                        _statistics.Connected(Core::Time::Now().Ticks() - opening);
+                    }
+
                     TRACE(Trace::Information, (_T("Proxy connection for channel ID [%d] is Open"), Id()));
                 } else if (IsClosed() == true) {
                     TRACE(Trace::Information, (_T("Proxy connection for channel ID [%d] is Closed"), Id()));
@@ -145,6 +433,7 @@ namespace Plugin {
             inline void Attach()
             {
                 _adminLock.Lock();
+                _opening = Core::Time::Now().Ticks();
                 _link->Open(0);
                 _adminLock.Unlock();
             }
@@ -152,17 +441,141 @@ namespace Plugin {
             inline void Detach()
             {
                 _adminLock.Lock();
+                _attached = false;
                 _channel = nullptr;
                 _link->Close(0);
                 _adminLock.Unlock();
             }
 
+            // Wait till the link is closed, after this the link does not call back anymore.
+            inline void Close()
+            {
+                _link->Close(Core::infinite);
+            }
+
+            // Release the channel, but keep the link open for a next channel.
+            inline void Park()
+            {
+                _adminLock.Lock();
+                _attached = false;
+                _channel = nullptr;
+                _adminLock.Unlock();
+
+                // What was held back for this channel is stale, the link thread drops it.
+                _discard = true;
+                _channelStalled = false;
+                _link->Trigger();
+            }
+
+            // Hand a parked connector to a new channel. Whatever the previous channel left unread is stale.
+            // Nothing is written to the channel buffer while parked and a connector that is still busy with a
+            // frame of the previous channel is not rebound, so we are the only one touching it here.
+            void Rebind(PluginHost::Channel& channel)
+            {
+                uint8_t scratch[256];
+
+                ASSERT(IsBusy() == false);
+
+                while (_channelBuffer.Read(scratch, sizeof(scratch)) != 0) {
+                }
+                _channelArmed = false;
+
+                _adminLock.Lock();
+                _channel = &channel;
+                _attached = true;
+                _adminLock.Unlock();
+
+                _statistics.Reused();
+            }
+
+        private:
+            // New data in the channel buffer, if there was nothing pending, request a frame buffer for it.
+            void Arm()
+            {
+                if (_channelArmed.exchange(true) == false) {
+                    _adminLock.Lock();
+
+                    if (_channel != nullptr) {
+                        _channel->RequestOutbound();
+                    }
+
+                    _adminLock.Unlock();
+                }
+            }
+            // Moves held back data into the channel buffer. Link thread only, it is the producer of that buffer
+            // and the only one touching the backlog. If data is left, the channel triggers the link once it made
+            // room. If it made room before the stall got flagged, nobody will, so Stalled() does it itself.
+            uint16_t Redeliver()
+            {
+                uint16_t result = 0;
+
+                if ((_discard.exchange(false) == true) || (_attached.load() == false)) {
+                    if (_backlogOffset != _backlog.size()) {
+                        _statistics.Dropped(static_cast<uint32_t>(_backlog.size() - _backlogOffset));
+                        _backlog.clear();
+                        _backlogOffset = 0;
+                    }
+                } else if (_backlogOffset != _backlog.size()) {
+                    result = _channelBuffer.Write(&(_backlog[_backlogOffset]), static_cast<uint16_t>(std::min(_backlog.size() - _backlogOffset, static_cast<size_t>(0xFFFF))));
+                    _backlogOffset += result;
+
+                    if (_backlogOffset == _backlog.size()) {
+                        _backlog.clear();
+                        _backlogOffset = 0;
+                    } else {
+                        Stalled();
+                    }
+                }
+
+                return (result);
+            }
+            void Stalled()
+            {
+                _channelStalled.store(true);
+
+                if ((_channelBuffer.Free() != 0) && (_channelStalled.exchange(false) == true)) {
+                    _link->Trigger();
+                }
+            }
+            // The consumer ran dry. Disarm, so the producer wakes us up on the next write. If the producer slipped
+            // in data before we disarmed, it did not wake us up, so do that ourselves.
+            void Drained(RingBuffer& buffer, std::atomic<bool>& armed) const
+            {
+                armed.store(false);
+
+                if ((buffer.IsEmpty() == false) && (armed.exchange(true) == false)) {
+                    if (&armed == &_socketArmed) {
+                        _link->Trigger();
+                    } else {
+                        _adminLock.Lock();
+
+                        if (_channel != nullptr) {
+                            _channel->RequestOutbound();
+                        }
+
+                        _adminLock.Unlock();
+                    }
+                }
+            }
+
         private:
             Core::IStream* _link;
             PluginHost::Channel* _channel;
             mutable Core::CriticalSection _adminLock;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _channelBuffer;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _socketBuffer;
+            const string _name;
+            Statistics& _statistics;
+            const bool _datagram;
+            mutable RingBuffer _channelBuffer;
+            mutable RingBuffer _socketBuffer;
+            mutable std::atomic<bool> _channelArmed;
+            mutable std::atomic<bool> _socketArmed;
+            mutable std::atomic<bool> _channelStalled;
+            std::atomic<bool> _discard;
+            std::vector<uint8_t> _backlog;
+            size_t _backlogOffset;
+            std::atomic<bool> _attached;
+            std::atomic<uint64_t> _opening;
+            mutable std::atomic<uint32_t> _users;
         };
         class Config : public Core::JSON::Container {
         public:
@@ -236,6 +649,7 @@ namespace Plugin {
             public:
                 Link()
                     : Core::JSON::Container()
+                    , Pool(0)
                 {
                     Add(_T("name"), &Name);
                     Add(_T("type"), &Type);
@@ -243,9 +657,12 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("buffer"), &Buffer);
+                    Add(_T("pool"), &Pool);
                 }
                 Link(const string& name, const enumType type, const bool text, const string host)
                     : Core::JSON::Container()
+                    , Pool(0)
                 {
                     Add(_T("name"), &Name);
                     Add(_T("type"), &Type);
@@ -253,6 +670,8 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("buffer"), &Buffer);
+                    Add(_T("pool"), &Pool);
 
                     Name = name;
                     Type = type;
@@ -264,6 +683,7 @@ namespace Plugin {
                 }
                 Link(const string& name, const enumType type, const bool text, const string device, const uint32_t baudRate, const Core::SerialPort::Parity parity, const uint8_t bits, const uint8_t stopbits)
                     : Core::JSON::Container()
+                    , Pool(0)
                 {
                     Add(_T("name"), &Name);
                     Add(_T("type"), &Type);
@@ -271,6 +691,8 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("buffer"), &Buffer);
+                    Add(_T("pool"), &Pool);
 
                     Name = name;
                     Type = type;
@@ -289,6 +711,8 @@ namespace Plugin {
                     , Host(copy.Host)
                     , Device(copy.Device)
                     , Configuration(copy.Configuration)
+                    , Buffer(copy.Buffer)
+                    , Pool(copy.Pool)
                 {
                     Add(_T("name"), &Name);
                     Add(_T("type"), &Type);
@@ -296,6 +720,8 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("buffer"), &Buffer);
+                    Add(_T("pool"), &Pool);
                 }
                 ~Link()
                 {
@@ -308,6 +734,10 @@ namespace Plugin {
                 Core::JSON::String Host;
                 Core::JSON::String Device;
                 Settings Configuration;
+                // Size in bytes of the buffer in each direction.
+                Core::JSON::DecUInt32 Buffer;
+                // Number of idle connectors kept open for reuse. Opt-in, the default 0 closes the link with its channel.
+                Core::JSON::DecUInt8 Pool;
             };
 
         private:
@@ -331,19 +761,113 @@ namespace Plugin {
             Core::JSON::ArrayType<Link> Links;
         };
 
+        // Value of the statistics property, as specified in WebProxyPlugin.json.
+        class LinkData : public Core::JSON::Container {
+        public:
+            LinkData()
+                : Core::JSON::Container()
+            {
+                Add(_T("name"), &Name);
+                Add(_T("connections"), &Connections);
+                Add(_T("pooled"), &Pooled);
+                Add(_T("sent"), &Sent);
+                Add(_T("received"), &Received);
+                Add(_T("sendhighwater"), &SendHighWater);
+                Add(_T("receivehighwater"), &ReceiveHighWater);
+                Add(_T("drops"), &Drops);
+                Add(_T("connects"), &Connects);
+                Add(_T("reuses"), &Reuses);
+                Add(_T("connecttime"), &ConnectTime);
+                Add(_T("connectmax"), &ConnectMax);
+            }
+            LinkData(const LinkData& copy)
+                : Core::JSON::Container()
+                , Name(copy.Name)
+                , Connections(copy.Connections)
+                , Pooled(copy.Pooled)
+                , Sent(copy.Sent)
+                , Received(copy.Received)
+                , SendHighWater(copy.SendHighWater)
+                , ReceiveHighWater(copy.ReceiveHighWater)
+                , Drops(copy.Drops)
+                , Connects(copy.Connects)
+                , Reuses(copy.Reuses)
+                , ConnectTime(copy.ConnectTime)
+                , ConnectMax(copy.ConnectMax)
+            {
+                Add(_T("name"), &Name);
+                Add(_T("connections"), &Connections);
+                Add(_T("pooled"), &Pooled);
+                Add(_T("sent"), &Sent);
+                Add(_T("received"), &Received);
+                Add(_T("sendhighwater"), &SendHighWater);
+                Add(_T("receivehighwater"), &ReceiveHighWater);
+                Add(_T("drops"), &Drops);
+                Add(_T("connects"), &Connects);
+                Add(_T("reuses"), &Reuses);
+                Add(_T("connecttime"), &ConnectTime);
+                Add(_T("connectmax"), &ConnectMax);
+            }
+            ~LinkData()
+            {
+            }
+
+        public:
+            Core::JSON::String Name;
+            Core::JSON::DecUInt16 Connections; // Connectors in use by a channel
+            Core::JSON::DecUInt16 Pooled; // Connectors parked for reuse
+            Core::JSON::DecUInt64 Sent; // Bytes sent to the remote side
+            Core::JSON::DecUInt64 Received; // Bytes received from the remote side
+            Core::JSON::DecUInt32 SendHighWater; // Highest fill level in bytes of the buffer towards the remote side
+            Core::JSON::DecUInt32 ReceiveHighWater; // Highest fill level in bytes of the buffer towards the channel
+            Core::JSON::DecUInt64 Drops; // Bytes from the remote side that were dropped
+            Core::JSON::DecUInt32 Connects; // Connections set up
+            Core::JSON::DecUInt32 Reuses; // Parked connectors handed to a new channel
+            Core::JSON::DecUInt64 ConnectTime; // Average connect time in microseconds
+            Core::JSON::DecUInt64 ConnectMax; // Worst connect time in microseconds
+        };
+
     public:
         WebProxy()
-            : _connectionMap()
+            : _adminLock()
+            , _connectionMap()
+            , _pools()
+            , _closing()
+            , _statistics()
+            , _unnamed()
         {
+            RegisterAll();
         }
         virtual ~WebProxy()
         {
+            UnregisterAll();
+
+            // No channel will come back to detach, so close and delete whatever is left.
+            for (std::pair<const uint32_t, Connector*>& connection : _connectionMap) {
+                connection.second->Detach();
+                _closing.push_back(connection.second);
+            }
+            for (std::pair<const string, std::list<Connector*>>& pool : _pools) {
+                for (Connector* connector : pool.second) {
+                    connector->Detach();
+                    _closing.push_back(connector);
+                }
+            }
+            for (Connector* connector : _closing) {
+                connector->Close();
+                delete connector;
+            }
+
+            _connectionMap.clear();
+            _pools.clear();
+            _closing.clear();
         }
 
         BEGIN_INTERFACE_MAP(WebProxy)
         INTERFACE_ENTRY(PluginHost::IPlugin)
         INTERFACE_ENTRY(PluginHost::IPluginExtended)
         INTERFACE_ENTRY(PluginHost::IChannel)
+        INTERFACE_ENTRY(PluginHost::IDispatcher)
         END_INTERFACE_MAP
 
     public:
@@ -384,13 +908,28 @@ namespace Plugin {
         virtual uint32_t Outbound(const uint32_t ID, uint8_t data[], const uint16_t length) const;
 
     private:
-        Connector* CreateConnector(PluginHost::Channel& channel) const;
+        static constexpr uint32_t DefaultBufferSize = 8192;
+
+        Connector* CreateConnector(PluginHost::Channel& channel);
+        Connector* Reuse(PluginHost::Channel& channel);
+        void Release(Connector* connector);
+        void Cleanup();
+
+        // JsonRpc
+        void RegisterAll();
+        void UnregisterAll();
+        uint32_t get_statistics(Core::JSON::ArrayType<LinkData>& response) const;
 
     private:
         string _prefix;
         uint32_t _maxConnections;
+        mutable Core::CriticalSection _adminLock;
         std::map<const uint32_t, Connector*> _connectionMap;
         std::map<const string, Config::Link> _linkInfo;
+        std::map<const string, std::list<Connector*>> _pools;
+        std::list<Connector*> _closing;
+        std::map<const string, Statistics> _statistics;
+        Statistics _unnamed;
     };
 }
 }
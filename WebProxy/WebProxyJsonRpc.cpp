@@ -0,0 +1,80 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Module.h"
+#include "WebProxy.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Registration
+    //
+
+    void WebProxy::RegisterAll()
+    {
+        Property<Core::JSON::ArrayType<LinkData>>(_T("statistics"), &WebProxy::get_statistics, nullptr, this);
+    }
+
+    void WebProxy::UnregisterAll()
+    {
+        Unregister(_T("statistics"));
+    }
+
+    // API implementation
+    //
+
+    // Property: statistics - Traffic and connection counters per configured link
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t WebProxy::get_statistics(Core::JSON::ArrayType<LinkData>& response) const
+    {
+        _adminLock.Lock();
+
+        for (const std::pair<const string, Statistics>& entry : _statistics) {
+            LinkData& data(response.Add());
+            const Statistics& statistics(entry.second);
+            uint16_t connections = 0;
+
+            for (const std::pair<const uint32_t, Connector*>& connection : _connectionMap) {
+                if (connection.second->Name() == entry.first) {
+                    connections++;
+                }
+            }
+
+            data.Name = entry.first;
+            data.Connections = connections;
+            data.Pooled = static_cast<uint16_t>(_pools.find(entry.first)->second.size());
+            data.Sent = statistics.SentBytes();
+            data.Received = statistics.ReceivedBytes();
+            data.SendHighWater = statistics.SendHighWater();
+            data.ReceiveHighWater = statistics.ReceiveHighWater();
+            data.Drops = statistics.Drops();
+            data.Connects = statistics.Connects();
+            data.Reuses = statistics.Reuses();
+            data.ConnectTime = statistics.ConnectTime();
+            data.ConnectMax = statistics.ConnectMax();
+        }
+
+        _adminLock.Unlock();
+
+        return (Core::ERROR_NONE);
+    }
+
+} // namespace Plugin
+}
@@ -21,6 +21,12 @@
 #include <interfaces/IMemory.h>
 #include <interfaces/IWebServer.h>
 
+#ifndef __WINDOWS__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#endif
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -91,6 +97,30 @@ namespace Plugin {
             Config& operator=(const Config&) = delete;
 
         public:
+            class Cache : public Core::JSON::Container {
+            private:
+                Cache(const Cache&) = delete;
+                Cache& operator=(const Cache&) = delete;
+
+            public:
+                Cache()
+                    : Core::JSON::Container()
+                    , Size(0)
+                    , Entry(256)
+                {
+                    Add(_T("size"), &Size);
+                    Add(_T("entry"), &Entry);
+                }
+                ~Cache()
+                {
+                }
+
+            public:
+                // Both expressed in KB. A Size of 0 disables the content cache.
+                Core::JSON::DecUInt32 Size;
+                Core::JSON::DecUInt32 Entry;
+            };
+
             class Proxy : public Core::JSON::Container {
             private:
                 Proxy& operator=(const Proxy&) = delete;
@@ -101,20 +131,32 @@ namespace Plugin {
                     , Path()
                     , Subst()
                     , Server()
+                    , Connections(1)
+                    , Pipeline(1)
+                    , Timeout(0)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
+                    Add(_T("timeout"), &Timeout);
                 }
                 Proxy(const Proxy& copy)
                     : Core::JSON::Container()
                     , Path(copy.Path)
                     , Subst(copy.Subst)
                     , Server(copy.Server)
+                    , Connections(copy.Connections)
+                    , Pipeline(copy.Pipeline)
+                    , Timeout(copy.Timeout)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
+                    Add(_T("timeout"), &Timeout);
                 }
                 virtual ~Proxy()
                 {
@@ -124,6 +166,11 @@ namespace Plugin {
                 Core::JSON::String Path;
                 Core::JSON::String Subst;
                 Core::JSON::String Server;
+                // Maximum number of links to the server and requests in flight per link.
+                Core::JSON::DecUInt8 Connections;
+                Core::JSON::DecUInt8 Pipeline;
+                // Time in ms a request may take before it is answered with a 504, 0 is forever.
+                Core::JSON::DecUInt32 Timeout;
             };
 
         public:
@@ -134,6 +181,14 @@ namespace Plugin {
                 , Interface()
                 , Path(_T("www"))
                 , IdleTime(180)
+                , SendBuffer(1024)
+                , ReceiveBuffer(1024)
+                , MappedSize(0)
+                , Precompressed(true)
+                , Statistics()
+                , HeaderTime(0)
+                , BodyTime(0)
+                , MaxConnections(0)
             {
                 Add(_T("port"), &Port);
                 Add(_T("binding"), &Binding);
@@ -141,6 +196,15 @@ namespace Plugin {
                 Add(_T("path"), &Path);
                 Add(_T("idletime"), &IdleTime);
                 Add(_T("proxies"), &Proxies);
+                Add(_T("cache"), &ContentCache);
+                Add(_T("sendbuffer"), &SendBuffer);
+                Add(_T("receivebuffer"), &ReceiveBuffer);
+                Add(_T("mappedsize"), &MappedSize);
+                Add(_T("precompressed"), &Precompressed);
+                Add(_T("statistics"), &Statistics);
+                Add(_T("headertime"), &HeaderTime);
+                Add(_T("bodytime"), &BodyTime);
+                Add(_T("maxconnections"), &MaxConnections);
             }
             ~Config()
             {
@@ -153,6 +217,21 @@ namespace Plugin {
             Core::JSON::String Path;
             Core::JSON::DecUInt16 IdleTime;
             Core::JSON::ArrayType<Proxy> Proxies;
+            Cache ContentCache;
+            Core::JSON::DecUInt16 SendBuffer;
+            Core::JSON::DecUInt16 ReceiveBuffer;
+            // Files of at least this size (in KB) are sent from a memory mapping. 0 disables it.
+            Core::JSON::DecUInt32 MappedSize;
+            // Serve a .br or .gz sibling of the requested file if the client accepts that encoding.
+            Core::JSON::Boolean Precompressed;
+            // Path on which the proxy route statistics are served. They are not protected, so this is off
+            // unless a path is configured.
+            Core::JSON::String Statistics;
+            // Time in seconds a client gets to deliver a request header and body, if 0 the idle time applies.
+            Core::JSON::DecUInt16 HeaderTime;
+            Core::JSON::DecUInt16 BodyTime;
+            // Maximum number of concurrent connections, the longest idle one is dropped to make room. 0 is unlimited.
+            Core::JSON::DecUInt16 MaxConnections;
         };
 
         class RequestFactory {
@@ -197,233 +276,1650 @@ namespace Plugin {
             }
         };
 
-        // IMPORTANT NOTE:
-        // There is no need to lock/unlock usage on this server as all action->response senarious take place on
-        // the communication thread from the SoketPortMonitor. There is only 1 such thread per process.
-        // Given this, make sure that all actions done by the ProxyMap are deterministic and short <100ms as it
-        // upholds all other network traffic.
-        class ProxyMap {
-        private:
-            class OutgoingChannel : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
+        // The FileCache keeps the content of recently served static files in memory, keyed by the normalized
+        // request path. It is bounded by a byte budget and evicts the least recently used entries once that
+        // budget is exceeded. All directories that hold a cached file are watched through inotify, so any
+        // change on disk drops the related entries and the next request reloads them. Where there is no
+        // inotify, the modification time of the file is checked on every hit instead.
+        class FileCache : public Core::IResource {
+        public:
+            class Entry {
             private:
-                struct OutstandingMessage {
-                    Core::ProxyType<Web::Request> Request;
-                    uint32_t Id;
-                };
+                Entry() = delete;
+                Entry(const Entry&) = delete;
+                Entry& operator=(const Entry&) = delete;
 
             public:
-                OutgoingChannel() = delete;
-                OutgoingChannel(const OutgoingChannel&) = delete;
-                OutgoingChannel& operator=(const OutgoingChannel&) = delete;
-
-                OutgoingChannel(const string& path, const string& replacement, ProxyMap& proxyMap, const Core::NodeId& remoteId)
-                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(2, false, remoteId.AnyInterface(), remoteId, 1024, 1024)
-                    , _path(path)
-                    , _replacement(replacement)
-                    , _outstandingMessages()
-                    , _proxyMap(proxyMap)
+                Entry(const string& fileName, const Web::MIMETypes type, const Core::Time& modified, string&& content)
+                    : _fileName(fileName)
+                    , _type(type)
+                    , _modified(modified)
+                    , _eTag()
+                    , _content(std::move(content))
                 {
+                    // Size and modification time are both unique for a specific version of a file
+                    // as long as it is not changed within the second, good enough for a strong tag.
+                    _eTag = '"' + Core::NumberType<uint64_t, false, BASE_HEXADECIMAL>(_modified.Ticks()).Text() + '-' + Core::NumberType<uint32_t, false, BASE_HEXADECIMAL>(static_cast<uint32_t>(_content.length())).Text() + '"';
                 }
-                
-                ~OutgoingChannel() override {
-                    Close(Core::infinite);
+                ~Entry()
+                {
                 }
 
-                void ProxyRequest(Core::ProxyType<Web::Request>& request, uint32_t id)
+            public:
+                inline const string& FileName() const
+                {
+                    return (_fileName);
+                }
+                inline Web::MIMETypes Type() const
+                {
+                    return (_type);
+                }
+                inline const Core::Time& Modified() const
+                {
+                    return (_modified);
+                }
+                inline const string& ETag() const
+                {
+                    return (_eTag);
+                }
+                inline const uint8_t* Data() const
+                {
+                    return (reinterpret_cast<const uint8_t*>(_content.data()));
+                }
+                inline uint32_t Length() const
+                {
+                    return (static_cast<uint32_t>(_content.length()));
+                }
+                bool Matches(const string& ifNoneMatch) const
                 {
+                    // The If-None-Match header can carry a list of tags or a wildcard.
+                    return ((ifNoneMatch == _T("*")) || (ifNoneMatch.find(_eTag) != string::npos));
+                }
 
-                    OutstandingMessage message = { request, id };
+            private:
+                const string _fileName;
+                const Web::MIMETypes _type;
+                const Core::Time _modified;
+                string _eTag;
+                const string _content;
+            };
 
-                    _outstandingMessages.push_back(message);
+            // A body that serves straight out of a cached entry. The entry is reference counted so it survives
+            // an eviction or invalidation that happens while the response is still being sent.
+            class Body : public Web::IBody {
+            private:
+                Body() = delete;
+                Body(const Body&) = delete;
+                Body& operator=(const Body&) = delete;
 
-                    if (_outstandingMessages.size() == 1) {
-                        if (IsOpen() == false) {
-                            Open(0);
-                        } else {
-                            Submit(request);
-                        }
-                    }
+            public:
+                Body(const Core::ProxyType<Entry>& entry)
+                    : _entry(entry)
+                    , _offset(0)
+                    , _length(entry->Length())
+                    , _position(0)
+                {
+                }
+                ~Body() override
+                {
                 }
 
             public:
-                inline const string& Path() const
+                // Restrict the body to a slice of the content, used to serve a byte range.
+                void Range(const uint32_t offset, const uint32_t length)
                 {
-                    return (_path);
+                    ASSERT((offset + length) <= _entry->Length());
+
+                    _offset = offset;
+                    _length = length;
                 }
-                virtual void LinkBody(Core::ProxyType<Web::Response>& response)
+
+            private:
+                uint32_t Serialize() const override
                 {
-                    response->Body(_textBodies.Element());
+                    _position = 0;
+                    return (_length);
+                }
+                uint32_t Deserialize() override
+                {
+                    // Cached content is read only.
+                    ASSERT(false);
+                    return (0);
                 }
-                virtual void Send(const Core::ProxyType<Web::Request>& request)
+                void End() const override
                 {
-                    std::list<OutstandingMessage>::iterator index(_outstandingMessages.begin());
+                }
+                uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+                {
+                    uint32_t size = std::min(static_cast<uint32_t>(maxLength), _length - _position);
 
-                    while ((index != _outstandingMessages.end()) && (index->Request.IsValid() == false)) {
-                        index++;
+                    if (size > 0) {
+                        ::memcpy(stream, &(_entry->Data()[_offset + _position]), size);
+                        _position += size;
                     }
 
-                    ASSERT(index != _outstandingMessages.end());
-                    ASSERT(index->Request == request);
-
-                    index->Request.Release();
+                    return (static_cast<uint16_t>(size));
                 }
-                // Whenever there is a state change on the link, it is reported here.
-                virtual void StateChange()
+                uint16_t Deserialize(const uint8_t[], const uint16_t) override
                 {
-                    if (IsOpen() == true) {
-
-                        if (!_outstandingMessages.empty()) {
-                            Submit(_outstandingMessages.front().Request);
-                        }
-                    }
+                    ASSERT(false);
+                    return (0);
                 }
-                virtual void Received(Core::ProxyType<Web::Response>& response);
 
             private:
-                const string _path;
-                const string _replacement;
-
-                std::list<OutstandingMessage> _outstandingMessages;
-                ProxyMap& _proxyMap;
+                Core::ProxyType<Entry> _entry;
+                uint32_t _offset;
+                uint32_t _length;
+                mutable uint32_t _position;
             };
 
         private:
-            ProxyMap() = delete;
-            ProxyMap(const ProxyMap&) = delete;
-            ProxyMap& operator=(const ProxyMap&) = delete;
+            using LRUList = std::list< std::pair<string, Core::ProxyType<Entry>> >;
+            using Index = std::unordered_map<string, LRUList::iterator>;
+            using Watches = std::unordered_map<int, string>;
 
         public:
-            ProxyMap(ChannelMap& server)
-                : _server(server)
-                , _proxies()
+            FileCache(const FileCache&) = delete;
+            FileCache& operator=(const FileCache&) = delete;
+
+            FileCache()
+                : _adminLock()
+                , _notifyFd(-1)
+                , _generation(0)
+                , _budget(0)
+                , _maxEntry(0)
+                , _size(0)
+                , _entries()
+                , _index()
+                , _watches()
             {
             }
-            ~ProxyMap()
+            ~FileCache() override
             {
-                // Clean up channels in map.
-                while (_proxies.size() > 0) {
-                    delete _proxies.front();
-                    _proxies.pop_front();
-                }
+                Configure(0, 0);
             }
 
         public:
-            void Create(Core::JSON::ArrayType<Config::Proxy>::ConstIterator& index)
+            // Request paths that resolve to the same file, e.g. "/a//b" and "/a/./c/../b", share one key. A path
+            // that climbs above the root has no key, so it is never cached.
+            static string Normalize(const string& path)
             {
+                std::vector<string> segments;
+                bool valid = true;
+                size_t position = 0;
 
-                index.Reset();
+                while ((valid == true) && (position <= path.length())) {
+                    size_t end = path.find('/', position);
+                    const string segment(path.substr(position, (end == string::npos ? string::npos : end - position)));
 
-                while (index.Next() == true) {
+                    if (segment == _T("..")) {
+                        if (segments.empty() == true) {
+                            valid = false;
+                        } else {
+                            segments.pop_back();
+                        }
+                    } else if ((segment.empty() == false) && (segment != _T("."))) {
+                        segments.push_back(segment);
+                    }
 
-                    const string& path(index.Current().Path.Value());
-                    const string& subst(index.Current().Subst.Value());
-                    const Core::NodeId address(index.Current().Server.Value().c_str());
+                    position = (end == string::npos ? path.length() + 1 : end + 1);
+                }
 
-                    if (address.IsValid() == true) {
+                string result;
+
+                if (valid == true) {
+                    for (const string& segment : segments) {
+                        result += '/' + segment;
+                    }
+                    if ((path.empty() == false) && (path[path.length() - 1] == '/')) {
+                        result += '/';
+                    }
+                    if (result.empty() == true) {
+                        result = '/';
+                    }
+                }
+
+                return (result);
+            }
+            inline bool IsEnabled() const
+            {
+                return (_budget != 0);
+            }
+            void Configure(const uint32_t budget, const uint32_t maxEntry)
+            {
+                _adminLock.Lock();
+
+                Clear();
 
-                        _proxies.push_back(new OutgoingChannel(path, subst, *this, address));
+#ifndef __WINDOWS__
+                if (_notifyFd != -1) {
+                    Core::ResourceMonitor::Instance().Unregister(*this);
+                    ::close(_notifyFd);
+                    _notifyFd = -1;
+                }
+#endif
+
+                _budget = budget;
+                _maxEntry = std::min(budget, maxEntry);
+
+#ifndef __WINDOWS__
+                if (_budget != 0) {
+                    _notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+                    if (_notifyFd == -1) {
+                        // Without change notifications we can not guarantee the cached content is current.
+                        TRACE_L1(_T("Could not initialize inotify, content cache disabled. Error: %d"), errno);
+                        _budget = 0;
+                    } else {
+                        Core::ResourceMonitor::Instance().Register(*this);
                     }
                 }
+#endif
+
+                _adminLock.Unlock();
             }
+            Core::ProxyType<Entry> Find(const string& path)
+            {
+                Core::ProxyType<Entry> result;
 
-            void Destroy()
+                _adminLock.Lock();
+
+                Index::iterator index(_index.find(path));
+
+                if (index != _index.end()) {
+#ifdef __WINDOWS__
+                    if (Core::Time(Core::File(index->second->second->FileName(), true).ModificationTime()).Ticks() != index->second->second->Modified().Ticks()) {
+                        // Changed on disk since it was loaded.
+                        Remove(index);
+                    } else
+#endif
+                    {
+                        // Touch it, so it becomes the most recently used one.
+                        _entries.splice(_entries.begin(), _entries, index->second);
+                        result = index->second->second;
+                    }
+                }
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+            Core::ProxyType<Entry> Load(const string& path, const string& fileName, const Web::MIMETypes type)
             {
+                Core::ProxyType<Entry> result;
+                Core::File file(fileName, true);
+
+                if ((IsEnabled() == true) && (path.empty() == false) && (file.Exists() == true) && (file.IsDirectory() == false) && (file.Size() <= _maxEntry)) {
+
+                    // Watch before reading, so a change while we read is not missed. Anything that is
+                    // invalidated in the mean time, might be what we read, so then it is not cached.
+                    _adminLock.Lock();
+                    const bool watched = Watch(fileName);
+                    const uint32_t generation = _generation;
+                    _adminLock.Unlock();
+
+                    if ((watched == true) && (file.Open(true) == true)) {
+                        const Core::Time modified(file.ModificationTime());
+                        string content(static_cast<size_t>(file.Size()), '\0');
+                        uint32_t loaded = 0;
+                        uint32_t chunk;
+
+                        while ((loaded < content.length()) && ((chunk = file.Read(reinterpret_cast<uint8_t*>(&content[loaded]), static_cast<uint32_t>(content.length() - loaded))) > 0)) {
+                            loaded += chunk;
+                        }
+
+                        file.Close();
+
+                        if (loaded == content.length()) {
+                            result = Core::ProxyType<Entry>::Create(fileName, type, modified, std::move(content));
+
+                            _adminLock.Lock();
 
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                            if (generation == _generation) {
+                                Insert(path, result);
+                            }
 
-                while (index != _proxies.end()) {
+                            _adminLock.Unlock();
+                        }
+                    }
+                }
+
+                return (result);
+            }
 
-                    delete (*index);
+        private:
+            void Clear()
+            {
+#ifndef __WINDOWS__
+                Watches::const_iterator index(_watches.begin());
 
+                while (index != _watches.end()) {
+                    inotify_rm_watch(_notifyFd, index->first);
                     index++;
                 }
-                _proxies.clear();
+#endif
+
+                _watches.clear();
+                _index.clear();
+                _entries.clear();
+                _size = 0;
             }
+            bool Watch(const string& fileName)
+            {
+                const string directory(fileName.substr(0, fileName.find_last_of('/') + 1));
+                Watches::const_iterator index(_watches.begin());
 
-            bool Relay(Core::ProxyType<Web::Request>& request, uint32_t channelId)
+                while ((index != _watches.end()) && (index->second != directory)) {
+                    index++;
+                }
+
+#ifdef __WINDOWS__
+                // No notifications, Find() checks the modification time on every hit.
+                if (index == _watches.end()) {
+                    const int wd = static_cast<int>(_watches.size());
+
+                    _watches.emplace(std::piecewise_construct,
+                        std::forward_as_tuple(wd),
+                        std::forward_as_tuple(directory));
+                    index = _watches.find(wd);
+                }
+#else
+                if (index == _watches.end()) {
+                    int wd = inotify_add_watch(_notifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+
+                    if (wd >= 0) {
+                        _watches.emplace(std::piecewise_construct,
+                            std::forward_as_tuple(wd),
+                            std::forward_as_tuple(directory));
+                        index = _watches.find(wd);
+                    }
+                }
+#endif
+
+                return (index != _watches.end());
+            }
+            void Insert(const string& path, const Core::ProxyType<Entry>& entry)
             {
+                Index::iterator index(_index.find(path));
+
+                if (index != _index.end()) {
+                    Remove(index);
+                }
 
-                bool found = false;
-                const string& originalPath = request->Path;
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
-                string proxyPath;
+                _entries.emplace_front(path, entry);
+                _index.emplace(path, _entries.begin());
+                _size += entry->Length();
 
-                while ((found == false) && (index != _proxies.end())) {
+                while (_size > _budget) {
+                    ASSERT(_entries.empty() == false);
 
-                    proxyPath = (*index)->Path();
+                    Remove(_index.find(_entries.back().first));
+                }
+            }
+            void Remove(Index::iterator index)
+            {
+                ASSERT(index != _index.end());
+
+                _size -= index->second->second->Length();
+                _entries.erase(index->second);
+                _index.erase(index);
+            }
+            // Drops a single file, or everything below a directory if the name ends in a '/'.
+            void Invalidate(const string& fileName)
+            {
+                const bool directory((fileName.empty() == true) || (fileName[fileName.length() - 1] == '/'));
+                Index::iterator index(_index.begin());
 
-                    uint32_t checkSize(static_cast<uint32_t>(proxyPath.length()));
+                _generation++;
 
-                    // If path starts with mapped string, we should relay.
-                    if (((originalPath.length() == checkSize) || ((originalPath.length() > checkSize) && (originalPath[checkSize] == '/'))) && (originalPath.compare(0, checkSize, proxyPath) == 0)) {
-                        found = true;
+                while (index != _index.end()) {
+                    const string& cached(index->second->second->FileName());
+
+                    if ((directory == true) ? (cached.compare(0, fileName.length(), fileName) == 0) : (cached == fileName)) {
+                        Index::iterator entry(index++);
+                        Remove(entry);
                     } else {
                         index++;
                     }
                 }
+            }
 
-                // If we didn't find relay instructions for this path, return false.
-                if (found == true) {
-
-                    request->Path = (proxyPath + request->Path.substr(proxyPath.length()));
+            Core::IResource::handle Descriptor() const override
+            {
+                return (_notifyFd);
+            }
+            uint16_t Events() override
+            {
+                return (POLLIN);
+            }
+            void Handle(const uint16_t events) override
+            {
+#ifndef __WINDOWS__
+                if ((events & POLLIN) != 0) {
+                    uint8_t eventBuffer[(sizeof(struct inotify_event) + NAME_MAX + 1) * 8] __attribute__((aligned(__alignof__(struct inotify_event))));
+                    int length;
+
+                    _adminLock.Lock();
+
+                    while ((length = ::read(_notifyFd, eventBuffer, sizeof(eventBuffer))) > 0) {
+                        int offset = 0;
+
+                        while (offset < length) {
+                            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(&(eventBuffer[offset]));
+
+                            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                                // We lost track of what changed, start all over.
+                                Invalidate(EMPTY_STRING);
+                            } else {
+                                Watches::iterator loop(_watches.find(event->wd));
+
+                                if (loop != _watches.end()) {
+                                    if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) != 0) {
+                                        Invalidate(loop->second);
+
+                                        if ((event->mask & IN_IGNORED) == 0) {
+                                            inotify_rm_watch(_notifyFd, loop->first);
+                                        }
+                                        _watches.erase(loop);
+                                    } else if (event->len > 0) {
+                                        Invalidate(loop->second + event->name);
+                                    }
+                                }
+                            }
+
+                            offset += sizeof(struct inotify_event) + event->len;
+                        }
+                    }
 
-                    (*index)->ProxyRequest(request, channelId);
+                    _adminLock.Unlock();
                 }
+#else
+                DEBUG_VARIABLE(events);
+#endif
+            }
+
+        private:
+            Core::CriticalSection _adminLock;
+            int _notifyFd;
+            uint32_t _generation; // Bumped on every invalidation
+            uint32_t _budget;
+            uint32_t _maxEntry;
+            uint32_t _size;
+            LRUList _entries;
+            Index _index;
+            Watches _watches;
+        };
+
+        // Large files are served from a read-only memory mapping. The socket send buffer is filled straight
+        // from the page cache, so there is no read(2) per chunk and no intermediate copy as in Web::FileBody.
+        // Touching a page beyond the end of a file that got truncated raises a SIGBUS, so the size is checked
+        // once when the body starts to go out. If the file shrunk, the response can not be completed and the
+        // link is closed.
+        class MappedBody : public Web::IBody {
+        private:
+            MappedBody() = delete;
+            MappedBody(const MappedBody&) = delete;
+            MappedBody& operator=(const MappedBody&) = delete;
 
-                return (found);
+        public:
+            MappedBody(const string& fileName, Core::SocketPort& link)
+                : _file(fileName, Core::File::SHAREABLE | Core::File::USER_READ, 0)
+                , _link(link)
+#ifndef __WINDOWS__
+                , _descriptor(::open(fileName.c_str(), O_RDONLY | O_CLOEXEC))
+#endif
+                , _offset(0)
+                , _length(static_cast<uint32_t>(_file.Size()))
+                , _position(0)
+                , _truncated(false)
+            {
+            }
+            ~MappedBody() override
+            {
+#ifndef __WINDOWS__
+                if (_descriptor != -1) {
+                    ::close(_descriptor);
+                }
+#endif
             }
 
-            inline void AddProxy(const string& path, const string& subst, const string& address)
+        public:
+            inline bool IsValid() const
             {
-                const Core::NodeId node(address.c_str());
+#ifndef __WINDOWS__
+                return ((_file.IsValid()) && (_descriptor != -1));
+#else
+                return (_file.IsValid());
+#endif
+            }
+            // Restrict the body to a slice of the file, used to serve a byte range.
+            void Range(const uint32_t offset, const uint32_t length)
+            {
+                ASSERT((offset + length) <= _file.Size());
 
-                if (node.IsValid() == true) {
+                _offset = offset;
+                _length = length;
+            }
+
+        private:
+            uint32_t Serialize() const override
+            {
+                _position = 0;
+                _truncated = (Available(_offset + _length) == false);
+                return (_length);
+            }
+            uint32_t Deserialize() override
+            {
+                ASSERT(false);
+                return (0);
+            }
+            void End() const override
+            {
+            }
+            uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+            {
+                uint32_t size = std::min(static_cast<uint32_t>(maxLength), _length - _position);
 
-                    _proxies.push_back(new OutgoingChannel(path, subst, *this, node));
+                if (size > 0) {
+                    if (_truncated == false) {
+                        ::memcpy(stream, &(_file.Buffer()[_offset + _position]), size);
+                        _position += size;
+                    } else {
+                        TRACE_L1(_T("File [%s] was truncated while being served"), _file.Name().c_str());
+                        _position = _length;
+                        size = 0;
+                        _link.Close(0);
+                    }
                 }
+
+                return (static_cast<uint16_t>(size));
             }
-            inline void RemoveProxy(const string& path)
+            uint16_t Deserialize(const uint8_t[], const uint16_t) override
             {
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                ASSERT(false);
+                return (0);
+            }
+            bool Available(const uint64_t end) const
+            {
+#ifndef __WINDOWS__
+                struct stat info;
+
+                return ((::fstat(_descriptor, &info) == 0) && (static_cast<uint64_t>(info.st_size) >= end));
+#else
+                // A mapped file can not be truncated on Windows.
+                DEBUG_VARIABLE(end);
+                return (true);
+#endif
+            }
 
-                while ((index != _proxies.end()) && ((*index)->Path() != path)) {
+        private:
+            Core::DataElementFile _file;
+            Core::SocketPort& _link;
+#ifndef __WINDOWS__
+            int _descriptor;
+#endif
+            uint32_t _offset;
+            uint32_t _length;
+            mutable uint32_t _position;
+            mutable bool _truncated;
+        };
 
-                    index++;
+        // The "route" definition of WebServerPlugin.json, served on the statistics path.
+        class RouteData : public Core::JSON::Container {
+        private:
+            RouteData& operator=(const RouteData&) = delete;
+
+        public:
+            RouteData()
+                : Core::JSON::Container()
+            {
+                Add(_T("path"), &Path);
+                Add(_T("requests"), &Requests);
+                Add(_T("bytes"), &Bytes);
+                Add(_T("queue"), &Queue);
+                Add(_T("p50"), &P50);
+                Add(_T("p99"), &P99);
+            }
+            RouteData(const RouteData& copy)
+                : Core::JSON::Container()
+                , Path(copy.Path)
+                , Requests(copy.Requests)
+                , Bytes(copy.Bytes)
+                , Queue(copy.Queue)
+                , P50(copy.P50)
+                , P99(copy.P99)
+            {
+                Add(_T("path"), &Path);
+                Add(_T("requests"), &Requests);
+                Add(_T("bytes"), &Bytes);
+                Add(_T("queue"), &Queue);
+                Add(_T("p50"), &P50);
+                Add(_T("p99"), &P99);
+            }
+            ~RouteData() override
+            {
+            }
+
+        public:
+            Core::JSON::String Path;
+            Core::JSON::DecUInt32 Requests;
+            Core::JSON::DecUInt64 Bytes;
+            Core::JSON::DecUInt32 Queue;
+            // Upstream latency percentiles in microseconds.
+            Core::JSON::DecUInt32 P50;
+            Core::JSON::DecUInt32 P99;
+        };
+
+        // IMPORTANT NOTE:
+        // All action->response senarious take place on the communication thread from the SoketPortMonitor. There is
+        // only 1 such thread per process. Given this, make sure that all actions done by the ProxyMap are deterministic
+        // and short <100ms as it upholds all other network traffic. The timer that expires requests and the removal of
+        // a proxy touch the ProxyMap from other threads, hence the lock. The socket callbacks take that lock, so no
+        // socket is called with it taken: work is assigned to the links under the lock, and put on their sockets by
+        // OutgoingChannel::Flush() after it is released.
+        class ProxyMap {
+        private:
+            class Upstream;
+
+            struct OutstandingMessage {
+                Core::ProxyType<Web::Request> Request;
+                uint32_t Id;
+                uint64_t Deadline;
+                uint64_t Start;
+                bool Queued; // Handed to the socket, waiting to be sent
+            };
+
+            class OutgoingChannel : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
+            private:
+                static constexpr uint32_t RetryDelay = 250; // ms, doubled for every connect that fails in a row
+                static constexpr uint8_t MaxFailures = 6; // Caps the delay at 8 seconds
+
+            public:
+                OutgoingChannel() = delete;
+                OutgoingChannel(const OutgoingChannel&) = delete;
+                OutgoingChannel& operator=(const OutgoingChannel&) = delete;
+
+                OutgoingChannel(Upstream& upstream, const Core::NodeId& remoteId)
+                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(2, false, remoteId.AnyInterface(), remoteId, 1024, 1024)
+                    , _upstream(upstream)
+                    , _outstandingMessages()
+                    , _connected(false)
+                    , _closing(false)
+                    , _opening(false)
+                    , _abandoned(false)
+                    , _failures(0)
+                    , _retry(0)
+                    , _users(0)
+                {
+                }
+                ~OutgoingChannel() override
+                {
+                    Close(Core::infinite);
+                }
+
+            public:
+                // Should be called with the ProxyMap lock taken.
+                inline uint32_t Outstanding() const
+                {
+                    return (static_cast<uint32_t>(_outstandingMessages.size()));
+                }
+                inline uint64_t Deadline() const
+                {
+                    return (_outstandingMessages.empty() == true ? 0 : _outstandingMessages.front().Deadline);
                 }
+                // Not for new requests while it is being closed, or while a reconnect is held back.
+                inline bool IsUsable(const uint64_t now) const
+                {
+                    return ((_closing == false) && ((IsOpen() == true) || (_retry <= now)));
+                }
+                inline uint64_t Retry() const
+                {
+                    return (_retry);
+                }
+                // A Flush() of this link is outstanding, it can not be deleted until it is done.
+                inline void Enter()
+                {
+                    _users++;
+                }
+                inline void Leave()
+                {
+                    ASSERT(_users > 0);
+                    _users--;
+                }
+                inline bool IsBusy() const
+                {
+                    return (_users != 0);
+                }
+                // The link is about to be closed, it is not used until the close is reported. The close itself
+                // is done by the next Flush().
+                void Abandon()
+                {
+                    _closing = true;
+                    _abandoned = true;
+                }
+                void Connected()
+                {
+                    _connected = true;
+                    _closing = false;
+                    _opening = false;
+                    _failures = 0;
+                    _retry = 0;
+                }
+                // A link that closes without ever being opened failed to connect, back off before the next try.
+                void Disconnected()
+                {
+                    if (_connected == false) {
+                        _failures = std::min(static_cast<uint8_t>(_failures + 1), MaxFailures);
+                        _retry = Core::Time::Now().Add(RetryDelay << (_failures - 1)).Ticks();
+                    }
+
+                    _connected = false;
+                    _closing = false;
+                    _opening = false;
+                    _abandoned = false;
+                }
+                // Should be called with the ProxyMap lock taken, the request goes out on the next Flush().
+                void ProxyRequest(const OutstandingMessage& message)
+                {
+                    _outstandingMessages.push_back(message);
+                    _outstandingMessages.back().Queued = false;
+                }
+                // Puts the work assigned to this link on the socket. Must be called without the ProxyMap lock
+                // taken and after an Enter() done with the lock taken.
+                void Flush();
+                // Hands out all messages, the ones not yet sent are returned in the pending list
+                // so they can go to another connection.
+                void Drain(std::list<OutstandingMessage>& sent, std::list<OutstandingMessage>& pending)
+                {
+                    while (_outstandingMessages.empty() == false) {
+                        if (_outstandingMessages.front().Request.IsValid() == true) {
+                            pending.push_back(_outstandingMessages.front());
+                        } else {
+                            sent.push_back(_outstandingMessages.front());
+                        }
+                        _outstandingMessages.pop_front();
+                    }
+                }
+
+            private:
+                virtual void LinkBody(Core::ProxyType<Web::Response>& response)
+                {
+                    response->Body(_textBodies.Element());
+                }
+                virtual void Send(const Core::ProxyType<Web::Request>& request);
+                // Whenever there is a state change on the link, it is reported here.
+                virtual void StateChange();
+                virtual void Received(Core::ProxyType<Web::Response>& response);
+
+            private:
+                Upstream& _upstream;
+                std::list<OutstandingMessage> _outstandingMessages;
+
+                // Book keeping of the Upstream, only to be touched with the ProxyMap lock taken.
+                bool _connected;
+                bool _closing;
+                bool _opening;
+                bool _abandoned;
+                uint8_t _failures;
+                uint64_t _retry;
+                uint32_t _users;
+            };
+
+            // An upstream is a single proxy route. It owns a pool of up to "connections" links to the server,
+            // each of which can carry "pipeline" requests at the same time. Requests that do not fit wait in
+            // the pending queue for the first link that becomes available.
+            class Upstream {
+            public:
+                Upstream() = delete;
+                Upstream(const Upstream&) = delete;
+                Upstream& operator=(const Upstream&) = delete;
+
+                Upstream(ProxyMap& parent, const string& path, const string& replacement, const Core::NodeId& remoteId, const uint8_t connections, const uint8_t pipeline, const uint32_t timeout)
+                    : _parent(parent)
+                    , _path(path)
+                    , _replacement(replacement)
+                    , _remoteId(remoteId)
+                    , _connections(std::max(connections, static_cast<uint8_t>(1)))
+                    , _pipeline(std::max(pipeline, static_cast<uint8_t>(1)))
+                    , _timeout(timeout)
+                    , _channels()
+                    , _pendingMessages()
+                    , _closed(false)
+                    , _requests(0)
+                    , _bytes(0)
+                    , _latencies()
+                    , _samples(0)
+                {
+                }
+                ~Upstream()
+                {
+                    while (_channels.empty() == false) {
+                        delete _channels.front();
+                        _channels.pop_front();
+                    }
+                }
+
+            public:
+                inline ProxyMap& Parent()
+                {
+                    return (_parent);
+                }
+                inline const string& Path() const
+                {
+                    return (_path);
+                }
+                inline bool IsClosed() const
+                {
+                    return (_closed);
+                }
+                // The route is gone, no link is handed new work from here on.
+                inline void Close()
+                {
+                    _closed = true;
+                }
+                bool IsBusy() const
+                {
+                    std::list<OutgoingChannel*>::const_iterator index(_channels.begin());
+
+                    while ((index != _channels.end()) && ((*index)->IsBusy() == false)) {
+                        index++;
+                    }
+
+                    return (index != _channels.end());
+                }
+                // Closes all links, to be called without the ProxyMap lock taken once the route is closed and no
+                // link is busy anymore. The list of links does not change after the Close().
+                void Shutdown()
+                {
+                    ASSERT(_closed == true);
+
+                    for (OutgoingChannel* channel : _channels) {
+                        channel->Close(Core::infinite);
+                    }
+                }
+                // Hands out what could not be sent before the route was closed.
+                void Abort(std::list<OutstandingMessage>& failed)
+                {
+                    failed.splice(failed.end(), _pendingMessages);
+                }
+                void ProxyRequest(Core::ProxyType<Web::Request>& request, const uint32_t id, std::list<OutgoingChannel*>& flush)
+                {
+                    OutstandingMessage message = { request, id, 0, Core::Time::Now().Ticks(), false };
+
+                    if (_timeout != 0) {
+                        message.Deadline = Core::Time(message.Start).Add(_timeout).Ticks();
+                        _parent.Expire(message.Deadline);
+                    }
+
+                    _requests++;
+
+                    if (_pendingMessages.empty() == false) {
+                        // Keep the order, others are waiting already.
+                        _pendingMessages.push_back(message);
+                    } else {
+                        OutgoingChannel* channel = Available(message.Start);
+
+                        if (channel != nullptr) {
+                            channel->ProxyRequest(message);
+                            Schedule(channel, flush);
+                        } else {
+                            _pendingMessages.push_back(message);
+                        }
+                    }
+                }
+                // A link completed a request or got (re)opened, feed it from the pending queue.
+                void Next(OutgoingChannel& channel)
+                {
+                    while ((_pendingMessages.empty() == false) && (channel.IsOpen() == true) && (channel.Outstanding() < _pipeline)) {
+                        channel.ProxyRequest(_pendingMessages.front());
+                        _pendingMessages.pop_front();
+                    }
+                }
+                // A link got closed, the requests already sent on it can not be recovered.
+                void Closed(OutgoingChannel& channel, std::list<OutstandingMessage>& failed, std::list<OutgoingChannel*>& flush)
+                {
+                    std::list<OutstandingMessage> pending;
+
+                    channel.Drain(failed, pending);
+
+                    _pendingMessages.splice(_pendingMessages.begin(), pending);
+
+                    const uint64_t retry = Dispatch(Core::Time::Now().Ticks(), flush);
+
+                    if (retry != 0) {
+                        // All links are holding back, come back when the first one may try again.
+                        _parent.Expire(retry);
+                    }
+                }
+                // Collects all requests past their deadline. Links that have a request stuck are closed as the
+                // responses on them can no longer be matched, all that was sent on them times out as well.
+                uint64_t Expired(const uint64_t now, std::list<OutstandingMessage>& expired, std::list<OutgoingChannel*>& flush)
+                {
+                    uint64_t next = 0;
+
+                    for (OutgoingChannel* channel : _channels) {
+                        uint64_t deadline = channel->Deadline();
+
+                        if (deadline != 0) {
+                            if (deadline <= now) {
+                                std::list<OutstandingMessage> pending;
+
+                                channel->Drain(expired, pending);
+                                _pendingMessages.splice(_pendingMessages.begin(), pending);
+                                channel->Abandon();
+                                Schedule(channel, flush);
+                            } else {
+                                next = ((next == 0) || (deadline < next) ? deadline : next);
+                            }
+                        }
+                    }
+
+                    std::list<OutstandingMessage>::iterator index(_pendingMessages.begin());
+
+                    while (index != _pendingMessages.end()) {
+                        if ((index->Deadline != 0) && (index->Deadline <= now)) {
+                            expired.push_back(*index);
+                            index = _pendingMessages.erase(index);
+                        } else {
+                            if (index->Deadline != 0) {
+                                next = ((next == 0) || (index->Deadline < next) ? index->Deadline : next);
+                            }
+                            index++;
+                        }
+                    }
+
+                    // A link that was holding back might be allowed to reconnect by now.
+                    const uint64_t retry = Dispatch(now, flush);
+
+                    return ((retry != 0) && ((next == 0) || (retry < next)) ? retry : next);
+                }
+                inline void Submit(const uint32_t id, Core::ProxyType<Web::Response>& response)
+                {
+                    _parent.Submit(id, response);
+                }
+                // Should be called with the ProxyMap lock taken.
+                void Completed(const OutstandingMessage& message, const Web::Response& response)
+                {
+                    _latencies[_samples % _latencies.size()] = static_cast<uint32_t>(std::min(Core::Time::Now().Ticks() - message.Start, static_cast<uint64_t>(~static_cast<uint32_t>(0))));
+                    _samples++;
+
+                    // The body as it was received, a chunked response has no Content-Length.
+                    if (response.HasBody() == true) {
+                        Core::ProxyType<const Web::TextBody> body(response.Body<Web::TextBody>());
+
+                        if (body.IsValid() == true) {
+                            _bytes += body->length();
+                        }
+                    } else if (response.ContentLength.IsSet() == true) {
+                        _bytes += response.ContentLength.Value();
+                    }
+                }
+                void Statistics(RouteData& data) const
+                {
+                    uint32_t queue = static_cast<uint32_t>(_pendingMessages.size());
+
+                    for (const OutgoingChannel* channel : _channels) {
+                        queue += channel->Outstanding();
+                    }
+
+                    data.Path = _path;
+                    data.Requests = _requests;
+                    data.Bytes = _bytes;
+                    data.Queue = queue;
+
+                    if (_samples != 0) {
+                        std::vector<uint32_t> sorted(_latencies.begin(), _latencies.begin() + std::min(_samples, static_cast<uint32_t>(_latencies.size())));
+
+                        std::sort(sorted.begin(), sorted.end());
+                        data.P50 = sorted[(sorted.size() * 50) / 100];
+                        data.P99 = sorted[(sorted.size() * 99) / 100];
+                    }
+                }
+
+            private:
+                // The link is flushed once the ProxyMap lock is released.
+                static void Schedule(OutgoingChannel* channel, std::list<OutgoingChannel*>& flush)
+                {
+                    channel->Enter();
+                    flush.push_back(channel);
+                }
+                // Hands the pending requests to the links that can take them. If requests are left while links
+                // are holding back, the moment the first one may reconnect is returned, 0 otherwise.
+                uint64_t Dispatch(const uint64_t now, std::list<OutgoingChannel*>& flush)
+                {
+                    uint64_t retry = 0;
+                    OutgoingChannel* channel;
+
+                    while ((_pendingMessages.empty() == false) && ((channel = Available(now)) != nullptr)) {
+                        channel->ProxyRequest(_pendingMessages.front());
+                        _pendingMessages.pop_front();
+                        Schedule(channel, flush);
+                    }
+
+                    if (_pendingMessages.empty() == false) {
+                        for (const OutgoingChannel* entry : _channels) {
+                            if ((entry->IsUsable(now) == false) && (entry->Retry() > now)) {
+                                retry = ((retry == 0) || (entry->Retry() < retry) ? entry->Retry() : retry);
+                            }
+                        }
+                    }
+
+                    return (retry);
+                }
+                OutgoingChannel* Available(const uint64_t now)
+                {
+                    OutgoingChannel* result = nullptr;
+
+                    if (_closed == false) {
+                        std::list<OutgoingChannel*>::iterator index(_channels.begin());
+
+                        // Prefer an idle link, keep-alive makes it cheapest.
+                        while ((index != _channels.end()) && (((*index)->Outstanding() != 0) || ((*index)->IsUsable(now) == false))) {
+                            index++;
+                        }
+
+                        if (index != _channels.end()) {
+                            result = *index;
+                        } else if (_channels.size() < _connections) {
+                            result = new OutgoingChannel(*this, _remoteId);
+                            _channels.push_back(result);
+                        } else if (_pipeline > 1) {
+                            index = _channels.begin();
+
+                            while ((index != _channels.end()) && (((*index)->IsOpen() == false) || ((*index)->IsUsable(now) == false) || ((*index)->Outstanding() >= _pipeline))) {
+                                index++;
+                            }
+
+                            if (index != _channels.end()) {
+                                result = *index;
+                            }
+                        }
+                    }
+
+                    return (result);
+                }
+
+            private:
+                ProxyMap& _parent;
+                const string _path;
+                const string _replacement;
+                const Core::NodeId _remoteId;
+                const uint8_t _connections;
+                const uint8_t _pipeline;
+                const uint32_t _timeout;
+                std::list<OutgoingChannel*> _channels;
+                std::list<OutstandingMessage> _pendingMessages;
+                bool _closed;
+
+                // Statistics, the latencies (in us) of the last requests are kept in a ring.
+                uint32_t _requests;
+                uint64_t _bytes;
+                std::array<uint32_t, 256> _latencies;
+                uint32_t _samples;
+            };
+
+            // Longest prefix match over the path segments of the configured proxies. A lookup costs a
+            // hash probe per segment of the request path, independent of the number of routes.
+            class Routes {
+            private:
+                struct Node {
+                    Node()
+                        : Route(nullptr)
+                        , Children()
+                    {
+                    }
+                    ~Node()
+                    {
+                        for (std::pair<const string, Node*>& child : Children) {
+                            delete child.second;
+                        }
+                    }
+
+                    Upstream* Route;
+                    std::unordered_map<string, Node*> Children;
+                };
+
+            public:
+                Routes(const Routes&) = delete;
+                Routes& operator=(const Routes&) = delete;
+
+                Routes()
+                    : _root()
+                {
+                }
+                ~Routes()
+                {
+                }
+
+            public:
+                bool Insert(const string& path, Upstream* route)
+                {
+                    std::vector<string> segments;
+                    Node* node = &_root;
+
+                    Split(path, segments);
+
+                    for (const string& segment : segments) {
+                        Node*& child(node->Children[segment]);
+
+                        if (child == nullptr) {
+                            child = new Node();
+                        }
+                        node = child;
+                    }
+
+                    bool result = (node->Route == nullptr);
+
+                    if (result == true) {
+                        node->Route = route;
+                    }
+
+                    return (result);
+                }
+                void Remove(const string& path)
+                {
+                    std::vector<string> segments;
+
+                    Split(path, segments);
+                    Remove(_root, segments, 0);
+                }
+                Upstream* Find(const string& path) const
+                {
+                    std::vector<string> segments;
+                    const Node* node = &_root;
+                    Upstream* result = _root.Route;
+                    std::vector<string>::const_iterator segment;
+
+                    Split(path, segments);
+                    segment = segments.begin();
+
+                    while ((node != nullptr) && (segment != segments.end())) {
+                        std::unordered_map<string, Node*>::const_iterator index(node->Children.find(*segment));
+
+                        if (index == node->Children.end()) {
+                            node = nullptr;
+                        } else {
+                            node = index->second;
+                            segment++;
+
+                            if (node->Route != nullptr) {
+                                result = node->Route;
+                            }
+                        }
+                    }
+
+                    return (result);
+                }
+
+            private:
+                // The segments between the separators. Empty ones, as in "/a//b" or the last one of "/a/", are kept.
+                // A route so only matches up to a segment boundary: "/" matches "/" but not "/a", and "/a/" matches
+                // "/a//b" but not "/a/b", as a plain comparison of the path up to the next separator did.
+                static void Split(const string& path, std::vector<string>& segments)
+                {
+                    if (path.empty() == false) {
+                        size_t position = (path[0] == '/' ? 1 : 0);
+                        size_t end;
+
+                        do {
+                            end = path.find('/', position);
+
+                            if (end == string::npos) {
+                                end = path.length();
+                            }
+
+                            segments.push_back(path.substr(position, end - position));
+                            position = end + 1;
+                        } while (end != path.length());
+                    }
+                }
+                // Returns true if the node has become empty and can be dropped.
+                static bool Remove(Node& node, const std::vector<string>& segments, const size_t depth)
+                {
+                    if (depth == segments.size()) {
+                        node.Route = nullptr;
+                    } else {
+                        std::unordered_map<string, Node*>::iterator index(node.Children.find(segments[depth]));
+
+                        if ((index != node.Children.end()) && (Remove(*(index->second), segments, depth + 1) == true)) {
+                            delete index->second;
+                            node.Children.erase(index);
+                        }
+                    }
+
+                    return ((node.Route == nullptr) && (node.Children.empty() == true));
+                }
+
+            private:
+                Node _root;
+            };
+
+            class TimeHandler {
+            public:
+                TimeHandler()
+                    : _parent(nullptr)
+                {
+                }
+                TimeHandler(ProxyMap& parent)
+                    : _parent(&parent)
+                {
+                }
+                TimeHandler(const TimeHandler& copy)
+                    : _parent(copy._parent)
+                {
+                }
+                ~TimeHandler()
+                {
+                }
+
+                TimeHandler& operator=(const TimeHandler& RHS)
+                {
+                    _parent = RHS._parent;
+                    return (*this);
+                }
+
+            public:
+                uint64_t Timed(const uint64_t scheduledTime)
+                {
+                    ASSERT(_parent != nullptr);
+
+                    return (_parent->Timed(scheduledTime));
+                }
+
+            private:
+                ProxyMap* _parent;
+            };
+
+        private:
+            ProxyMap() = delete;
+            ProxyMap(const ProxyMap&) = delete;
+            ProxyMap& operator=(const ProxyMap&) = delete;
+
+        public:
+#ifdef __WINDOWS__
+#pragma warning(disable : 4355)
+#endif
+            ProxyMap(ChannelMap& server)
+                : _adminLock()
+                , _server(server)
+                , _proxies()
+                , _routes()
+                , _timer(Core::Thread::DefaultStackSize(), _T("ProxyTimeouts"))
+                , _scheduled(0)
+            {
+            }
+#ifdef __WINDOWS__
+#pragma warning(default : 4355)
+#endif
+            ~ProxyMap()
+            {
+                Destroy();
+            }
+
+        public:
+            void Create(Core::JSON::ArrayType<Config::Proxy>::ConstIterator& index)
+            {
+
+                index.Reset();
+
+                while (index.Next() == true) {
+
+                    const Config::Proxy& proxy(index.Current());
+                    const Core::NodeId address(proxy.Server.Value().c_str());
+
+                    if (address.IsValid() == true) {
+
+                        Add(new Upstream(*this, proxy.Path.Value(), proxy.Subst.Value(), address, proxy.Connections.Value(), proxy.Pipeline.Value(), proxy.Timeout.Value()));
+                    }
+                }
+            }
+
+            void Destroy()
+            {
+                std::list<Upstream*> proxies;
+
+                _adminLock.Lock();
+
+                for (Upstream* upstream : _proxies) {
+                    _routes.Remove(upstream->Path());
+                    upstream->Close();
+                }
+
+                proxies.splice(proxies.end(), _proxies);
+
+                _adminLock.Unlock();
+
+                for (Upstream* upstream : proxies) {
+                    Release(upstream);
+                }
+            }
+
+            bool Relay(Core::ProxyType<Web::Request>& request, uint32_t channelId)
+            {
+                std::list<OutgoingChannel*> flush;
+
+                _adminLock.Lock();
+
+                Upstream* upstream = _routes.Find(request->Path);
+
+                // If we didn't find relay instructions for this path, return false.
+                if (upstream != nullptr) {
+                    upstream->ProxyRequest(request, channelId, flush);
+                }
+
+                _adminLock.Unlock();
+
+                Flush(flush);
+
+                return (upstream != nullptr);
+            }
+
+            inline void AddProxy(const string& path, const string& subst, const string& address)
+            {
+                const Core::NodeId node(address.c_str());
+
+                if (node.IsValid() == true) {
+
+                    Add(new Upstream(*this, path, subst, node, 1, 1, 0));
+                }
+            }
+            inline void RemoveProxy(const string& path)
+            {
+                Upstream* upstream = nullptr;
+
+                _adminLock.Lock();
+
+                std::list<Upstream*>::iterator index(_proxies.begin());
+
+                while ((index != _proxies.end()) && ((*index)->Path() != path)) {
+
+                    index++;
+                }
+
+                if (index != _proxies.end()) {
+
+                    upstream = (*index);
+                    _routes.Remove(path);
+                    upstream->Close();
+                    _proxies.erase(index);
+                }
+
+                _adminLock.Unlock();
+
+                if (upstream != nullptr) {
+                    Release(upstream);
+                }
+            }
+            void Statistics(Core::JSON::ArrayType<RouteData>& routes) const
+            {
+                _adminLock.Lock();
+
+                for (const Upstream* upstream : _proxies) {
+                    upstream->Statistics(routes.Add());
+                }
+
+                _adminLock.Unlock();
+            }
+            inline void Submit(uint32_t channelId, Core::ProxyType<Web::Response>& response)
+            {
+                _server.Submit(channelId, response);
+            }
+            inline void Lock() const
+            {
+                _adminLock.Lock();
+            }
+            inline void Unlock() const
+            {
+                _adminLock.Unlock();
+            }
+            // Make sure the timer fires no later than the given deadline. Called with the lock taken.
+            void Expire(const uint64_t deadline)
+            {
+                if ((_scheduled == 0) || (deadline < _scheduled)) {
+                    _scheduled = deadline;
+                    _timer.Schedule(deadline, TimeHandler(*this));
+                }
+            }
+            void Fail(const std::list<OutstandingMessage>& messages, const Web::WebStatus status, const TCHAR message[])
+            {
+                for (const OutstandingMessage& entry : messages) {
+                    Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+
+                    response->ErrorCode = status;
+                    response->Message = message;
+
+                    Submit(entry.Id, response);
+                }
+            }
+            static void Flush(std::list<OutgoingChannel*>& channels)
+            {
+                for (OutgoingChannel* channel : channels) {
+                    channel->Flush();
+                }
+            }
+
+        private:
+            // Deletes a proxy that got unlinked and closed. The links are closed without the lock taken, closing
+            // one reports back through its StateChange, which takes the lock on the resource monitor thread.
+            void Release(Upstream* upstream)
+            {
+                std::list<OutstandingMessage> failed;
+
+                // A link that is still being flushed finishes that first, the closed route hands out no new work.
+                Settle(*upstream);
+
+                upstream->Shutdown();
+
+                _adminLock.Lock();
+                upstream->Abort(failed);
+                _adminLock.Unlock();
+
+                Settle(*upstream);
+
+                delete upstream;
+
+                Fail(failed, Web::STATUS_BAD_GATEWAY, _T("Bad Gateway"));
+            }
+            void Settle(const Upstream& upstream) const
+            {
+                _adminLock.Lock();
+
+                while (upstream.IsBusy() == true) {
+                    _adminLock.Unlock();
+                    SleepMs(1);
+                    _adminLock.Lock();
+                }
+
+                _adminLock.Unlock();
+            }
+            void Add(Upstream* upstream)
+            {
+                _adminLock.Lock();
+
+                if (_routes.Insert(upstream->Path(), upstream) == true) {
+                    _proxies.push_back(upstream);
+                } else {
+                    TRACE_L1(_T("Proxy path %s is already mapped, ignoring it."), upstream->Path().c_str());
+                    delete upstream;
+                }
+
+                _adminLock.Unlock();
+            }
+            uint64_t Timed(const uint64_t scheduledTime)
+            {
+                uint64_t result = 0;
+                std::list<OutstandingMessage> expired;
+                std::list<OutgoingChannel*> flush;
+
+                _adminLock.Lock();
+
+                // Timers scheduled for a deadline that got superseded by an earlier one are stale.
+                if (scheduledTime == _scheduled) {
+                    const uint64_t now = Core::Time::Now().Ticks();
+
+                    for (Upstream* upstream : _proxies) {
+                        uint64_t next = upstream->Expired(now, expired, flush);
+
+                        if ((next != 0) && ((result == 0) || (next < result))) {
+                            result = next;
+                        }
+                    }
+
+                    _scheduled = result;
+                }
+
+                _adminLock.Unlock();
+
+                Flush(flush);
+                Fail(expired, Web::STATUS_GATEWAY_TIMEOUT, _T("Gateway Timeout"));
+
+                return (result);
+            }
+
+        private:
+            mutable Core::CriticalSection _adminLock;
+            ChannelMap& _server;
+            std::list<Upstream*> _proxies;
+            Routes _routes;
+            Core::TimerType<TimeHandler> _timer;
+            uint64_t _scheduled;
+        };
+
+        // A hashed timer wheel. Arming, re-arming and cancelling a deadline are O(1) and a tick only visits
+        // the entries in the slots that passed. Deadlines more than a full turn away stay in their slot
+        // until their turn comes.
+        template <typename ELEMENT, const uint16_t SLOTS>
+        class TimerWheel {
+        public:
+            class Entry {
+            private:
+                friend class TimerWheel<ELEMENT, SLOTS>;
+
+                Entry(const Entry&) = delete;
+                Entry& operator=(const Entry&) = delete;
+
+            public:
+                Entry(ELEMENT& element)
+                    : _element(element)
+                    , _expiry(0)
+                    , _slot(0)
+                    , _position()
+                {
+                }
+                ~Entry()
+                {
+                }
+
+            public:
+                inline bool IsArmed() const
+                {
+                    return (_expiry != 0);
+                }
+
+            private:
+                ELEMENT& _element;
+                uint64_t _expiry;
+                uint16_t _slot;
+                typename std::list<Entry*>::iterator _position;
+            };
+
+        public:
+            TimerWheel() = delete;
+            TimerWheel(const TimerWheel&) = delete;
+            TimerWheel& operator=(const TimerWheel&) = delete;
+
+            TimerWheel(const uint32_t resolution)
+                : _resolution(static_cast<uint64_t>(resolution) * Core::Time::TicksPerMillisecond)
+                , _slots()
+                , _last(Core::Time::Now().Ticks() / _resolution)
+                , _count(0)
+            {
+            }
+            ~TimerWheel()
+            {
+            }
+
+        public:
+            inline uint32_t Count() const
+            {
+                return (_count);
+            }
+            void Arm(Entry& entry, const uint64_t expiry)
+            {
+                Cancel(entry);
 
-                if (index != _proxies.end()) {
+                // Never put it in a slot that has already been processed.
+                const uint64_t tick = std::max(expiry / _resolution, _last + 1);
 
-                    delete (*index);
-                    _proxies.erase(index);
+                entry._expiry = expiry;
+                entry._slot = static_cast<uint16_t>(tick % SLOTS);
+                entry._position = _slots[entry._slot].insert(_slots[entry._slot].end(), &entry);
+                _count++;
+            }
+            void Cancel(Entry& entry)
+            {
+                if (entry.IsArmed() == true) {
+                    _slots[entry._slot].erase(entry._position);
+                    entry._expiry = 0;
+                    _count--;
                 }
             }
-            inline void Submit(uint32_t channelId, Core::ProxyType<Web::Response>& response)
+            // Disarms and reports all elements whose deadline has passed.
+            void Expired(const uint64_t now, std::list<ELEMENT*>& expired)
             {
-                _server.Submit(channelId, response);
+                const uint64_t tick = now / _resolution;
+                uint32_t steps = static_cast<uint32_t>(std::min(tick - _last, static_cast<uint64_t>(SLOTS)));
+
+                while (steps-- != 0) {
+                    std::list<Entry*>& slot(_slots[(tick - steps) % SLOTS]);
+                    typename std::list<Entry*>::iterator index(slot.begin());
+
+                    while (index != slot.end()) {
+                        if ((*index)->_expiry <= now) {
+                            (*index)->_expiry = 0;
+                            expired.push_back(&((*index)->_element));
+                            index = slot.erase(index);
+                            _count--;
+                        } else {
+                            index++;
+                        }
+                    }
+                }
+
+                _last = tick;
             }
 
         private:
-            ChannelMap& _server;
-            std::list<OutgoingChannel*> _proxies;
+            const uint64_t _resolution;
+            std::array<std::list<Entry*>, SLOTS> _slots;
+            uint64_t _last;
+            uint32_t _count;
         };
 
         class IncomingChannel : public Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory> {
+        private:
+            enum range {
+                RANGE_NONE,
+                RANGE_SATISFIABLE,
+                RANGE_UNSATISFIABLE
+            };
+
+            struct Precompressed {
+                const TCHAR* Extension;
+                const TCHAR* Token;
+                Web::EncodingType Encoding;
+            };
+
         public:
+            using Wheel = TimerWheel<IncomingChannel, 512>;
+
             IncomingChannel() = delete;
             IncomingChannel(const IncomingChannel& copy) = delete;
             IncomingChannel& operator=(const IncomingChannel&) = delete;
             
-            IncomingChannel(const SOCKET& connector, const Core::NodeId& remoteId, Core::SocketServerType<IncomingChannel>* parent)
-                : Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory>(2, false, connector, remoteId, 1024, 1024)
-                , _id(0)
-                , _parent(static_cast<ChannelMap&>(*parent))
-            {
-            }
+            IncomingChannel(const SOCKET& connector, const Core::NodeId& remoteId, Core::SocketServerType<IncomingChannel>* parent);
             
-            ~IncomingChannel() override
-            {
-                Close(Core::infinite);
-            }
+            ~IncomingChannel() override;
 
         private:
             inline uint32_t Id() const
@@ -433,23 +1929,18 @@ namespace Plugin {
             // Handle the HTTP Web requests.
             // [INBOUND]  Completed received requests are triggering the Received,
             // [OUTBOUND] Completed send responses are triggering the Send.
-            virtual void LinkBody(Core::ProxyType<Web::Request>& request)
-            {
-                if (request->Verb == Web::Request::HTTP_POST) {
-                    request->Body(_textBodies.Element());
-                }
-            }
-            virtual void Send(const Core::ProxyType<Web::Response>& response)
-            {
-                TRACE(WebFlow, (response));
-            }
-            virtual void StateChange()
-            {
-            }
+            virtual void LinkBody(Core::ProxyType<Web::Request>& request);
+            virtual void Send(const Core::ProxyType<Web::Response>& response);
+            virtual void StateChange();
             virtual void Received(Core::ProxyType<Web::Request>& request);
 
+            static const Precompressed* Accepted(const Web::Request& request);
+            static range Range(const string& header, const uint32_t length, uint32_t& offset, uint32_t& count);
+            static bool Number(const string& text, uint64_t& value);
+
         private:
             friend class Core::SocketServerType<IncomingChannel>;
+            friend class ChannelMap;
 
             inline void Id(const uint32_t id)
             {
@@ -459,6 +1950,13 @@ namespace Plugin {
         private:
             uint32_t _id;
             ChannelMap& _parent;
+
+            // Book keeping of the ChannelMap, only to be touched with its lock taken.
+            Wheel::Entry _deadline;
+            bool _attached;
+            bool _idle;
+            uint16_t _pending;
+            std::list<IncomingChannel*>::iterator _recent;
         };
 
         class ChannelMap : public Core::SocketServerType<IncomingChannel> {
@@ -468,6 +1966,8 @@ namespace Plugin {
 
             typedef Core::SocketServerType<IncomingChannel> BaseClass;
 
+            static constexpr uint32_t Resolution = 1000;
+
             class TimeHandler {
             public:
                 TimeHandler()
@@ -513,8 +2013,22 @@ namespace Plugin {
                 , _accessor()
                 , _prefixPath()
                 , _connectionCheckTimer(0)
+                , _headerTime(0)
+                , _bodyTime(0)
+                , _maxConnections(0)
+                , _adminLock()
+                , _wheel(Resolution)
+                , _recent()
+                , _connections(0)
+                , _ticking(false)
                 , _cleanupTimer(Core::Thread::DefaultStackSize(), _T("ConnectionChecker"))
                 , _proxyMap(*this)
+                , _fileCache()
+                , _sendBufferSize(1024)
+                , _receiveBufferSize(1024)
+                , _mappedSize(0)
+                , _precompressed(false)
+                , _statistics()
             {
             }
 #ifdef __WINDOWS__
@@ -554,6 +2068,14 @@ namespace Plugin {
 
                 _proxyMap.Create(index);
 
+                _fileCache.Configure(configuration.ContentCache.Size.Value() * 1024, configuration.ContentCache.Entry.Value() * 1024);
+
+                _sendBufferSize = configuration.SendBuffer.Value();
+                _receiveBufferSize = configuration.ReceiveBuffer.Value();
+                _mappedSize = static_cast<uint64_t>(configuration.MappedSize.Value()) * 1024;
+                _precompressed = configuration.Precompressed.Value();
+                _statistics = configuration.Statistics.Value();
+
                 if (configuration.Interface.Value().empty() == false) {
                     Core::NodeId selectedNode = Plugin::Config::IPV4UnicastNode(configuration.Interface.Value());
 
@@ -585,14 +2107,10 @@ namespace Plugin {
                     Core::SocketServerType<IncomingChannel>::LocalNode(listenNode);
 
                     _connectionCheckTimer = configuration.IdleTime.Value() * 1000;
+                    _headerTime = configuration.HeaderTime.Value() * 1000;
+                    _bodyTime = configuration.BodyTime.Value() * 1000;
+                    _maxConnections = configuration.MaxConnections.Value();
 
-                    if (_connectionCheckTimer != 0) {
-                        Core::Time NextTick = Core::Time::Now();
-
-                        NextTick.Add(_connectionCheckTimer);
-
-                        _cleanupTimer.Schedule(NextTick.Ticks(), TimeHandler(*this));
-                    }
                     result = Core::ERROR_NONE;
                 }
 
@@ -614,6 +2132,34 @@ namespace Plugin {
             {
                 return (_proxyMap.Relay(request, id));
             }
+            inline FileCache& Cache()
+            {
+                return (_fileCache);
+            }
+            inline uint16_t SendBufferSize() const
+            {
+                return (_sendBufferSize);
+            }
+            inline uint16_t ReceiveBufferSize() const
+            {
+                return (_receiveBufferSize);
+            }
+            inline uint64_t MappedSize() const
+            {
+                return (_mappedSize);
+            }
+            inline bool Precompressed() const
+            {
+                return (_precompressed);
+            }
+            inline bool IsStatistics(const string& path) const
+            {
+                return ((_statistics.empty() == false) && (path == _statistics));
+            }
+            inline void Statistics(Core::JSON::ArrayType<RouteData>& routes) const
+            {
+                _proxyMap.Statistics(routes);
+            }
             inline string Accessor() const
             {
                 return (_accessor);
@@ -630,39 +2176,172 @@ namespace Plugin {
                 _proxyMap.RemoveProxy(path);
             }
 
+            // Connection life cycle, reported by the IncomingChannels. Every connection carries a single deadline
+            // in the timer wheel: the header time after it got accepted, the body time once a request header is in,
+            // none while we owe it a response and the idle time once that is sent.
+            void Attach(IncomingChannel& channel)
+            {
+                _adminLock.Lock();
+
+                if (channel._attached == false) {
+                    channel._attached = true;
+                    _connections++;
+
+                    IncomingChannel* victim = nullptr;
+
+                    if ((_maxConnections != 0) && (_connections > _maxConnections)) {
+                        // Make room by dropping the connection that has been idle the longest, if there is none
+                        // the newcomer has to go.
+                        victim = (_recent.empty() == true ? &channel : _recent.front());
+
+                        Forget(*victim);
+                        _wheel.Cancel(victim->_deadline);
+                        victim->Close(0);
+                    }
+
+                    if (victim != &channel) {
+                        Arm(channel, (_headerTime != 0 ? _headerTime : _connectionCheckTimer));
+                    }
+                }
+
+                _adminLock.Unlock();
+            }
+            void Detach(IncomingChannel& channel)
+            {
+                _adminLock.Lock();
+
+                if (channel._attached == true) {
+                    channel._attached = false;
+                    _connections--;
+                }
+
+                Forget(channel);
+                _wheel.Cancel(channel._deadline);
+
+                _adminLock.Unlock();
+            }
+            void Reading(IncomingChannel& channel)
+            {
+                _adminLock.Lock();
+
+                Forget(channel);
+                Arm(channel, (_bodyTime != 0 ? _bodyTime : _connectionCheckTimer));
+
+                _adminLock.Unlock();
+            }
+            void Busy(IncomingChannel& channel)
+            {
+                _adminLock.Lock();
+
+                channel._pending++;
+                Forget(channel);
+                _wheel.Cancel(channel._deadline);
+
+                _adminLock.Unlock();
+            }
+            void Idle(IncomingChannel& channel)
+            {
+                _adminLock.Lock();
+
+                if (channel._pending > 0) {
+                    channel._pending--;
+                }
+
+                if ((channel._pending == 0) && (channel._attached == true)) {
+                    // A response sent without a request accounted for leaves it idle already, it moves to the back.
+                    Forget(channel);
+                    channel.ResetActivity();
+                    channel._idle = true;
+                    channel._recent = _recent.insert(_recent.end(), &channel);
+                    Arm(channel, _connectionCheckTimer);
+                }
+
+                _adminLock.Unlock();
+            }
+
         private:
-            uint64_t Timed(const uint64_t scheduledTime)
+            // Should be called with the lock taken.
+            void Forget(IncomingChannel& channel)
             {
-                Core::Time NextTick(Core::Time::Now());
+                if (channel._idle == true) {
+                    _recent.erase(channel._recent);
+                    channel._idle = false;
+                }
+            }
+            void Arm(IncomingChannel& channel, const uint32_t time)
+            {
+                if (time == 0) {
+                    _wheel.Cancel(channel._deadline);
+                } else {
+                    _wheel.Arm(channel._deadline, Core::Time::Now().Add(time).Ticks());
 
-                NextTick.Add(_connectionCheckTimer);
+                    if (_ticking == false) {
+                        _ticking = true;
+                        _cleanupTimer.Schedule(Core::Time::Now().Add(Resolution).Ticks(), TimeHandler(*this));
+                    }
+                }
+            }
+            uint64_t Timed(const uint64_t scheduledTime)
+            {
+                uint64_t result = 0;
+                std::list<IncomingChannel*> expired;
 
                 // First clear all shit from last time..
                 Cleanup();
 
-                // Now suspend those that have no activity.
-                BaseClass::Iterator index(BaseClass::Clients());
+                _adminLock.Lock();
 
-                while (index.Next() == true) {
-                    if (index.Client()->HasActivity() == false) {
-                        // Oops nothing hapened for a long time, kill the connection
-                        // Give it all the time (0) if it i not yet suspended to close. If it is
-                        // suspended, force the close down if not closed in 100ms.
-                        index.Client()->Close(0);
+                const uint64_t now = Core::Time::Now().Ticks();
+
+                _wheel.Expired(now, expired);
+
+                for (IncomingChannel* channel : expired) {
+                    if ((channel->_idle == true) && (_headerTime != 0) && (channel->HasActivity() == true)) {
+                        // A next request is coming in, but its header is not complete yet. Give it the
+                        // header time to finish, slow clients do not get to hold the connection forever.
+                        Forget(*channel);
+                        channel->ResetActivity();
+                        _wheel.Arm(channel->_deadline, Core::Time(now).Add(_headerTime).Ticks());
                     } else {
-                        index.Client()->ResetActivity();
+                        // Oops nothing hapened for too long, kill the connection. Give it all the
+                        // time (0) to close.
+                        Forget(*channel);
+                        channel->Close(0);
                     }
                 }
 
-                return (NextTick.Ticks());
+                // Keep on ticking as long as there is a connection around, closed ones still need a Cleanup.
+                if ((_wheel.Count() != 0) || (_connections != 0)) {
+                    result = Core::Time(now).Add(Resolution).Ticks();
+                } else {
+                    _ticking = false;
+                }
+
+                _adminLock.Unlock();
+
+                return (result);
             }
 
         private:
             string _accessor;
             string _prefixPath;
             uint32_t _connectionCheckTimer;
+            uint32_t _headerTime;
+            uint32_t _bodyTime;
+            uint16_t _maxConnections;
+            Core::CriticalSection _adminLock;
+            IncomingChannel::Wheel _wheel;
+            std::list<IncomingChannel*> _recent;
+            uint32_t _connections;
+            bool _ticking;
             Core::TimerType<TimeHandler> _cleanupTimer;
             ProxyMap _proxyMap;
+            FileCache _fileCache;
+            uint16_t _sendBufferSize;
+            uint16_t _receiveBufferSize;
+            uint64_t _mappedSize;
+            bool _precompressed;
+            string _statistics;
         };
 
     private:
@@ -756,56 +2435,477 @@ namespace Plugin {
 
     SERVICE_REGISTRATION(WebServerImplementation, 1, 0);
 
+    WebServerImplementation::IncomingChannel::IncomingChannel(const SOCKET& connector, const Core::NodeId& remoteId, Core::SocketServerType<IncomingChannel>* parent)
+        : Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory>(2, false, connector, remoteId, static_cast<ChannelMap&>(*parent).SendBufferSize(), static_cast<ChannelMap&>(*parent).ReceiveBufferSize())
+        , _id(0)
+        , _parent(static_cast<ChannelMap&>(*parent))
+        , _deadline(*this)
+        , _attached(false)
+        , _idle(false)
+        , _pending(0)
+        , _recent()
+    {
+    }
+
+    WebServerImplementation::IncomingChannel::~IncomingChannel()
+    {
+        Close(Core::infinite);
+
+        _parent.Detach(*this);
+    }
+
+    /* virtual */ void WebServerImplementation::IncomingChannel::LinkBody(Core::ProxyType<Web::Request>& request)
+    {
+        // The header is in, from now on the body should keep flowing.
+        _parent.Reading(*this);
+
+        if (request->Verb == Web::Request::HTTP_POST) {
+            request->Body(_textBodies.Element());
+        }
+    }
+
+    /* virtual */ void WebServerImplementation::IncomingChannel::Send(const Core::ProxyType<Web::Response>& response)
+    {
+        TRACE(WebFlow, (response));
+
+        _parent.Idle(*this);
+    }
+
+    /* virtual */ void WebServerImplementation::IncomingChannel::StateChange()
+    {
+        if (IsOpen() == true) {
+            _parent.Attach(*this);
+        } else {
+            _parent.Detach(*this);
+        }
+    }
+
+    /* static */ const WebServerImplementation::IncomingChannel::Precompressed* WebServerImplementation::IncomingChannel::Accepted(const Web::Request& request)
+    {
+        // In order of preference, the best compression first.
+        static const Precompressed variants[] = {
+            { _T(".br"), _T("br"), Web::ENCODING_BROTLI },
+            { _T(".gz"), _T("gzip"), Web::ENCODING_GZIP }
+        };
+
+        const Precompressed* result = nullptr;
+
+        if (request.AcceptEncoding.IsSet() == true) {
+            // A list of tokens, each with an optional weight, e.g. "gzip, deflate;q=0.5, br". A weight of 0
+            // means the encoding is not acceptable, "*" stands for anything not listed. Our own preference
+            // decides between the acceptable ones.
+            const string header(request.AcceptEncoding.Value());
+            enum { UNLISTED, ACCEPTED, REFUSED } acceptable[sizeof(variants) / sizeof(Precompressed)] = {};
+            bool wildcard = false;
+            size_t position = 0;
+
+            while (position < header.length()) {
+                size_t end = header.find(',', position);
+                string token(header.substr(position, (end == string::npos ? string::npos : end - position)));
+                size_t parameters = token.find(';');
+                bool accepted = true;
+
+                if (parameters != string::npos) {
+                    string weight(token.substr(parameters + 1));
+                    weight.erase(0, weight.find_first_not_of(_T(" \t")));
+
+                    if ((weight.length() >= 2) && ((weight[0] == 'q') || (weight[0] == 'Q')) && (weight[1] == '=')) {
+                        accepted = (weight.find_first_not_of(_T("0. \t"), 2) != string::npos);
+                    }
+                    token.erase(parameters);
+                }
+
+                token.erase(0, token.find_first_not_of(_T(" \t")));
+                token.erase(token.find_last_not_of(_T(" \t")) + 1);
+                std::transform(token.begin(), token.end(), token.begin(), ::tolower);
+
+                if (token == _T("*")) {
+                    wildcard = accepted;
+                }
+                for (uint8_t index = 0; index < (sizeof(variants) / sizeof(Precompressed)); index++) {
+                    if (token == variants[index].Token) {
+                        acceptable[index] = (accepted == true ? ACCEPTED : REFUSED);
+                    }
+                }
+
+                position = (end == string::npos ? header.length() : end + 1);
+            }
+
+            uint8_t index = 0;
+
+            while ((result == nullptr) && (index < (sizeof(variants) / sizeof(Precompressed)))) {
+                if ((acceptable[index] == ACCEPTED) || ((acceptable[index] == UNLISTED) && (wildcard == true))) {
+                    result = &(variants[index]);
+                }
+                index++;
+            }
+        }
+
+        return (result);
+    }
+
+    // Decimal digits only, fails on anything that does not fit in 64 bits.
+    /* static */ bool WebServerImplementation::IncomingChannel::Number(const string& text, uint64_t& value)
+    {
+        bool result = (text.empty() == false);
+
+        value = 0;
+
+        for (string::const_iterator index(text.begin()); (result == true) && (index != text.end()); index++) {
+            const uint8_t digit = static_cast<uint8_t>(*index - '0');
+
+            if ((digit > 9) || (value > ((~static_cast<uint64_t>(0) - digit) / 10))) {
+                result = false;
+            } else {
+                value = (value * 10) + digit;
+            }
+        }
+
+        return (result);
+    }
+
+    // Parses a "bytes=" Range header. Overlapping ranges, or ranges separated by a gap smaller than the overhead
+    // of an extra part, are coalesced. If the result is still more than one range, the header is ignored and the
+    // full content is sent, as a multipart/byteranges content type can not be expressed through Web::MIMETypes.
+    // A malformed list, or a position that does not fit in 64 bits, is not satisfiable.
+    /* static */ WebServerImplementation::IncomingChannel::range WebServerImplementation::IncomingChannel::Range(const string& header, const uint32_t length, uint32_t& offset, uint32_t& count)
+    {
+        static constexpr uint8_t MaxRanges = 32;
+        static constexpr uint32_t MaxGap = 128;
+
+        std::vector< std::pair<uint32_t, uint32_t> > ranges;
+        range result = RANGE_NONE;
+        const bool bytes = (header.compare(0, 6, _T("bytes=")) == 0);
+        bool valid = (bytes == true) && (length > 0);
+        size_t position = 6;
+
+        while ((valid == true) && (position < header.length())) {
+            size_t end = header.find(',', position);
+            string spec = header.substr(position, (end == string::npos ? string::npos : end - position));
+            spec.erase(0, spec.find_first_not_of(_T(" \t")));
+            spec.erase(spec.find_last_not_of(_T(" \t")) + 1);
+
+            size_t dash = spec.find('-');
+
+            uint64_t first = 0;
+            uint64_t last = (length - 1);
+
+            if ((dash == string::npos) || (ranges.size() >= MaxRanges) || (spec.find('-', dash + 1) != string::npos)) {
+                valid = false;
+            } else if (dash == 0) {
+                // Suffix range, the last N bytes.
+                uint64_t suffix;
+
+                if ((Number(spec.substr(1), suffix) == false) || (suffix == 0)) {
+                    valid = false;
+                } else {
+                    suffix = std::min(suffix, static_cast<uint64_t>(length));
+                    ranges.emplace_back(static_cast<uint32_t>(length - suffix), length - 1);
+                }
+            } else {
+                if ((Number(spec.substr(0, dash), first) == false) || ((dash + 1 < spec.length()) && (Number(spec.substr(dash + 1), last) == false))) {
+                    valid = false;
+                } else if (last < first) {
+                    valid = false;
+                } else if (first < length) {
+                    ranges.emplace_back(static_cast<uint32_t>(first), static_cast<uint32_t>(std::min(last, static_cast<uint64_t>(length - 1))));
+                }
+            }
+
+            position = (end == string::npos ? header.length() : end + 1);
+        }
+
+        if ((valid == false) && (bytes == true) && (length > 0)) {
+            result = RANGE_UNSATISFIABLE;
+        } else if (valid == true) {
+            if (ranges.empty() == true) {
+                result = RANGE_UNSATISFIABLE;
+            } else {
+                std::sort(ranges.begin(), ranges.end());
+
+                std::vector< std::pair<uint32_t, uint32_t> >::const_iterator index(ranges.begin());
+                uint32_t first = index->first;
+                uint32_t last = index->second;
+                bool single = true;
+
+                while ((single == true) && (++index != ranges.end())) {
+                    if (index->first <= (last + MaxGap)) {
+                        last = std::max(last, index->second);
+                    } else {
+                        single = false;
+                    }
+                }
+
+                if (single == true) {
+                    offset = first;
+                    count = last - first + 1;
+                    result = RANGE_SATISFIABLE;
+                }
+            }
+        }
+
+        return (result);
+    }
+
     /* virtual */ void WebServerImplementation::IncomingChannel::Received(Core::ProxyType<Web::Request>& request)
     {
 
         TRACE(WebFlow, (Core::proxy_cast<Web::Request>(request)));
 
-        // Check if the channel server will relay this message.
-        if (_parent.Relay(request, Id()) == false) {
+        // We owe the client a response, it is not idle until that is sent.
+        _parent.Busy(*this);
+
+        if (_parent.IsStatistics(request->Path) == true) {
+            Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+            Core::ProxyType<Web::TextBody> body(_textBodies.Element());
+            Core::JSON::ArrayType<RouteData> routes;
+
+            _parent.Statistics(routes);
+            routes.ToString(*body);
+
+            response->ContentType = Web::MIME_JSON;
+            response->Body(body);
+
+            Submit(response);
+
+        } else if (_parent.Relay(request, Id()) == false) {
+            // The channel server did not relay this message, serve it from the file system.
 
             Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
-            Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
+            FileCache& cache(_parent.Cache());
+            Core::ProxyType<FileCache::Entry> entry;
+            const Precompressed* encoding = (_parent.Precompressed() == true ? Accepted(*request) : nullptr);
+            const string normalized(FileCache::Normalize(request->Path));
+            string key((encoding == nullptr) || (normalized.empty() == true) ? normalized : normalized + encoding->Extension);
+            Web::MIMETypes type(Web::MIME_HTML);
+            string fileToService;
+
+            if (cache.IsEnabled() == true) {
+                entry = cache.Find(key);
+            }
+
+            if (entry.IsValid() == false) {
+                // If so, don't deal with it ourselves.
+                fileToService = _parent.PrefixPath();
+
+                if (Web::MIMETypeForFile(request->Path, fileToService, type) == false) {
+                    // No filename gives, be default, we go for the index.html page..
+                    fileToService += _T("index.html");
+                    type = Web::MIME_HTML;
+                }
 
-            // If so, don't deal with it ourselves.
-            Web::MIMETypes result;
-            string fileToService = _parent.PrefixPath();
+                if (encoding != nullptr) {
+                    if (Core::File(fileToService + encoding->Extension, true).Exists() == true) {
+                        fileToService += encoding->Extension;
+                    } else {
+                        // No precompressed sibling, fall back to the file as is.
+                        encoding = nullptr;
+                        key = normalized;
+
+                        if (cache.IsEnabled() == true) {
+                            entry = cache.Find(key);
+                        }
+                    }
+                }
+
+                if ((entry.IsValid() == false) && (cache.IsEnabled() == true)) {
+                    entry = cache.Load(key, fileToService, type);
+                }
+            }
 
-            if (Web::MIMETypeForFile(request->Path, fileToService, result) == false) {
+            if (entry.IsValid() == true) {
+                type = entry->Type();
+                response->ETag = entry->ETag();
+                response->Modified = entry->Modified();
+            }
 
-                string fullPath = fileToService + _T("index.html");
+            if (encoding != nullptr) {
+                response->ContentEncoding = encoding->Encoding;
+            }
+            if (_parent.Precompressed() == true) {
+                // What is sent depends on the Accept-Encoding of the request, caches need to know.
+                response->Vary = _T("Accept-Encoding");
+            }
 
-                // No filename gives, be default, we go for the index.html page..
-                *fileBody = fileToService + _T("index.html");
-                response->ContentType = Web::MIME_HTML;
-                response->Body<Web::FileBody>(fileBody);
+            if ((entry.IsValid() == true) && (request->IfNoneMatch.IsSet() == true) && (entry->Matches(request->IfNoneMatch.Value()) == true)) {
+                // The client already has this version, no need to send it again.
+                response->ErrorCode = Web::STATUS_NOT_MODIFIED;
+                response->Message = _T("Not Modified");
             } else {
-                *fileBody = fileToService;
-                response->ContentType = result;
-                response->Body<Web::FileBody>(fileBody);
+                const uint32_t length = (entry.IsValid() == true ? entry->Length() : static_cast<uint32_t>(Core::File(fileToService, true).Size()));
+                uint32_t offset = 0;
+                uint32_t count = length;
+                range partial = RANGE_NONE;
+
+                if ((request->Range.IsSet() == true) && (request->Verb == Web::Request::HTTP_GET)) {
+                    partial = Range(request->Range.Value(), length, offset, count);
+                }
+
+                if (partial == RANGE_UNSATISFIABLE) {
+                    response->ErrorCode = Web::STATUS_REQUEST_RANGE_NOT_SATISFIABLE;
+                    response->Message = _T("Requested Range Not Satisfiable");
+                    response->ContentRange = _T("bytes */") + Core::NumberType<uint32_t>(length).Text();
+                } else {
+                    response->ContentType = type;
+
+                    if (partial == RANGE_SATISFIABLE) {
+                        response->ErrorCode = Web::STATUS_PARTIAL_CONTENT;
+                        response->Message = _T("Partial Content");
+                        response->ContentRange = _T("bytes ") + Core::NumberType<uint32_t>(offset).Text() + '-' + Core::NumberType<uint32_t>(offset + count - 1).Text() + '/' + Core::NumberType<uint32_t>(length).Text();
+                    }
+
+                    if (entry.IsValid() == true) {
+                        Core::ProxyType<FileCache::Body> cachedBody(Core::ProxyType<FileCache::Body>::Create(entry));
+
+                        cachedBody->Range(offset, count);
+                        response->Body<FileCache::Body>(cachedBody);
+                    } else {
+                        Core::ProxyType<MappedBody> mappedBody;
+
+                        // A byte range needs random access, so it is always served from a mapping.
+                        if ((partial == RANGE_SATISFIABLE) || ((_parent.MappedSize() != 0) && (length >= _parent.MappedSize()))) {
+                            mappedBody = Core::ProxyType<MappedBody>::Create(fileToService, Link());
+                        }
+
+                        if ((mappedBody.IsValid() == true) && (mappedBody->IsValid() == true)) {
+                            mappedBody->Range(offset, count);
+                            response->Body<MappedBody>(mappedBody);
+                        } else {
+                            Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
+
+                            if (partial == RANGE_SATISFIABLE) {
+                                // Could not map it, send it all.
+                                response->ErrorCode = Web::STATUS_OK;
+                                response->Message = _T("OK");
+                                response->ContentRange.Clear();
+                            }
+
+                            *fileBody = fileToService;
+                            response->Body<Web::FileBody>(fileBody);
+                        }
+                    }
+                }
             }
+
             Submit(response);
         }
     }
 
-    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Received(Core::ProxyType<Web::Response>& response)
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Send(const Core::ProxyType<Web::Request>& request)
     {
-        // Is response to our front of the list
-        ASSERT(_outstandingMessages.empty() == false);
-        ASSERT(_outstandingMessages.front().Request.IsValid() == false);
+        _upstream.Parent().Lock();
 
-        if (_outstandingMessages.empty() == false) {
-            _proxyMap.Submit(_outstandingMessages.front().Id, response);
-            _outstandingMessages.pop_front();
+        std::list<OutstandingMessage>::iterator index(_outstandingMessages.begin());
 
-            // See if ther is a next one to send.
-            if (_outstandingMessages.size() > 0) {
+        while ((index != _outstandingMessages.end()) && (index->Request != request)) {
+            index++;
+        }
+
+        // Mark it as sent, from here on it can only be answered by this link.
+        if (index != _outstandingMessages.end()) {
+            index->Request.Release();
+        }
+
+        _upstream.Parent().Unlock();
+    }
+
+    void WebServerImplementation::ProxyMap::OutgoingChannel::Flush()
+    {
+        ProxyMap& parent(_upstream.Parent());
+        std::list<Core::ProxyType<Web::Request>> requests;
+        bool open = false;
+        bool close = false;
+
+        parent.Lock();
+
+        if (_upstream.IsClosed() == false) {
+            if (_abandoned == true) {
+                _abandoned = false;
+                close = true;
+            } else if (IsOpen() == true) {
+                for (OutstandingMessage& message : _outstandingMessages) {
+                    if ((message.Queued == false) && (message.Request.IsValid() == true)) {
+                        message.Queued = true;
+                        requests.push_back(message.Request);
+                    }
+                }
+            } else if ((_outstandingMessages.empty() == false) && (_opening == false) && (_closing == false)) {
+                _opening = true;
+                open = true;
+            }
+        }
 
-                ASSERT(_outstandingMessages.front().Request.IsValid() == true);
+        parent.Unlock();
 
-                Submit(_outstandingMessages.front().Request);
+        if (close == true) {
+            Close(0);
+        } else if (open == true) {
+            Open(0);
+        } else {
+            for (Core::ProxyType<Web::Request>& request : requests) {
+                Submit(request);
             }
         }
+
+        parent.Lock();
+        Leave();
+        parent.Unlock();
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::StateChange()
+    {
+        ProxyMap& parent(_upstream.Parent());
+        std::list<OutstandingMessage> failed;
+        std::list<OutgoingChannel*> flush;
+
+        parent.Lock();
+
+        if (IsOpen() == true) {
+            Connected();
+
+            _upstream.Next(*this);
+
+            // Sends what was assigned while connecting.
+            Enter();
+            flush.push_back(this);
+        } else {
+            Disconnected();
+            _upstream.Closed(*this, failed, flush);
+        }
+
+        parent.Unlock();
+
+        ProxyMap::Flush(flush);
+        parent.Fail(failed, Web::STATUS_BAD_GATEWAY, _T("Bad Gateway"));
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Received(Core::ProxyType<Web::Response>& response)
+    {
+        ProxyMap& parent(_upstream.Parent());
+        bool found = false;
+        uint32_t id = 0;
+
+        parent.Lock();
+
+        // Responses come in the order the requests were sent, so it belongs to our front of the list.
+        // It might be gone already if it timed out.
+        if ((_outstandingMessages.empty() == false) && (_outstandingMessages.front().Request.IsValid() == false)) {
+            found = true;
+            id = _outstandingMessages.front().Id;
+            _upstream.Completed(_outstandingMessages.front(), *response);
+            _outstandingMessages.pop_front();
+
+            // See if there is a next one to send.
+            _upstream.Next(*this);
+            Enter();
+        }
+
+        parent.Unlock();
+
+        if (found == true) {
+            Flush();
+            parent.Submit(id, response);
+        }
     }
 
 } /* namespace Plugin */
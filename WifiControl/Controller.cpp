@@ -178,8 +178,19 @@ namespace WPASupplicant {
     {
         uint16_t result = 0;
         _adminLock.Lock();
-        if ((_requests.size() > 0) && (_requests.front()->Message().empty() == false)) {
-            string& data = _requests.front()->Message();
+
+        // The channel is free, take the next request from the most urgent class.
+        for (uint8_t index = 0; (_current == nullptr) && (index < Request::PRIORITIES); index++) {
+            if (_queues[index].empty() == false) {
+                _current = _queues[index].front();
+                _queues[index].pop_front();
+                _current->_state = Request::SENT;
+                _sent = Core::Time::Now().Ticks();
+            }
+        }
+
+        if ((_current != nullptr) && (_current->Message().empty() == false)) {
+            string& data = _current->Message();
             TRACE(Communication, (_T("Send: [%s]"), data.c_str()));
             result = (data.length() > maxSendSize ? maxSendSize : data.length());
             memcpy(dataFrame, data.c_str(), result);
@@ -191,9 +202,10 @@ namespace WPASupplicant {
     /* virtual */ uint16_t Controller::ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
     {
 
-        string response = string(reinterpret_cast<const char*>(dataFrame), (dataFrame[receivedSize - 1] == '\n' ? receivedSize - 1 : receivedSize));
+        // An empty reply is valid, e.g. a BSS RANGE beyond the last entry.
+        string response = (receivedSize == 0 ? string() : string(reinterpret_cast<const char*>(dataFrame), (dataFrame[receivedSize - 1] == '\n' ? receivedSize - 1 : receivedSize)));
 
-        if (response[0] == '<') {
+        if ((response.empty() == false) && (response[0] == '<')) {
 
             uint32_t number = 0;
             uint16_t index = 1;
@@ -290,13 +302,9 @@ namespace WPASupplicant {
 
                     _adminLock.Lock();
 
-                    // Let see what we need to do with this BSSID, add or remove :-)
-                    if ((event == CTRL_EVENT_BSS_ADDED) && (_detailRequest.Set(bssid) == true)) {
-                        // send out a request for detail.
-                        _adminLock.Unlock();
-                        Submit(&_detailRequest);
-                        _adminLock.Lock();
-                    } else if (event == CTRL_EVENT_BSS_REMOVED) {
+                    // An added BSS is reported by the supplicant while it processes scan results, the details are
+                    // retrieved in bulk on the CTRL-EVENT-SCAN-RESULTS that follows.
+                    if (event == CTRL_EVENT_BSS_REMOVED) {
 
                         NetworkInfoContainer::iterator network(_networks.find(bssid));
 
@@ -319,19 +327,32 @@ namespace WPASupplicant {
             }
         } else {
             _adminLock.Lock();
-            size_t requestsNumber = _requests.size();
-            _adminLock.Unlock();
-            if (requestsNumber > 0) {
-                _adminLock.Lock();
-                Request* current = _requests.front();
-                _requests.pop_front();
+            Request* current = _current;
+
+            if (current != nullptr) {
+                const uint64_t now = Core::Time::Now().Ticks();
+
+                _statistics[current->_command].Completed(static_cast<uint32_t>(_sent - current->_submitted), static_cast<uint32_t>(now - _sent));
+
+                _current = nullptr;
+                current->_state = Request::IDLE;
                 current->Processing(false);
                 current->Completed(response, false);
 
+                // Unless it already went back in line, or has nothing left to ask.
+                if (current->_again == true) {
+                    current->_again = false;
+
+                    if ((current->_state == Request::IDLE) && (current->Message().empty() == false)) {
+                        Submit(current);
+                    }
+                }
+
                 _adminLock.Unlock();
 
                 Trigger();
             } else {
+                _adminLock.Unlock();
                 TRACE(Trace::Error, ("There is no pending request to process"));
             }
         }
@@ -340,11 +361,47 @@ namespace WPASupplicant {
     }
     // These methods (add/add/update) are assumed to be running in a locked context.
     // Completion of requests are running in a locked context, so oke to update maps/lists
-    void Controller::Add(const uint64_t& bssid, const NetworkInfo& entry)
+    bool Controller::Merge(const uint64_t& bssid, const NetworkInfo& entry)
     {
-        TRACE(Communication, (_T("Added SSID: %llX - %s"), bssid, entry.SSID().c_str()));
-        _networks[bssid] = entry;
-        Reevaluate();
+        bool changed = true;
+
+        NetworkInfoContainer::iterator index(_networks.find(bssid));
+
+        if (index == _networks.end()) {
+            TRACE(Communication, (_T("Added SSID: %llX - %s"), bssid, entry.SSID().c_str()));
+            _networks.emplace(bssid, entry);
+        } else if (index->second != entry) {
+            index->second = entry;
+        } else {
+            changed = false;
+        }
+
+        return (changed);
+    }
+    void Controller::Merged(const std::set<uint64_t>& present, const bool changed)
+    {
+        bool removed = false;
+
+        // Both are ordered on BSSID, whatever the supplicant did not report anymore is gone.
+        NetworkInfoContainer::iterator index(_networks.begin());
+        std::set<uint64_t>::const_iterator found(present.begin());
+
+        while (index != _networks.end()) {
+            while ((found != present.end()) && (*found < index->first)) {
+                found++;
+            }
+            if ((found == present.end()) || (*found != index->first)) {
+                TRACE(Communication, (_T("Removed SSID: %llX - %s"), index->first, index->second.SSID().c_str()));
+                index = _networks.erase(index);
+                removed = true;
+            } else {
+                index++;
+            }
+        }
+
+        if ((changed == true) || (removed == true)) {
+            Reevaluate();
+        }
     }
     void Controller::Add(const string& ssid, const bool current, const uint64_t& bssid)
     {
@@ -429,7 +486,7 @@ namespace WPASupplicant {
                 // send out a request for detail.
                 Submit(&_networkRequest);
             }
-        } else {
+        } else if (_callback != nullptr) {
             _callback->Dispatch(CTRL_EVENT_NETWORK_CHANGED);
         }
     }
@@ -120,6 +120,81 @@ namespace WPASupplicant {
 
             virtual void Completed(const uint32_t result) = 0;
         };
+        // Timing of one command on the control channel, all durations in microseconds.
+        class Statistics {
+        public:
+            Statistics()
+                : _count(0)
+                , _coalesced(0)
+                , _roundTrip(0)
+                , _roundTripMin(~0)
+                , _roundTripMax(0)
+                , _waiting(0)
+                , _waitingMax(0)
+            {
+            }
+            Statistics(const Statistics& copy) = default;
+            Statistics& operator=(const Statistics& rhs) = default;
+            ~Statistics()
+            {
+            }
+
+        public:
+            inline void Completed(const uint32_t waiting, const uint32_t roundTrip)
+            {
+                _count++;
+                _roundTrip += roundTrip;
+                _roundTripMin = std::min(_roundTripMin, roundTrip);
+                _roundTripMax = std::max(_roundTripMax, roundTrip);
+                _waiting += waiting;
+                _waitingMax = std::max(_waitingMax, waiting);
+            }
+            inline void Coalesce()
+            {
+                _coalesced++;
+            }
+            inline uint32_t Count() const
+            {
+                return (_count);
+            }
+            // Submissions that were folded into one that was already pending.
+            inline uint32_t Coalesced() const
+            {
+                return (_coalesced);
+            }
+            // From sending the command up to its reply.
+            inline uint32_t RoundTrip() const
+            {
+                return (_count == 0 ? 0 : static_cast<uint32_t>(_roundTrip / _count));
+            }
+            inline uint32_t RoundTripMin() const
+            {
+                return (_count == 0 ? 0 : _roundTripMin);
+            }
+            inline uint32_t RoundTripMax() const
+            {
+                return (_roundTripMax);
+            }
+            // From the submission up to sending it, the time spent behind other requests.
+            inline uint32_t Waiting() const
+            {
+                return (_count == 0 ? 0 : static_cast<uint32_t>(_waiting / _count));
+            }
+            inline uint32_t WaitingMax() const
+            {
+                return (_waitingMax);
+            }
+
+        private:
+            uint32_t _count;
+            uint32_t _coalesced;
+            uint64_t _roundTrip;
+            uint32_t _roundTripMin;
+            uint32_t _roundTripMax;
+            uint64_t _waiting;
+            uint32_t _waitingMax;
+        };
+        typedef std::map<string, Statistics> StatisticsContainer;
 
     private:
         static constexpr uint32_t MaxConnectionTime = 3000;
@@ -255,6 +330,14 @@ namespace WPASupplicant {
 
                 return (*this);
             }
+            bool operator==(const NetworkInfo& rhs) const
+            {
+                return ((_frequency == rhs._frequency) && (_signal == rhs._signal) && (_pair == rhs._pair) && (_key == rhs._key) && (_ssid == rhs._ssid) && (_id == rhs._id) && (_throughput == rhs._throughput) && (_hidden == rhs._hidden));
+            }
+            bool operator!=(const NetworkInfo& rhs) const
+            {
+                return (!operator==(rhs));
+            }
 
         public:
             bool HasId() const { return (_id != static_cast<uint32_t>(~0)) && (_id != static_cast<uint32_t>(~1)); }
@@ -309,22 +392,51 @@ namespace WPASupplicant {
             bool _hidden;
         };
         class Request {
+        public:
+            // Only one request is on the channel at a time, the next one is taken from the highest class that has one.
+            enum priority : uint8_t {
+                CONNECTION = 0, // Status and (dis)connecting, what a user is waiting for
+                CONFIGURATION = 1,
+                BACKGROUND = 2, // Scan results and BSS details
+                PRIORITIES = 3
+            };
+
         private:
+            friend class Controller;
+
+            enum state : uint8_t {
+                IDLE,
+                QUEUED,
+                SENT
+            };
+
             Request(const Request&) = delete;
             Request& operator=(const Request&) = delete;
 
         public:
-            Request()
+            Request(const priority level = CONFIGURATION)
                 : _request()
                 , _settable(true)
+                , _priority(level)
+                , _state(IDLE)
+                , _again(false)
+                , _position()
+                , _submitted(0)
+                , _command()
             {
             }
-            Request(const string& message)
+            Request(const string& message, const priority level = CONFIGURATION)
                 : _request(message)
 #ifdef __DEBUG__
                 , _original(message)
 #endif // __DEBUG__
                 , _settable(true)
+                , _priority(level)
+                , _state(IDLE)
+                , _again(false)
+                , _position()
+                , _submitted(0)
+                , _command()
             {
             }
             virtual ~Request()
@@ -375,19 +487,38 @@ namespace WPASupplicant {
             string _original;
 #endif // __DEBUG__
             bool _settable;
+
+            // Administered by the Controller, under its lock.
+            const priority _priority;
+            state _state;
+            bool _again; // Submitted again while it was on the channel
+            std::list<Request*>::iterator _position;
+            uint64_t _submitted;
+            string _command;
         };
         class ScanRequest : public Request {
         private:
+            // The BSS entries are retrieved in bulk, with only the fields we use (WPA_BSS_MASK_* of the supplicant):
+            // ID, BSSID, FREQ, LEVEL, FLAGS, SSID, DELIM and EST_THROUGHPUT.
+            static constexpr const TCHAR* BSSMask = _T("0x121887");
+            // The supplicant replies from a 4096 bytes buffer and cuts off at an entry boundary when that is full.
+            // A reply this long is most likely incomplete, the next part starts at the last entry received.
+            static constexpr uint16_t ReplyThreshold = 4096 - 512;
+
             ScanRequest() = delete;
             ScanRequest(const ScanRequest&) = delete;
             ScanRequest& operator=(const ScanRequest&) = delete;
 
         public:
             ScanRequest(Controller& parent)
-                : Request()
+                : Request(BACKGROUND)
                 , _scanning(false)
                 , _parent(parent)
                 , _eventReporting(~0)
+                , _seen()
+                , _last(~0)
+                , _changed(false)
+                , _rescan(false)
             {
             }
             virtual ~ScanRequest()
@@ -413,7 +544,19 @@ namespace WPASupplicant {
             }
             bool Set()
             {
-                return (Request::Set(string(_TXT("SCAN_RESULTS"))));
+                bool result = Request::Set(string(_TXT("BSS RANGE=ALL MASK=")) + BSSMask);
+
+                if (result == true) {
+                    _seen.clear();
+                    _last = ~0;
+                    _changed = false;
+                    _rescan = false;
+                } else {
+                    // Still retrieving the previous results, start over once that is done.
+                    _rescan = true;
+                }
+
+                return (result);
             }
             inline void Event(const events value)
             {
@@ -422,62 +565,99 @@ namespace WPASupplicant {
             virtual void Completed(const string& response, const bool abort) override
             {
                 if (abort == false) {
-                    Core::TextFragment data(response.c_str(), response.length());
-                    uint32_t marker = data.ForwardFind('\n');
-                    uint32_t markerEnd = data.ForwardFind('\n', marker + 1);
+                    const uint32_t previous = _last;
 
-                    while (marker != markerEnd) {
+                    Parse(response);
 
-                        Core::TextFragment element(data, marker + 1, (markerEnd - marker - 1));
-                        marker = markerEnd;
-                        markerEnd = data.ForwardFind('\n', marker + 1);
-                        NetworkInfo newEntry;
-                        _parent.Add(Transform(element, newEntry), newEntry);
+                    if ((response.length() >= ReplyThreshold) && (_last != previous)) {
+                        if (Request::Set(string(_TXT("BSS RANGE=")) + Core::NumberType<uint32_t>(_last).Text() + _T("- MASK=") + BSSMask) == true) {
+                            _parent.Submit(this);
+                            return;
+                        }
+                    }
+
+                    _parent.Merged(_seen, _changed);
+
+                    if ((_rescan == true) && (Set() == true)) {
+                        _parent.Submit(this);
+                        return;
                     }
                 }
                 if (_eventReporting != static_cast<uint32_t>(~0)) {
                     _parent.Notify(static_cast<events>(_eventReporting));
                     _eventReporting = static_cast<uint32_t>(~0);
                 }
+                _rescan = false;
                 _scanning = false;
             }
 
         private:
-            uint64_t Transform(const Core::TextFragment& infoLine, NetworkInfo& source)
+            // Walks over the reply in place, line by line. An entry is complete at its delimiter line.
+            void Parse(const string& response)
             {
-                // First thing we find will be 6 bytes...
-                uint64_t bssid = BSSID(infoLine.Text());
-
-                // Next is the frequency
-                uint16_t index = infoLine.ForwardSkip(_T(" \t"), 18);
-                uint16_t end = infoLine.ForwardFind(_T(" \t"), index);
-
-                uint32_t frequency = Core::NumberType<uint32_t>(Core::TextFragment(infoLine, index, end - index));
-
-                // Next we will find the Signal Strength
-                index = infoLine.ForwardSkip(_T(" \t"), end);
-                end = infoLine.ForwardFind(_T(" \t"), index);
-
-                int32_t signal = Core::NumberType<int32_t>(Core::TextFragment(infoLine, index, end - index));
-
-                // Extract the flags from the information
-                index = infoLine.ForwardSkip(_T(" \t"), end);
-                end = infoLine.ForwardFind(_T(" \t"), index);
+                Core::TextFragment data(response.c_str(), static_cast<uint32_t>(response.length()));
 
+                uint64_t bssid = 0;
+                uint32_t id = static_cast<uint32_t>(~1);
+                string ssid;
+                uint32_t freq = 0;
+                int32_t signal = 0;
+                uint16_t pair = 0;
                 uint32_t keys = 0;
-                uint16_t pairs = KeyPair(Core::TextFragment(infoLine, index, end - index), keys);
+                uint32_t throughput = 0;
+                uint32_t marker = 0;
 
-                // And last but not least, we will find the SSID
-                index = infoLine.ForwardSkip(_T(" \t"), end);
-                source.Set(Core::TextFragment(infoLine, index, infoLine.Length() - index).Text(), frequency, signal, pairs, keys);
-
-                return (bssid);
+                while (marker <= data.Length()) {
+                    uint32_t markerEnd = data.ForwardFind('\n', marker);
+                    Core::TextFragment line(data, marker, markerEnd - marker);
+                    uint32_t split = line.ForwardFind('=');
+
+                    marker = markerEnd + 1;
+
+                    if (split < line.Length()) {
+                        Core::TextFragment name(line, 0, split);
+                        Core::TextFragment value(line, split + 1, line.Length() - split - 1);
+
+                        if (name == _T("id")) {
+                            id = Core::NumberType<uint32_t>(value);
+                        } else if (name == _T("bssid")) {
+                            bssid = Controller::BSSID(value.Text());
+                        } else if (name == _T("freq")) {
+                            freq = Core::NumberType<uint32_t>(value);
+                        } else if (name == _T("level")) {
+                            signal = Core::NumberType<int32_t>(value);
+                        } else if (name == _T("flags")) {
+                            pair = KeyPair(value, keys);
+                        } else if (name == _T("ssid")) {
+                            ssid = value.Text();
+                        } else if (name == _T("est_throughput")) {
+                            throughput = Core::NumberType<uint32_t>(value);
+                        }
+                    } else if ((line == _T("====")) && (bssid != 0)) {
+                        _seen.insert(bssid);
+                        _changed = (_parent.Merge(bssid, NetworkInfo(id, ssid, freq, signal, pair, keys, throughput)) || _changed);
+                        _last = id;
+
+                        bssid = 0;
+                        id = static_cast<uint32_t>(~1);
+                        ssid.clear();
+                        freq = 0;
+                        signal = 0;
+                        pair = 0;
+                        keys = 0;
+                        throughput = 0;
+                    }
+                }
             }
 
         private:
             bool _scanning;
             Controller& _parent;
             uint32_t _eventReporting;
+            std::set<uint64_t> _seen;
+            uint32_t _last;
+            bool _changed;
+            bool _rescan;
         };
         class StatusRequest : public Request {
         private:
@@ -487,7 +667,7 @@ namespace WPASupplicant {
 
         public:
             StatusRequest(Controller& parent)
-                : Request(string(_TXT("STATUS")))
+                : Request(string(_TXT("STATUS")), CONNECTION)
                 , _parent(parent)
                 , _signaled(false, true)
                 , _bssid(0)
@@ -616,7 +796,7 @@ namespace WPASupplicant {
 
         public:
             DetailRequest(Controller& parent)
-                : Request()
+                : Request(BACKGROUND)
                 , _parent(parent)
             {
             }
@@ -785,7 +965,7 @@ namespace WPASupplicant {
             ConnectRequest& operator=(const ConnectRequest&) = delete;
 
             ConnectRequest(Controller& parent)
-                : Request()
+                : Request(CONNECTION)
                 , _parent(parent)
                 , _adminLock()
                 , _state(connection::SELECT)
@@ -941,8 +1121,8 @@ namespace WPASupplicant {
             CustomRequest& operator=(const CustomRequest&) = delete;
 
         public:
-            CustomRequest(const string& custom)
-                : Request(custom)
+            CustomRequest(const string& custom, const priority level = CONFIGURATION)
+                : Request(custom, level)
                 , _signaled(false, true)
                 , _response()
                 , _result(Core::ERROR_NONE)
@@ -996,7 +1176,10 @@ namespace WPASupplicant {
         Controller(const string& supplicantBase, const string& interfaceName, const uint16_t waitTime)
             : BaseClass(false, Core::NodeId(), Core::NodeId(), 512, 32768)
             , _adminLock()
-            , _requests()
+            , _queues()
+            , _current(nullptr)
+            , _sent(0)
+            , _statistics()
             , _networks()
             , _enabled()
             , _error(Core::ERROR_UNAVAILABLE)
@@ -1108,6 +1291,13 @@ namespace WPASupplicant {
         {
             return (_error);
         }
+        inline StatisticsContainer Measurements() const
+        {
+            _adminLock.Lock();
+            StatisticsContainer result(_statistics);
+            _adminLock.Unlock();
+            return (result);
+        }
         inline uint32_t Scan()
         {
 
@@ -1528,7 +1718,7 @@ namespace WPASupplicant {
                 _adminLock.Unlock();
 
                 result = Core::ERROR_NONE;
-                CustomRequest exchange(string(_TXT("DISCONNECT")));
+                CustomRequest exchange(string(_TXT("DISCONNECT")), Request::CONNECTION);
 
                 Submit(&exchange);
 
@@ -1868,7 +2058,8 @@ namespace WPASupplicant {
         }
         // These methods (add/add/update) are assumed to be running in a locked context.
         // Completion of requests are running in a locked context, so oke to update maps/lists
-        void Add(const uint64_t& bssid, const NetworkInfo& entry);
+        bool Merge(const uint64_t& bssid, const NetworkInfo& entry);
+        void Merged(const std::set<uint64_t>& present, const bool changed);
         void Add(const string& ssid, const bool current, const uint64_t& bssid);
         void Update(const string& status);
         void Update(const uint64_t& bssid, const string& ssid, const uint32_t id, uint32_t frequency, const int32_t signal, const uint16_t pairs, const uint32_t keys, const uint32_t throughput);
@@ -1880,21 +2071,27 @@ namespace WPASupplicant {
 
         void Revoke(const Request* id) const
         {
+            Request* request = const_cast<Request*>(id);
+            bool retrigger = false;
+
             _adminLock.Lock();
 
-            std::list<Request*>::iterator index(std::find(_requests.begin(), _requests.end(), id));
+            if (request->_state == Request::QUEUED) {
+                _queues[request->_priority].erase(request->_position);
+            } else if (request == _current) {
+                // Do not wait for its reply any longer, the channel is free for the next one.
+                _current = nullptr;
+                retrigger = true;
+            }
 
-            if (index != _requests.end()) {
-                bool retrigger(index == _requests.begin());
-                (*index)->Processing(false);
-                _requests.erase(index);
-                _adminLock.Unlock();
+            request->_state = Request::IDLE;
+            request->_again = false;
+            request->Processing(false);
 
-                if (retrigger == true) {
-                    const_cast<Controller*>(this)->Trigger();
-                }
-            } else {
-                _adminLock.Unlock();
+            _adminLock.Unlock();
+
+            if (retrigger == true) {
+                const_cast<Controller*>(this)->Trigger();
             }
         }
 
@@ -1907,13 +2104,25 @@ namespace WPASupplicant {
         {
             _adminLock.Lock();
 
-            while (_requests.size() != 0) {
-                Request* current = _requests.front();
-                _requests.pop_front();
+            if (_current != nullptr) {
+                Request* current = _current;
+                _current = nullptr;
+                current->_state = Request::IDLE;
+                current->_again = false;
                 current->Processing(false);
                 current->Completed(EMPTY_STRING, true);
             }
 
+            for (uint8_t index = 0; index < Request::PRIORITIES; index++) {
+                while (_queues[index].empty() == false) {
+                    Request* current = _queues[index].front();
+                    _queues[index].pop_front();
+                    current->_state = Request::IDLE;
+                    current->Processing(false);
+                    current->Completed(EMPTY_STRING, true);
+                }
+            }
+
             _adminLock.Unlock();
         }
 
@@ -1921,42 +2130,59 @@ namespace WPASupplicant {
         {
             _adminLock.Lock();
 
-            ASSERT(std::find(_requests.begin(), _requests.end(), data) == _requests.end());
+            if (data->_state == Request::QUEUED) {
+                // Still waiting for its turn, it goes out once and serves both.
+                _statistics[data->_command].Coalesce();
+                _adminLock.Unlock();
+            } else if (data->_state == Request::SENT) {
+                // The reply might already be underway, ask again once it is in.
+                data->_again = true;
+                _statistics[data->_command].Coalesce();
+                _adminLock.Unlock();
+            } else {
+                std::list<Request*>& queue(_queues[data->_priority]);
 
-            data->Processing(true);
-            _requests.push_back(data);
+                data->Processing(true);
+                data->_state = Request::QUEUED;
+                data->_submitted = Core::Time::Now().Ticks();
+                data->_command = Command(data->Message());
+                data->_position = queue.insert(queue.end(), data);
 
-            if (_requests.size() == 1) {
-                _adminLock.Unlock();
+                const bool idle = (_current == nullptr);
 
-                const_cast<Controller*>(this)->Trigger();
-            } else {
-                TRACE_L1("Submit does not trigger, there are %d messages pending [%s,%s]", static_cast<unsigned int>(_requests.size()), _requests.front()->Original().c_str(), _requests.front()->Message().c_str());
                 _adminLock.Unlock();
+
+                if (idle == true) {
+                    const_cast<Controller*>(this)->Trigger();
+                }
             }
         }
 
         inline bool IsSubmitted(Request* id) const
         {
-            bool status = false;
-
             _adminLock.Lock();
-            std::list<Request*>::iterator index(std::find(_requests.begin(), _requests.end(), id));
-            if (index != _requests.end()) {
-                _adminLock.Unlock();
+            bool status = (id->_state != Request::IDLE);
+            _adminLock.Unlock();
 
+            if (status == true) {
                 const_cast<Controller*>(this)->Trigger();
-                status = true;
-            } else {
-                _adminLock.Unlock();
             }
 
             return status;
         }
 
+        // The first word of a message, statistics are kept per command.
+        static string Command(const string& message)
+        {
+            return (message.substr(0, message.find(' ')));
+        }
+
     private:
         mutable Core::CriticalSection _adminLock;
-        mutable std::list<Request*> _requests;
+        mutable std::list<Request*> _queues[Request::PRIORITIES];
+        mutable Request* _current; // On the channel, the next reply is for this one
+        uint64_t _sent;
+        mutable StatisticsContainer _statistics;
         NetworkInfoContainer _networks;
         EnabledContainer _enabled;
         uint32_t _error;
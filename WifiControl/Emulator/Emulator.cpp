@@ -0,0 +1,570 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the control interface of wpa_supplicant, so the WifiControl plugin can be run (and its scan
+// handling benchmarked) without wifi hardware. It answers the commands the plugin uses, keeps a configurable
+// set of BSS entries that changes a little on every scan and reports, per scan, how many requests and bytes
+// it took the plugin to pick up the results. Start it with the connector and interface the plugin is
+// configured with, and "application" set to null so the plugin does not start a supplicant itself.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace WPASupplicant {
+
+    class Emulator {
+    private:
+        // Size of the reply buffer of the supplicant, longer replies are cut off.
+        static constexpr uint16_t ReplySize = 4096;
+        // How long the plugin may stay silent before the retrieval of a scan result counts as done.
+        static constexpr uint32_t IdleTime = 500; // ms
+
+        // WPA_BSS_MASK_*, only the fields the emulator knows about.
+        enum mask : uint32_t {
+            MASK_ID = (1 << 0),
+            MASK_BSSID = (1 << 1),
+            MASK_FREQ = (1 << 2),
+            MASK_LEVEL = (1 << 7),
+            MASK_FLAGS = (1 << 11),
+            MASK_SSID = (1 << 12),
+            MASK_DELIM = (1 << 17),
+            MASK_EST_THROUGHPUT = (1 << 20),
+            MASK_ALL = 0xFFFDFFFF
+        };
+
+        struct BSS {
+            uint32_t Id;
+            uint64_t BSSID;
+            uint32_t Frequency;
+            int32_t Level;
+            const char* Flags;
+            std::string SSID;
+            uint32_t Throughput;
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        Emulator() = delete;
+        Emulator(const Emulator&) = delete;
+        Emulator& operator=(const Emulator&) = delete;
+
+    public:
+        Emulator(const std::string& path, const uint16_t count, const uint8_t churn, const uint16_t period)
+            : _path(path)
+            , _socket(-1)
+            , _entries()
+            , _attached()
+            , _networks()
+            , _random(0x5EED)
+            , _churn(churn)
+            , _period(period)
+            , _nextId(0)
+            , _nextNetwork(0)
+            , _scans(0)
+            , _changes(0)
+            , _measuring(false)
+            , _started()
+            , _finished()
+            , _lastScan(Clock::now())
+            , _requests(0)
+            , _bytes(0)
+        {
+            for (uint16_t index = 0; index < count; index++) {
+                Add();
+            }
+        }
+        ~Emulator()
+        {
+            if (_socket != -1) {
+                ::close(_socket);
+                ::unlink(_path.c_str());
+            }
+        }
+
+    public:
+        bool Open()
+        {
+            struct sockaddr_un address;
+            ::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+
+            if (_path.length() >= sizeof(address.sun_path)) {
+                std::cerr << "Path too long: " << _path << std::endl;
+            } else {
+                ::strncpy(address.sun_path, _path.c_str(), sizeof(address.sun_path) - 1);
+                ::unlink(_path.c_str());
+
+                _socket = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+
+                if ((_socket != -1) && (::bind(_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)) {
+                    std::cerr << "Could not bind to " << _path << ": " << ::strerror(errno) << std::endl;
+                    ::close(_socket);
+                    _socket = -1;
+                }
+            }
+
+            return (_socket != -1);
+        }
+        void Run(volatile sig_atomic_t& stop)
+        {
+            char buffer[ReplySize];
+            struct pollfd descriptor;
+            descriptor.fd = _socket;
+            descriptor.events = POLLIN;
+
+            while (stop == 0) {
+                descriptor.revents = 0;
+
+                if ((::poll(&descriptor, 1, 100) > 0) && ((descriptor.revents & POLLIN) != 0)) {
+                    struct sockaddr_un client;
+                    socklen_t length = sizeof(client);
+
+                    ssize_t size = ::recvfrom(_socket, buffer, sizeof(buffer), 0, reinterpret_cast<struct sockaddr*>(&client), &length);
+
+                    if (size > 0) {
+                        std::string command(buffer, size);
+
+                        while ((command.empty() == false) && (command[command.length() - 1] == '\n')) {
+                            command.erase(command.length() - 1);
+                        }
+
+                        if (Process(client, length, command) == false) {
+                            break;
+                        }
+                    }
+                }
+
+                const Clock::time_point now = Clock::now();
+
+                if ((_measuring == true) && (now - _finished) > std::chrono::milliseconds(IdleTime)) {
+                    Report();
+                }
+                if ((_period != 0) && (_attached.empty() == false) && ((now - _lastScan) > std::chrono::seconds(_period))) {
+                    Scan();
+                }
+            }
+        }
+
+    private:
+        bool Process(const struct sockaddr_un& client, const socklen_t length, const std::string& command)
+        {
+            bool running = true;
+            bool scan = false;
+            std::string reply;
+            const size_t split = command.find(' ');
+            const std::string name(command.substr(0, split));
+            const std::string arguments(split == std::string::npos ? std::string() : command.substr(split + 1));
+
+            if (name == "PING") {
+                reply = "PONG\n";
+            } else if (name == "ATTACH") {
+                _attached[client.sun_path] = std::make_pair(client, length);
+                reply = "OK\n";
+            } else if (name == "DETACH") {
+                _attached.erase(client.sun_path);
+                reply = "OK\n";
+            } else if (name == "SCAN") {
+                reply = "OK\n";
+                scan = true;
+            } else if (name == "SCAN_RESULTS") {
+                reply = Results();
+            } else if (name == "BSS") {
+                reply = Detail(arguments);
+            } else if (name == "STATUS") {
+                reply = "wpa_state=DISCONNECTED\naddress=02:00:00:00:ff:ff\n";
+            } else if (name == "LIST_NETWORKS") {
+                reply = "network id / ssid / bssid / flags\n";
+                for (std::map<uint32_t, std::string>::const_iterator index(_networks.begin()); index != _networks.end(); index++) {
+                    reply += std::to_string(index->first) + '\t' + index->second + "\tany\t\n";
+                }
+            } else if (name == "ADD_NETWORK") {
+                _networks[_nextNetwork] = std::string();
+                reply = std::to_string(_nextNetwork++) + '\n';
+            } else if (name == "SET_NETWORK") {
+                Configure(arguments);
+                reply = "OK\n";
+            } else if (name == "REMOVE_NETWORK") {
+                _networks.erase(static_cast<uint32_t>(std::atoi(arguments.c_str())));
+                reply = "OK\n";
+            } else if ((name == "GET") || (name == "GET_NETWORK")) {
+                reply = "FAIL\n";
+            } else if (name == "TERMINATE") {
+                reply = "OK\n";
+                running = false;
+            } else if ((name == "SET") || (name == "LEVEL") || (name == "ENABLE_NETWORK") || (name == "DISABLE_NETWORK") || (name == "SELECT_NETWORK") || (name == "RECONNECT") || (name == "DISCONNECT") || (name == "PREAUTH")) {
+                reply = "OK\n";
+            } else {
+                reply = "UNKNOWN COMMAND\n";
+            }
+
+            Send(client, length, reply);
+
+            if (_measuring == true) {
+                _requests++;
+                _bytes += static_cast<uint32_t>(reply.length());
+                _finished = Clock::now();
+            }
+            if (scan == true) {
+                Scan();
+            }
+
+            return (running);
+        }
+        void Send(const struct sockaddr_un& client, const socklen_t length, const std::string& message)
+        {
+            if (::sendto(_socket, message.c_str(), message.length(), 0, reinterpret_cast<const struct sockaddr*>(&client), length) < 0) {
+                std::cerr << "Could not send to " << client.sun_path << ": " << ::strerror(errno) << std::endl;
+            }
+        }
+        void Event(const std::string& message)
+        {
+            const std::string text("<3>" + message);
+
+            for (std::map<std::string, std::pair<struct sockaddr_un, socklen_t>>::const_iterator index(_attached.begin()); index != _attached.end(); index++) {
+                Send(index->second.first, index->second.second, text);
+            }
+        }
+        void Configure(const std::string& arguments)
+        {
+            // <id> ssid "<name>"
+            const uint32_t id = static_cast<uint32_t>(std::atoi(arguments.c_str()));
+            const size_t key = arguments.find(" ssid ");
+
+            if ((key != std::string::npos) && (_networks.find(id) != _networks.end())) {
+                std::string ssid(arguments.substr(key + 6));
+
+                if ((ssid.length() >= 2) && (ssid[0] == '"') && (ssid[ssid.length() - 1] == '"')) {
+                    ssid = ssid.substr(1, ssid.length() - 2);
+                }
+                _networks[id] = ssid;
+            }
+        }
+
+        // Some entries change their level, a few disappear and as many new ones show up.
+        void Scan()
+        {
+            std::uniform_int_distribution<uint32_t> percentage(0, 99);
+            std::uniform_int_distribution<int32_t> delta(-6, 6);
+            const uint32_t replaced = static_cast<uint32_t>(_entries.size() * _churn / 400);
+
+            _scans++;
+            _changes = 0;
+            _lastScan = Clock::now();
+
+            Event("CTRL-EVENT-SCAN-STARTED ");
+
+            for (std::vector<BSS>::iterator index(_entries.begin()); index != _entries.end(); index++) {
+                if (percentage(_random) < _churn) {
+                    index->Level = std::max(-95, std::min(-20, index->Level + delta(_random)));
+                    _changes++;
+                }
+            }
+            for (uint32_t count = 0; (count < replaced) && (_entries.empty() == false); count++) {
+                std::vector<BSS>::iterator index(_entries.begin() + (_random() % _entries.size()));
+
+                Event("CTRL-EVENT-BSS-REMOVED " + std::to_string(index->Id) + ' ' + BSSID(index->BSSID));
+                _entries.erase(index);
+
+                const BSS& added = Add();
+                Event("CTRL-EVENT-BSS-ADDED " + std::to_string(added.Id) + ' ' + BSSID(added.BSSID));
+                _changes += 2;
+            }
+
+            Event("CTRL-EVENT-SCAN-RESULTS ");
+
+            _measuring = true;
+            _started = Clock::now();
+            _finished = _started;
+            _requests = 0;
+            _bytes = 0;
+        }
+        void Report()
+        {
+            const uint32_t duration = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(_finished - _started).count());
+
+            ::printf("Scan %u: %u BSS, %u changed, %u requests, %u bytes in %u.%03u ms\n",
+                _scans, static_cast<uint32_t>(_entries.size()), _changes, _requests, _bytes, duration / 1000, duration % 1000);
+            ::fflush(stdout);
+
+            _measuring = false;
+        }
+
+        const BSS& Add()
+        {
+            static const char* flags[] = {
+                "[WPA2-PSK-CCMP][ESS]",
+                "[WPA-PSK-CCMP+TKIP][WPA2-PSK-CCMP+TKIP][WPS][ESS]",
+                "[WPA2-EAP-CCMP][ESS]",
+                "[RSN-SAE-CCMP][ESS]",
+                "[ESS]"
+            };
+            std::uniform_int_distribution<int32_t> level(-90, -30);
+
+            BSS entry;
+            entry.Id = _nextId++;
+            entry.BSSID = 0x020000000000ULL | (static_cast<uint64_t>(_random() & 0xFFFF) << 16) | entry.Id;
+            entry.Frequency = ((entry.Id & 0x01) == 0 ? 2412 + (5 * (entry.Id % 13)) : 5180 + (20 * (entry.Id % 8)));
+            entry.Level = level(_random);
+            entry.Flags = flags[entry.Id % (sizeof(flags) / sizeof(flags[0]))];
+            // Every tenth network hides its SSID.
+            entry.SSID = ((entry.Id % 10) == 9 ? std::string("\\x00\\x00\\x00\\x00") : "Emulated-" + std::to_string(entry.Id));
+            entry.Throughput = (entry.Frequency > 5000 ? 390001 : 65000) + entry.Level * 1000;
+
+            _entries.push_back(entry);
+
+            return (_entries.back());
+        }
+
+        std::string Results() const
+        {
+            std::string reply("bssid / frequency / signal level / flags / ssid\n");
+
+            for (std::vector<BSS>::const_iterator index(_entries.begin()); index != _entries.end(); index++) {
+                const std::string line(BSSID(index->BSSID) + '\t' + std::to_string(index->Frequency) + '\t' + std::to_string(index->Level) + '\t' + index->Flags + '\t' + index->SSID + '\n');
+
+                if ((reply.length() + line.length()) >= ReplySize) {
+                    break;
+                }
+                reply += line;
+            }
+
+            return (reply);
+        }
+        // BSS <bssid> | RANGE=ALL | RANGE=N1-[N2] | ID-<n> | FIRST | LAST, followed by an optional MASK=0x<bits>.
+        std::string Detail(const std::string& arguments) const
+        {
+            std::string reply;
+
+            if (_entries.empty() == false) {
+                const size_t split = arguments.find(' ');
+                const std::string what(arguments.substr(0, split));
+                const size_t option = arguments.find("MASK=");
+                const uint32_t mask = (option == std::string::npos ? MASK_ALL : static_cast<uint32_t>(std::strtoul(arguments.c_str() + option + 5, nullptr, 0)));
+
+                std::vector<BSS>::const_iterator first(_entries.end());
+                std::vector<BSS>::const_iterator last(_entries.end());
+
+                if (what.compare(0, 6, "RANGE=") == 0) {
+                    if (what.compare(6, 3, "ALL") == 0) {
+                        first = _entries.begin();
+                        last = _entries.end() - 1;
+                    } else if (what.find('-', 6) != std::string::npos) {
+                        const uint32_t lower = static_cast<uint32_t>(std::strtoul(what.c_str() + 6, nullptr, 10));
+                        const std::string upperText(what.substr(what.find('-', 6) + 1));
+                        const uint32_t upper = (upperText.empty() == true ? ~0 : static_cast<uint32_t>(std::strtoul(upperText.c_str(), nullptr, 10)));
+
+                        first = _entries.begin();
+                        while ((first != _entries.end()) && (first->Id < lower)) {
+                            first++;
+                        }
+                        last = first;
+                        while ((last != _entries.end()) && ((last + 1) != _entries.end()) && ((last + 1)->Id <= upper)) {
+                            last++;
+                        }
+                        if ((first != _entries.end()) && (first->Id > upper)) {
+                            first = _entries.end();
+                        }
+                    }
+                } else if (what == "FIRST") {
+                    first = last = _entries.begin();
+                } else if (what == "LAST") {
+                    first = last = _entries.end() - 1;
+                } else {
+                    const bool byId = (what.compare(0, 3, "ID-") == 0);
+                    const uint64_t bssid = (byId == true ? 0 : BSSID(what));
+                    const uint32_t id = (byId == true ? static_cast<uint32_t>(std::strtoul(what.c_str() + 3, nullptr, 10)) : 0);
+
+                    for (first = _entries.begin(); first != _entries.end(); first++) {
+                        if ((byId == true ? (first->Id == id) : (first->BSSID == bssid)) == true) {
+                            break;
+                        }
+                    }
+                    last = first;
+                }
+
+                if (first != _entries.end()) {
+                    do {
+                        const std::string entry(Print(*first, mask));
+
+                        // The supplicant never sends half an entry.
+                        if ((reply.length() + entry.length()) >= ReplySize) {
+                            break;
+                        }
+                        reply += entry;
+                    } while (first++ != last);
+                }
+            }
+
+            return (reply);
+        }
+        static std::string Print(const BSS& entry, const uint32_t mask)
+        {
+            std::string result;
+
+            if ((mask & MASK_ID) != 0) {
+                result += "id=" + std::to_string(entry.Id) + '\n';
+            }
+            if ((mask & MASK_BSSID) != 0) {
+                result += "bssid=" + BSSID(entry.BSSID) + '\n';
+            }
+            if ((mask & MASK_FREQ) != 0) {
+                result += "freq=" + std::to_string(entry.Frequency) + '\n';
+            }
+            if ((mask & MASK_LEVEL) != 0) {
+                result += "level=" + std::to_string(entry.Level) + '\n';
+            }
+            if ((mask & MASK_FLAGS) != 0) {
+                result += std::string("flags=") + entry.Flags + '\n';
+            }
+            if ((mask & MASK_SSID) != 0) {
+                result += "ssid=" + entry.SSID + '\n';
+            }
+            if ((mask & MASK_EST_THROUGHPUT) != 0) {
+                result += "est_throughput=" + std::to_string(entry.Throughput) + '\n';
+            }
+            if ((mask & MASK_DELIM) != 0) {
+                result += "====\n";
+            }
+
+            return (result);
+        }
+        static std::string BSSID(const uint64_t bssid)
+        {
+            char text[18];
+
+            ::snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+                static_cast<uint8_t>(bssid >> 40), static_cast<uint8_t>(bssid >> 32), static_cast<uint8_t>(bssid >> 24),
+                static_cast<uint8_t>(bssid >> 16), static_cast<uint8_t>(bssid >> 8), static_cast<uint8_t>(bssid));
+
+            return (text);
+        }
+        static uint64_t BSSID(const std::string& text)
+        {
+            uint64_t result = 0;
+            unsigned int bytes[6];
+
+            if (::sscanf(text.c_str(), "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) == 6) {
+                for (uint8_t index = 0; index < 6; index++) {
+                    result = (result << 8) | (bytes[index] & 0xFF);
+                }
+            }
+
+            return (result);
+        }
+
+    private:
+        const std::string _path;
+        int _socket;
+        std::vector<BSS> _entries; // Ordered on id, as the supplicant keeps them
+        std::map<std::string, std::pair<struct sockaddr_un, socklen_t>> _attached;
+        std::map<uint32_t, std::string> _networks;
+        std::mt19937 _random;
+        const uint8_t _churn;
+        const uint16_t _period;
+        uint32_t _nextId;
+        uint32_t _nextNetwork;
+        uint32_t _scans;
+        uint32_t _changes;
+        bool _measuring;
+        Clock::time_point _started;
+        Clock::time_point _finished;
+        Clock::time_point _lastScan;
+        uint32_t _requests;
+        uint32_t _bytes;
+    };
+
+} // namespace WPASupplicant
+} // namespace WPEFramework
+
+static volatile sig_atomic_t _stop = 0;
+
+static void Stop(int)
+{
+    _stop = 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::string connector("/tmp/wpa_supplicant");
+    std::string interface("wlan0");
+    uint16_t count = 60;
+    uint8_t churn = 20;
+    uint16_t period = 0;
+    int option;
+
+    while ((option = ::getopt(argc, argv, "c:i:n:r:p:h")) != -1) {
+        switch (option) {
+        case 'c':
+            connector = optarg;
+            break;
+        case 'i':
+            interface = optarg;
+            break;
+        case 'n':
+            count = static_cast<uint16_t>(std::atoi(optarg));
+            break;
+        case 'r':
+            churn = static_cast<uint8_t>(std::min(100, std::atoi(optarg)));
+            break;
+        case 'p':
+            period = static_cast<uint16_t>(std::atoi(optarg));
+            break;
+        default:
+            std::cout << "Usage: " << argv[0] << " [-c connector] [-i interface] [-n BSS count] [-r change percentage per scan] [-p seconds between scans]" << std::endl;
+            return (option == 'h' ? 0 : 1);
+        }
+    }
+
+    if ((connector.empty() == false) && (connector[connector.length() - 1] != '/')) {
+        connector += '/';
+    }
+    ::mkdir(connector.c_str(), 0755);
+
+    WPEFramework::WPASupplicant::Emulator emulator(connector + interface, count, churn, period);
+
+    if (emulator.Open() == false) {
+        return (1);
+    }
+
+    ::signal(SIGINT, Stop);
+    ::signal(SIGTERM, Stop);
+
+    std::cout << "Emulating " << count << " BSS entries on " << connector << interface << std::endl;
+
+    emulator.Run(_stop);
+
+    return (0);
+}
@@ -445,6 +445,67 @@ namespace Plugin {
             Core::JSON::DecUInt8 RetryInterval;
         };
 
+        // Timing of one command on the control channel of the supplicant, all durations in microseconds.
+        class CommandData : public Core::JSON::Container {
+        public:
+            CommandData()
+                : Core::JSON::Container()
+            {
+                Init();
+            }
+            CommandData(const CommandData& copy)
+                : Core::JSON::Container()
+                , Command(copy.Command)
+                , Count(copy.Count)
+                , Coalesced(copy.Coalesced)
+                , Average(copy.Average)
+                , Minimum(copy.Minimum)
+                , Maximum(copy.Maximum)
+                , Waiting(copy.Waiting)
+                , WaitingMax(copy.WaitingMax)
+            {
+                Init();
+            }
+            CommandData& operator=(const CommandData& rhs)
+            {
+                Command = rhs.Command;
+                Count = rhs.Count;
+                Coalesced = rhs.Coalesced;
+                Average = rhs.Average;
+                Minimum = rhs.Minimum;
+                Maximum = rhs.Maximum;
+                Waiting = rhs.Waiting;
+                WaitingMax = rhs.WaitingMax;
+                return (*this);
+            }
+            ~CommandData() override
+            {
+            }
+
+        private:
+            void Init()
+            {
+                Add(_T("command"), &Command);
+                Add(_T("count"), &Count);
+                Add(_T("coalesced"), &Coalesced);
+                Add(_T("average"), &Average);
+                Add(_T("minimum"), &Minimum);
+                Add(_T("maximum"), &Maximum);
+                Add(_T("waiting"), &Waiting);
+                Add(_T("waitingmax"), &WaitingMax);
+            }
+
+        public:
+            Core::JSON::String Command;
+            Core::JSON::DecUInt32 Count;
+            Core::JSON::DecUInt32 Coalesced;
+            Core::JSON::DecUInt32 Average;
+            Core::JSON::DecUInt32 Minimum;
+            Core::JSON::DecUInt32 Maximum;
+            Core::JSON::DecUInt32 Waiting;
+            Core::JSON::DecUInt32 WaitingMax;
+        };
+
         static void FillNetworkInfo(const WPASupplicant::Network& info, JsonData::WifiControl::NetworkInfo& net)
         {
             net.Bssid = std::to_string(info.BSSID());
@@ -659,6 +720,7 @@ namespace Plugin {
         uint32_t get_config(const string& index, JsonData::WifiControl::ConfigInfo& response) const;
         uint32_t set_config(const string& index, const JsonData::WifiControl::ConfigInfo& param);
         uint32_t set_debug(const Core::JSON::DecUInt32& param);
+        uint32_t get_statistics(Core::JSON::ArrayType<CommandData>& response) const;
         void event_scanresults(const Core::JSON::ArrayType<JsonData::WifiControl::NetworkInfo>& list);
         void event_networkchange();
         void event_connectionchange(const string& ssid);
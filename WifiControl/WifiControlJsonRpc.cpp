@@ -39,6 +39,7 @@
         uint32_t get_config(const string& index, JsonData::WifiControl::ConfigInfo& response) const;
         uint32_t set_config(const string& index, const JsonData::WifiControl::ConfigInfo& param);
         uint32_t set_debug(const Core::JSON::DecUInt32& param);
+        uint32_t get_statistics(Core::JSON::ArrayType<CommandData>& response) const;
         void event_scanresults(const Core::JSON::ArrayType<JsonData::WifiControl::NetworkInfo>& list);
         void event_networkchange();
         void event_connectionchange(const string& ssid);
@@ -65,6 +66,7 @@ namespace Plugin {
         Property<Core::JSON::ArrayType<ConfigInfo>>(_T("configs"), &WifiControl::get_configs, nullptr, this);
         Property<ConfigInfo>(_T("config"), &WifiControl::get_config, &WifiControl::set_config, this);
         Property<Core::JSON::DecUInt32>(_T("debug"), nullptr, &WifiControl::set_debug, this);
+        Property<Core::JSON::ArrayType<CommandData>>(_T("statistics"), &WifiControl::get_statistics, nullptr, this);
     }
 
     void WifiControl::UnregisterAll()
@@ -74,6 +76,7 @@ namespace Plugin {
         Unregister(_T("scan"));
         Unregister(_T("store"));
         Unregister(_T("delete"));
+        Unregister(_T("statistics"));
         Unregister(_T("debug"));
         Unregister(_T("config"));
         Unregister(_T("configs"));
@@ -238,6 +241,34 @@ namespace Plugin {
         return result;
     }
 
+    // Property: statistics - Round trip times per command sent to the supplicant
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNAVAILABLE: Returned when the wifi HAL is used, it has no control channel
+    uint32_t WifiControl::get_statistics(Core::JSON::ArrayType<CommandData>& response) const
+    {
+#ifdef USE_WIFI_HAL
+        return Core::ERROR_UNAVAILABLE;
+#else
+        const WPASupplicant::Controller::StatisticsContainer measurements(_controller->Measurements());
+
+        for (const std::pair<const string, WPASupplicant::Controller::Statistics>& entry : measurements) {
+            CommandData& data(response.Add());
+
+            data.Command = entry.first;
+            data.Count = entry.second.Count();
+            data.Coalesced = entry.second.Coalesced();
+            data.Average = entry.second.RoundTrip();
+            data.Minimum = entry.second.RoundTripMin();
+            data.Maximum = entry.second.RoundTripMax();
+            data.Waiting = entry.second.Waiting();
+            data.WaitingMax = entry.second.WaitingMax();
+        }
+
+        return Core::ERROR_NONE;
+#endif
+    }
+
     // Event: scanresults - Signals that the scan operation has finished
     void WifiControl::event_scanresults(const Core::JSON::ArrayType<JsonData::WifiControl::NetworkInfo>& list)
     {